@@ -4,6 +4,7 @@
 //
 
 #include <vector>
+#include <iterator>
 #include "GAEvents.h"
 #include "GAState.h"
 #include "GAUtilities.h"
@@ -81,7 +82,14 @@ namespace gameanalytics
         const char* GAEvents::CategoryResource = "resource";
         const char* GAEvents::CategoryError = "error";
         const double GAEvents::ProcessEventsIntervalInSeconds = 8.0;
+        const double GAEvents::SessionTimeIntervalInSeconds = 15.0;
         const int GAEvents::MaxEventCount = 500;
+        const double GAEvents::DefaultEventBufferDurabilityWindowInSeconds = 2.0;
+        const int GAEvents::MaxEventsRequestsInFlight = 2;
+        const char* GAEvents::DeleteBatchSql = "DELETE FROM ga_events WHERE status = ?;";
+        const char* GAEvents::PutbackBatchSql = "UPDATE ga_events SET status = 0 WHERE status = ?;";
+        const int GAEvents::DefaultEventBufferSize = 50;
+        const int GAEvents::MaxBufferedEventCount = 2000;
 
         bool GAEvents::_destroyed = false;
         GAEvents* GAEvents::_instance = 0;
@@ -91,6 +99,10 @@ namespace gameanalytics
         {
             isRunning = false;
             keepRunning = false;
+            eventBufferDurabilityWindow = DefaultEventBufferDurabilityWindowInSeconds;
+            eventBufferSize = DefaultEventBufferSize;
+            lastBatchId = -1;
+            sessionTimeDirty = false;
         }
 
         GAEvents::~GAEvents()
@@ -122,6 +134,10 @@ namespace gameanalytics
             }
 
             i->keepRunning = false;
+
+            // nothing flushes the buffer or the session time on a timer anymore
+            flushEventBuffer();
+            flushSessionTime(true);
         }
 
         void GAEvents::ensureEventQueueIsRunning()
@@ -136,7 +152,8 @@ namespace gameanalytics
             if (!i->isRunning)
             {
                 i->isRunning = true;
-                threading::GAThreading::scheduleTimer(GAEvents::ProcessEventsIntervalInSeconds, processEventQueue);
+                i->nextProcessEventsTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(static_cast<int>(1000 * GAEvents::ProcessEventsIntervalInSeconds));
+                threading::GAThreading::scheduleTimer(getEventQueueTickInSeconds(), processEventQueue);
             }
         }
 
@@ -170,17 +187,7 @@ namespace gameanalytics
             // Add custom dimensions
             GAEvents::addDimensionsToEvent(eventDict);
 
-            rapidjson::Document cleanedFields;
-            cleanedFields.SetObject();
-
-            {
-                rapidjson::Document d;
-                d.SetObject();
-                state::GAState::getGlobalCustomEventFields(d);
-                state::GAState::validateAndCleanCustomFields(d, cleanedFields);
-            }
-
-            GAEvents::addCustomFieldsToEvent(eventDict, cleanedFields);
+            GAEvents::addCustomFieldsToEvent(eventDict, CustomFields(), false);
 
             // Add to store
             addEventToStore(eventDict);
@@ -189,7 +196,7 @@ namespace gameanalytics
             logging::GALogger::i("Add SESSION START event");
 
             // Send event right away
-            GAEvents::processEvents(categorySessionStart, false);
+            GAEvents::processEvents(categorySessionStart, false, false);
         }
 
         void GAEvents::addSessionEndEvent()
@@ -231,17 +238,7 @@ namespace gameanalytics
             // Add custom dimensions
             GAEvents::addDimensionsToEvent(eventDict);
 
-            rapidjson::Document cleanedFields;
-            cleanedFields.SetObject();
-
-            {
-                rapidjson::Document d;
-                d.SetObject();
-                state::GAState::getGlobalCustomEventFields(d);
-                state::GAState::validateAndCleanCustomFields(d, cleanedFields);
-            }
-
-            GAEvents::addCustomFieldsToEvent(eventDict, cleanedFields);
+            GAEvents::addCustomFieldsToEvent(eventDict, CustomFields(), false);
 
             // Add to store
             addEventToStore(eventDict);
@@ -254,7 +251,7 @@ namespace gameanalytics
         }
 
         // BUSINESS EVENT
-        void GAEvents::addBusinessEvent(const char* currency, int amount, const char* itemType, const char* itemId, const char* cartType, const rapidjson::Value& fields, bool mergeFields)
+        void GAEvents::addBusinessEvent(const char* currency, int amount, const char* itemType, const char* itemId, const char* cartType, const CustomFields& fields, bool mergeFields)
         {
             if(!state::GAState::isEventSubmissionEnabled())
             {
@@ -315,47 +312,21 @@ namespace gameanalytics
             // Add custom dimensions
             GAEvents::addDimensionsToEvent(eventDict);
 
-            rapidjson::Document cleanedFields;
-            cleanedFields.SetObject();
-
-            if (fields.IsObject() && fields.MemberCount() > 0)
-            {
-                rapidjson::Document d;
-                d.SetObject();
-                mergeObjects(d, fields, d.GetAllocator(), false);
-                if(mergeFields)
-                {
-                    rapidjson::Document globalFields;
-                    globalFields.SetObject();
-                    state::GAState::getGlobalCustomEventFields(d);
-                    mergeObjects(d, globalFields, d.GetAllocator(), false);
-                }
-                state::GAState::validateAndCleanCustomFields(d, cleanedFields);
-            }
-            else
-            {
-                rapidjson::Document d;
-                d.SetObject();
-                state::GAState::getGlobalCustomEventFields(d);
-                state::GAState::validateAndCleanCustomFields(d, cleanedFields);
-            }
-
-            GAEvents::addCustomFieldsToEvent(eventDict, cleanedFields);
+            GAEvents::addCustomFieldsToEvent(eventDict, fields, mergeFields);
 
-            rapidjson::StringBuffer buffer;
+            // Log
+            if (logging::GALogger::isInfoEnabled())
             {
-                rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-                cleanedFields.Accept(writer);
+                rapidjson::StringBuffer buffer;
+                GAEvents::customFieldsToString(eventDict, buffer);
+                logging::GALogger::i("Add BUSINESS event: {currency:%s, amount:%d, itemType:%s, itemId:%s, cartType:%s, fields:%s}", currency, amount, itemType, itemId, cartType, buffer.GetString());
             }
 
-            // Log
-            logging::GALogger::i("Add BUSINESS event: {currency:%s, amount:%d, itemType:%s, itemId:%s, cartType:%s, fields:%s}", currency, amount, itemType, itemId, cartType, buffer.GetString());
-
             // Send to store
             addEventToStore(eventDict);
         }
 
-        void GAEvents::addResourceEvent(EGAResourceFlowType flowType, const char* currency, double amount, const char* itemType, const char* itemId, const rapidjson::Value& fields, bool mergeFields)
+        void GAEvents::addResourceEvent(EGAResourceFlowType flowType, const char* currency, double amount, const char* itemType, const char* itemId, const CustomFields& fields, bool mergeFields)
         {
             if(!state::GAState::isEventSubmissionEnabled())
             {
@@ -405,47 +376,21 @@ namespace gameanalytics
             // Add custom dimensions
             GAEvents::addDimensionsToEvent(eventDict);
 
-            rapidjson::Document cleanedFields;
-            cleanedFields.SetObject();
+            GAEvents::addCustomFieldsToEvent(eventDict, fields, mergeFields);
 
-            if (fields.IsObject() && fields.MemberCount() > 0)
-            {
-                rapidjson::Document d;
-                d.SetObject();
-                mergeObjects(d, fields, d.GetAllocator(), false);
-                if(mergeFields)
-                {
-                    rapidjson::Document globalFields;
-                    globalFields.SetObject();
-                    state::GAState::getGlobalCustomEventFields(d);
-                    mergeObjects(d, globalFields, d.GetAllocator(), false);
-                }
-                state::GAState::validateAndCleanCustomFields(d, cleanedFields);
-            }
-            else
-            {
-                rapidjson::Document d;
-                d.SetObject();
-                state::GAState::getGlobalCustomEventFields(d);
-                state::GAState::validateAndCleanCustomFields(d, cleanedFields);
-            }
-
-            GAEvents::addCustomFieldsToEvent(eventDict, cleanedFields);
-
-            rapidjson::StringBuffer buffer;
+            // Log
+            if (logging::GALogger::isInfoEnabled())
             {
-                rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-                fields.Accept(writer);
+                rapidjson::StringBuffer buffer;
+                GAEvents::customFieldsToString(eventDict, buffer);
+                logging::GALogger::i("Add RESOURCE event: {currency:%s, amount: %f, itemType:%s, itemId:%s, fields:%s}", currency, amount, itemType, itemId, buffer.GetString());
             }
 
-            // Log
-            logging::GALogger::i("Add RESOURCE event: {currency:%s, amount: %f, itemType:%s, itemId:%s, fields:%s}", currency, amount, itemType, itemId, buffer.GetString());
-
             // Send to store
             addEventToStore(eventDict);
         }
 
-        void GAEvents::addProgressionEvent(EGAProgressionStatus progressionStatus, const char* progression01, const char* progression02, const char* progression03, int score, bool sendScore, const rapidjson::Value& fields, bool mergeFields)
+        void GAEvents::addProgressionEvent(EGAProgressionStatus progressionStatus, const char* progression01, const char* progression02, const char* progression03, int score, bool sendScore, const CustomFields& fields, bool mergeFields)
         {
             if(!state::GAState::isEventSubmissionEnabled())
             {
@@ -535,47 +480,21 @@ namespace gameanalytics
             // Add custom dimensions
             GAEvents::addDimensionsToEvent(eventDict);
 
-            rapidjson::Document cleanedFields;
-            cleanedFields.SetObject();
-
-            if (fields.IsObject() && fields.MemberCount() > 0)
-            {
-                rapidjson::Document d;
-                d.SetObject();
-                mergeObjects(d, fields, d.GetAllocator(), false);
-                if(mergeFields)
-                {
-                    rapidjson::Document globalFields;
-                    globalFields.SetObject();
-                    state::GAState::getGlobalCustomEventFields(d);
-                    mergeObjects(d, globalFields, d.GetAllocator(), false);
-                }
-                state::GAState::validateAndCleanCustomFields(d, cleanedFields);
-            }
-            else
-            {
-                rapidjson::Document d;
-                d.SetObject();
-                state::GAState::getGlobalCustomEventFields(d);
-                state::GAState::validateAndCleanCustomFields(d, cleanedFields);
-            }
+            GAEvents::addCustomFieldsToEvent(eventDict, fields, mergeFields);
 
-            GAEvents::addCustomFieldsToEvent(eventDict, cleanedFields);
-
-            rapidjson::StringBuffer buffer;
+            // Log
+            if (logging::GALogger::isInfoEnabled())
             {
-                rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-                fields.Accept(writer);
+                rapidjson::StringBuffer buffer;
+                GAEvents::customFieldsToString(eventDict, buffer);
+                logging::GALogger::i("Add PROGRESSION event: {status:%s, progression01:%s, progression02:%s, progression03:%s, score:%d, attempt:%d, fields:%s}", statusString, progression01, progression02, progression03, score, attempt_num, buffer.GetString());
             }
 
-            // Log
-            logging::GALogger::i("Add PROGRESSION event: {status:%s, progression01:%s, progression02:%s, progression03:%s, score:%d, attempt:%d, fields:%s}", statusString, progression01, progression02, progression03, score, attempt_num, buffer.GetString());
-
             // Send to store
             addEventToStore(eventDict);
         }
 
-        void GAEvents::addDesignEvent(const char* eventId, double value, bool sendValue, const rapidjson::Value& fields, bool mergeFields)
+        void GAEvents::addDesignEvent(const char* eventId, double value, bool sendValue, const CustomFields& fields, bool mergeFields)
         {
             if(!state::GAState::isEventSubmissionEnabled())
             {
@@ -616,55 +535,29 @@ namespace gameanalytics
                 eventData.AddMember("value", value, allocator);
             }
 
-            rapidjson::Document cleanedFields;
-            cleanedFields.SetObject();
-
-            if (fields.IsObject() && fields.MemberCount() > 0)
-            {
-                rapidjson::Document d;
-                d.SetObject();
-                mergeObjects(d, fields, d.GetAllocator(), false);
-                if(mergeFields)
-                {
-                    rapidjson::Document globalFields;
-                    globalFields.SetObject();
-                    state::GAState::getGlobalCustomEventFields(d);
-                    mergeObjects(d, globalFields, d.GetAllocator(), false);
-                }
-                state::GAState::validateAndCleanCustomFields(d, cleanedFields);
-            }
-            else
-            {
-                rapidjson::Document d;
-                d.SetObject();
-                state::GAState::getGlobalCustomEventFields(d);
-                state::GAState::validateAndCleanCustomFields(d, cleanedFields);
-            }
-
-            GAEvents::addCustomFieldsToEvent(eventData, cleanedFields);
+            GAEvents::addCustomFieldsToEvent(eventData, fields, mergeFields);
 
             // Add custom dimensions
             GAEvents::addDimensionsToEvent(eventData);
 
-            rapidjson::StringBuffer buffer;
+            // Log
+            if (logging::GALogger::isInfoEnabled())
             {
-                rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-                fields.Accept(writer);
+                rapidjson::StringBuffer buffer;
+                GAEvents::customFieldsToString(eventData, buffer);
+                logging::GALogger::i("Add DESIGN event: {eventId:%s, value:%f, fields:%s}", eventId, value, buffer.GetString());
             }
 
-            // Log
-            logging::GALogger::i("Add DESIGN event: {eventId:%s, value:%f, fields:%s}", eventId, value, buffer.GetString());
-
             // Send to store
             addEventToStore(eventData);
         }
 
-        void GAEvents::addErrorEvent(EGAErrorSeverity severity, const char* message, const rapidjson::Value& fields, bool mergeFields)
+        void GAEvents::addErrorEvent(EGAErrorSeverity severity, const char* message, const CustomFields& fields, bool mergeFields)
         {
             addErrorEvent(severity, message, fields, mergeFields, false);
         }
 
-        void GAEvents::addErrorEvent(EGAErrorSeverity severity, const char* message, const rapidjson::Value& fields, bool mergeFields, bool skipAddingFields)
+        void GAEvents::addErrorEvent(EGAErrorSeverity severity, const char* message, const CustomFields& fields, bool mergeFields, bool skipAddingFields)
         {
             if(!state::GAState::isEventSubmissionEnabled())
             {
@@ -709,61 +602,56 @@ namespace gameanalytics
 
             if(!skipAddingFields)
             {
-                rapidjson::Document cleanedFields;
-                cleanedFields.SetObject();
-
-                if (fields.IsObject() && fields.MemberCount() > 0)
-                {
-                    rapidjson::Document d;
-                    d.SetObject();
-                    mergeObjects(d, fields, d.GetAllocator(), false);
-                    if(mergeFields)
-                    {
-                        rapidjson::Document globalFields;
-                        globalFields.SetObject();
-                        state::GAState::getGlobalCustomEventFields(d);
-                        mergeObjects(d, globalFields, d.GetAllocator(), false);
-                    }
-                    state::GAState::validateAndCleanCustomFields(d, cleanedFields);
-                }
-                else
-                {
-                    rapidjson::Document d;
-                    d.SetObject();
-                    state::GAState::getGlobalCustomEventFields(d);
-                    state::GAState::validateAndCleanCustomFields(d, cleanedFields);
-                }
-
-                GAEvents::addCustomFieldsToEvent(eventData, cleanedFields);
+                GAEvents::addCustomFieldsToEvent(eventData, fields, mergeFields);
             }
 
             // Add custom dimensions
             GAEvents::addDimensionsToEvent(eventData);
 
-            rapidjson::StringBuffer buffer;
+            // Log
+            if (logging::GALogger::isInfoEnabled())
             {
-                rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-                fields.Accept(writer);
+                rapidjson::StringBuffer buffer;
+                GAEvents::customFieldsToString(eventData, buffer);
+                logging::GALogger::i("Add ERROR event: {severity:%s, message:%s, fields:%s}", severityString, message, buffer.GetString());
             }
 
-            // Log
-            logging::GALogger::i("Add ERROR event: {severity:%s, message:%s, fields:%s}", severityString, message, buffer.GetString());
-
             // Send to store
             addEventToStore(eventData);
         }
 
         void GAEvents::processEventQueue()
         {
-            processEvents("", true);
             GAEvents* i = GAEvents::getInstance();
             if(!i)
             {
                 return;
             }
+
+#if !USE_UWP
+            // normally run by a task the transfer thread queues, this catches completions whose task was dropped
+            http::GAHTTPApi* http = http::GAHTTPApi::getInstance();
+            if (http)
+            {
+                http->runCompletedRequestCallbacks();
+            }
+#endif
+
+            // the queue ticks at the buffer durability window, events are only sent every ProcessEventsIntervalInSeconds
+            if (std::chrono::steady_clock::now() >= i->nextProcessEventsTime)
+            {
+                processEvents("", true, false);
+                i->nextProcessEventsTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(static_cast<int>(1000 * GAEvents::ProcessEventsIntervalInSeconds));
+            }
+            else
+            {
+                flushEventBuffer();
+            }
+            flushSessionTime(false);
+
             if (i->keepRunning)
             {
-                threading::GAThreading::scheduleTimer(GAEvents::ProcessEventsIntervalInSeconds, processEventQueue);
+                threading::GAThreading::scheduleTimer(getEventQueueTickInSeconds(), processEventQueue);
             }
             else
             {
@@ -771,144 +659,290 @@ namespace gameanalytics
             }
         }
 
-        void GAEvents::processEvents(const char* category, bool performCleanup)
+        double GAEvents::getEventQueueTickInSeconds()
         {
-            if(!state::GAState::isEventSubmissionEnabled())
+            GAEvents* i = GAEvents::getInstance();
+            if(!i)
+            {
+                return GAEvents::ProcessEventsIntervalInSeconds;
+            }
+
+            std::lock_guard<std::mutex> lock(i->bufferMutex);
+            if (i->eventBufferDurabilityWindow > 0 && i->eventBufferDurabilityWindow < GAEvents::ProcessEventsIntervalInSeconds)
+            {
+                return i->eventBufferDurabilityWindow;
+            }
+            return GAEvents::ProcessEventsIntervalInSeconds;
+        }
+
+        void GAEvents::setEventBufferDurabilityWindow(double seconds)
+        {
+            GAEvents* i = GAEvents::getInstance();
+            if(!i)
             {
                 return;
             }
 
-            // Request identifier
-            char requestIdentifier[65] = "";
-            utilities::GAUtilities::generateUUID(requestIdentifier);
+            {
+                std::lock_guard<std::mutex> lock(i->bufferMutex);
+                i->eventBufferDurabilityWindow = seconds;
+            }
 
-            char selectSql[129] = "";
-            char updateSql[257] = "";
-            char deleteSql[129] = "";
-            snprintf(deleteSql, sizeof(deleteSql), "DELETE FROM ga_events WHERE status = '%s'", requestIdentifier);
-            char putbackSql[129] = "";
-            snprintf(putbackSql, sizeof(putbackSql), "UPDATE ga_events SET status = 'new' WHERE status = '%s';", requestIdentifier);
+            if (seconds <= 0)
+            {
+                flushEventBuffer();
+            }
+        }
 
-            // Cleanup
-            if (performCleanup)
+        void GAEvents::setEventBufferSize(int eventCount)
+        {
+            GAEvents* i = GAEvents::getInstance();
+            if(!i)
             {
-                cleanupEvents();
-                fixMissingSessionEndEvents();
+                return;
             }
 
-            // Prepare SQL
-            char andCategory[65] = "";
-            if (strlen(category) > 0)
+            bool flush = false;
             {
-                snprintf(andCategory, sizeof(andCategory), " AND category='%s' ", category);
+                std::lock_guard<std::mutex> lock(i->bufferMutex);
+                i->eventBufferSize = eventCount;
+                flush = static_cast<int>(i->bufferedEvents.size()) >= eventCount;
             }
-            snprintf(selectSql, sizeof(selectSql), "SELECT event FROM ga_events WHERE status = 'new' %s;", andCategory);
-            snprintf(updateSql, sizeof(updateSql), "UPDATE ga_events SET status = '%s' WHERE status = 'new' %s;", requestIdentifier, andCategory);
 
-            // Get events to process
-            rapidjson::Document events;
-            store::GAStore::executeQuerySync(selectSql, events);
+            if (flush)
+            {
+                flushEventBuffer();
+            }
+        }
 
-            // Check for errors or empty
-            if (events.IsNull() || events.Size() == 0)
+        bool GAEvents::flushEventBuffer()
+        {
+            GAEvents* i = GAEvents::getInstance();
+            if(!i)
             {
-                logging::GALogger::i("Event queue: No events to send");
-                GAEvents::updateSessionTime();
-                return;
+                return false;
             }
 
-            // Check number of events and take some action if there are too many?
-            if (events.Size() > GAEvents::MaxEventCount)
+            // take the events out so the lock is not held while sqlite is busy
+            std::vector<BufferedEvent> events;
             {
-                // Make a limit request
-                snprintf(selectSql, sizeof(selectSql), "SELECT client_ts FROM ga_events WHERE status = 'new' %s ORDER BY client_ts ASC LIMIT 0,%d;", andCategory, GAEvents::MaxEventCount);
-                store::GAStore::executeQuerySync(selectSql, events);
-                if (events.IsNull())
+                std::lock_guard<std::mutex> lock(i->bufferMutex);
+                events.swap(i->bufferedEvents);
+            }
+
+            if (events.empty())
+            {
+                return true;
+            }
+            if (store::GAStore::isDestroyed())
+            {
+                return false;
+            }
+
+            std::vector<const char*> endedSessionIds;
+            long long eventBytes = 0;
+            std::vector<const char*> parameters;
+            parameters.reserve(events.size() * 4);
+            for (const BufferedEvent& e : events)
+            {
+                parameters.push_back(e.category);
+                parameters.push_back(e.sessionId);
+                parameters.push_back(e.clientTs);
+                parameters.push_back(e.event.data());
+                eventBytes += static_cast<long long>(e.event.size()) - 1;
+                if (strcmp(e.category, GAEvents::CategorySessionEnd) == 0)
                 {
-                    return;
+                    endedSessionIds.push_back(e.sessionId);
                 }
+            }
 
-                // Get last timestamp
-                const rapidjson::Value& lastItem = events[events.Size() - 1];
-                const char* lastTimestamp = lastItem["client_ts"].GetString();
-
-                // Select again
-                snprintf(selectSql, sizeof(selectSql), "SELECT event FROM ga_events WHERE status = 'new' %s AND client_ts<='%s';", andCategory, lastTimestamp);
-                store::GAStore::executeQuerySync(selectSql, events);
-                if (events.IsNull())
+            const char* sql = "INSERT INTO ga_events (status, category, session_id, client_ts, event) VALUES(0, ?, ?, ?, ?);";
+            if (!store::GAStore::executeBatchQuerySync(sql, parameters.data(), 4, events.size()))
+            {
+                // put the events back in front of anything buffered since, for the next flush to retry
+                std::lock_guard<std::mutex> lock(i->bufferMutex);
+                std::move(i->bufferedEvents.begin(), i->bufferedEvents.end(), std::back_inserter(events));
+                i->bufferedEvents.swap(events);
+                int dropCount = static_cast<int>(i->bufferedEvents.size()) - GAEvents::MaxBufferedEventCount;
+                if (dropCount > 0)
                 {
-                    return;
+                    i->bufferedEvents.erase(i->bufferedEvents.begin(), i->bufferedEvents.begin() + dropCount);
+                    logging::GALogger::w("Could not write buffered events to the store, dropped the %d oldest", dropCount);
                 }
+                else
+                {
+                    logging::GALogger::w("Could not write %d buffered events to the store, will retry", static_cast<int>(i->bufferedEvents.size()));
+                }
+                return false;
+            }
 
-                // Update sql
-                snprintf(updateSql, sizeof(updateSql), "UPDATE ga_events SET status='%s' WHERE status='new' %s AND client_ts<='%s';", requestIdentifier, andCategory, lastTimestamp);
+            logging::GALogger::d("Event buffer: Wrote %d events to the store", static_cast<int>(events.size()));
+            store::GAStore::addEventsToQuota(static_cast<int>(events.size()), eventBytes);
+
+            // the session row is removed once its session_end event is stored, otherwise keep its timestamp current
+            for (const char* sessionId : endedSessionIds)
+            {
+                const char* params[] = { sessionId };
+                store::GAStore::executeQuerySync("DELETE FROM ga_session WHERE session_id = ?;", params, 1);
+            }
+            if (!endedSessionIds.empty())
+            {
+                i->sessionTimeDirty = false;
+            }
+            else
+            {
+                GAEvents::markSessionTimeDirty();
             }
+            return true;
+        }
 
-            // Log
-            logging::GALogger::i("Event queue: Sending %d events.", events.Size());
+        void GAEvents::processEvents(const char* category, bool performCleanup)
+        {
+            processEvents(category, performCleanup, true);
+        }
+
+        void GAEvents::processEvents(const char* category, bool performCleanup, bool waitForResponse)
+        {
+            // events still waiting in the buffer are part of this submission
+            flushEventBuffer();
 
-            // Set status of events to 'sending' (also check for error)
-            rapidjson::Document updateResult;
-            store::GAStore::executeQuerySync(updateSql, updateResult);
-            if (updateResult.IsNull())
+            if(!state::GAState::isEventSubmissionEnabled())
             {
                 return;
             }
 
-            // Create payload data from events
-            rapidjson::Document payloadArray;
-            payloadArray.SetArray();
-            rapidjson::Document::AllocatorType& allocator = payloadArray.GetAllocator();
+            http::GAHTTPApi* http = http::GAHTTPApi::getInstance();
+            if(!http)
+            {
+                return;
+            }
 
-            for (rapidjson::Value::ConstValueIterator itr = events.Begin(); itr != events.End(); ++itr)
+#if !USE_UWP
+            int requestsInFlight = http->getEventsRequestsInFlight();
+            if (!waitForResponse && requestsInFlight >= GAEvents::MaxEventsRequestsInFlight)
             {
-                const char* eventDict = (*itr).HasMember("event") ? (*itr)["event"].GetString() : "";
-                if (strlen(eventDict) > 0)
+                logging::GALogger::d("Event queue: %d requests still in flight, sending next time", requestsInFlight);
+                return;
+            }
+#else
+            int requestsInFlight = 0;
+#endif
+
+            // Batch identifier, marks the claimed events in the status column
+            char batchId[21] = "";
+            snprintf(batchId, sizeof(batchId), "%" PRId64, GAEvents::nextBatchId());
+
+            // Cleanup, events of requests still in flight must keep their status
+            if (performCleanup)
+            {
+                if (requestsInFlight == 0)
                 {
-                    rapidjson::Document d;
-                    rapidjson::ParseResult ok = d.Parse(eventDict);
-                    if(!ok)
-                    {
-                        logging::GALogger::d("processEvents -- JSON error (offset %u): %s", (unsigned)ok.Offset(), GetParseError_En(ok.Code()));
-                        logging::GALogger::d("%s", eventDict);
-                    }
-                    else
+                    cleanupEvents();
+                }
+                fixMissingSessionEndEvents();
+            }
+
+            const char* batchParameters[1] = { batchId };
+
+            // Create payload data from events, the stored strings are spliced into the array as they are
+            // and compressed while the rows are read
+            http->beginEventsPayload();
+            http->writeEventsPayload("[", 1);
+            int sentCount = 0;
+            bool hasEvents = false;
+
+            store::GAStore::RowVisitor addToPayload = [http, &sentCount, &hasEvents](const store::GAStoreRow& row)
+            {
+                ++sentCount;
+                const char* eventDict = row.getString(0);
+                size_t eventLength = row.getStringLength(0);
+                if (eventLength == 0)
+                {
+                    return true;
+                }
+
+                // client_ts is validated when the event is stored, only rows written by older versions need fixing up
+                if (validators::GAValidator::validateClientTs(row.getInt64(1)))
+                {
+                    if (hasEvents)
                     {
-                        if(d.HasMember("client_ts"))
-                        {
-                            if (!validators::GAValidator::validateClientTs(d["client_ts"].GetInt64()))
-                            {
-                                d.RemoveMember("client_ts");
-                            }
-                        }
-
-                        rapidjson::Value v;
-                        v.CopyFrom(d, allocator);
-                        payloadArray.PushBack(v.Move(), allocator);
+                        http->writeEventsPayload(",", 1);
                     }
+                    http->writeEventsPayload(eventDict, eventLength);
+                    hasEvents = true;
+                    return true;
                 }
+
+                rapidjson::Document d;
+                rapidjson::ParseResult ok = d.Parse(eventDict);
+                if(!ok)
+                {
+                    logging::GALogger::d("processEvents -- JSON error (offset %u): %s", (unsigned)ok.Offset(), GetParseError_En(ok.Code()));
+                    logging::GALogger::d("%s", eventDict);
+                    return true;
+                }
+
+                d.RemoveMember("client_ts");
+                rapidjson::StringBuffer buffer;
+                {
+                    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+                    d.Accept(writer);
+                }
+                if (hasEvents)
+                {
+                    http->writeEventsPayload(",", 1);
+                }
+                http->writeEventsPayload(buffer.GetString(), buffer.GetSize());
+                hasEvents = true;
+                return true;
+            };
+            bool success = GAEvents::claimEvents(category, batchId, addToPayload);
+
+            // Check for errors or empty
+            if (!success || sentCount == 0)
+            {
+                logging::GALogger::i("Event queue: No events to send");
+                GAEvents::markSessionTimeDirty();
+                return;
             }
+            http->writeEventsPayload("]", 1);
 
-            rapidjson::StringBuffer buffer;
+            // Log
+            logging::GALogger::i("Event queue: Sending %d events.", sentCount);
+
+            // only empty or broken events were selected, nothing will ever be sent for them
+            if (!hasEvents)
             {
-                rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-                payloadArray.Accept(writer);
+                store::GAStore::executeQuerySync(GAEvents::DeleteBatchSql, batchParameters, 1);
+                store::GAStore::eventsRemovedFromStore();
+                return;
             }
 
             // send events
-            rapidjson::Value dataDict(rapidjson::kArrayType);
-            http::EGAHTTPApiResponse responseEnum;
-            http::GAHTTPApi* http = http::GAHTTPApi::getInstance();
-            if(!http)
+#if !USE_UWP
+            if (!waitForResponse)
             {
+                std::string batch = batchId;
+                bool started = http->sendEventsPayloadAsync([sentCount, batch](http::EGAHTTPApiResponse responseEnum, const rapidjson::Value& dataDict)
+                {
+                    GAEvents::processEventsResponse(responseEnum, dataDict, sentCount, batch.c_str());
+                });
+                if (!started)
+                {
+                    GAEvents::processEventsResponse(http::NoResponse, rapidjson::Value(), sentCount, batchId);
+                }
                 return;
             }
+#endif
+
+            rapidjson::Value dataDict(rapidjson::kArrayType);
+            http::EGAHTTPApiResponse responseEnum;
 #if USE_UWP
             std::pair<http::EGAHTTPApiResponse, std::string> pair;
 
             try
             {
-                pair = http->sendEventsInArray(payloadArray).get();
+                pair = http->sendEventsPayload().get();
             }
             catch(Platform::COMException^ e)
             {
@@ -930,15 +964,51 @@ namespace gameanalytics
                 }
             }
 #else
-            http->sendEventsInArray(responseEnum, dataDict, payloadArray);
+            http->sendEventsPayload(responseEnum, dataDict);
 #endif
 
+            GAEvents::processEventsResponse(responseEnum, dataDict, sentCount, batchId);
+        }
+
+        bool GAEvents::claimEvents(const char* category, const char* batchId, const store::GAStore::RowVisitor& readEvent)
+        {
+            bool hasCategory = strlen(category) > 0;
+            const char* andCategory = hasCategory ? " AND category = ?" : "";
+            char maxEventCount[12] = "";
+            snprintf(maxEventCount, sizeof(maxEventCount), "%d", GAEvents::MaxEventCount);
+
+            // Claims exactly the oldest MaxEventCount new events (ids grow with insertion)
+            char claimSql[257] = "";
+            snprintf(claimSql, sizeof(claimSql), "UPDATE ga_events SET status = ? WHERE id IN (SELECT id FROM ga_events WHERE status = 0%s ORDER BY id LIMIT ?);", andCategory);
+            const char* claimParameters[3] = { batchId, hasCategory ? category : maxEventCount, maxEventCount };
+            const char* selectSql = "SELECT event, client_ts FROM ga_events WHERE status = ? ORDER BY id;";
+            const char* batchParameters[1] = { batchId };
+
+            // the claim and reading the claimed rows back happen in one transaction, nothing is claimed if either fails
+            bool readFailed = false;
+            return store::GAStore::executeInTransactionSync([&]()
+            {
+                return store::GAStore::queryRowsSync(claimSql, claimParameters, hasCategory ? 3 : 2, [](const store::GAStoreRow&) { return false; })
+                    && store::GAStore::queryRowsSync(selectSql, batchParameters, 1, [&readEvent, &readFailed](const store::GAStoreRow& row)
+                    {
+                        readFailed = !readEvent(row);
+                        return !readFailed;
+                    })
+                    && !readFailed;
+            });
+        }
+
+        void GAEvents::processEventsResponse(http::EGAHTTPApiResponse responseEnum, const rapidjson::Value& dataDict, int sentCount, const char* batchId)
+        {
+            const char* batchParameters[1] = { batchId };
+
             if (responseEnum == http::Ok)
             {
                 // Delete events
-                store::GAStore::executeQuerySync(deleteSql);
+                store::GAStore::executeQuerySync(GAEvents::DeleteBatchSql, batchParameters, 1);
+                store::GAStore::eventsRemovedFromStore();
 
-                logging::GALogger::i("Event queue: %d events sent.", events.Size());
+                logging::GALogger::i("Event queue: %d events sent.", sentCount);
             }
             else
             {
@@ -946,25 +1016,57 @@ namespace gameanalytics
                 if (responseEnum == http::NoResponse)
                 {
                     logging::GALogger::w("Event queue: Failed to send events to collector - Retrying next time");
-                    store::GAStore::executeQuerySync(putbackSql);
+                    store::GAStore::executeQuerySync(GAEvents::PutbackBatchSql, batchParameters, 1);
                     // Delete events (When getting some anwser back always assume events are processed)
                 }
                 else
                 {
                     if (responseEnum == http::BadRequest && dataDict.IsArray())
                     {
-                        logging::GALogger::w("Event queue: %d events sent. %d events failed GA server validation.", events.Size(), dataDict.Size());
+                        logging::GALogger::w("Event queue: %d events sent. %d events failed GA server validation.", sentCount, dataDict.Size());
                     }
                     else
                     {
                         logging::GALogger::w("Event queue: Failed to send events.");
                     }
 
-                    store::GAStore::executeQuerySync(deleteSql);
+                    store::GAStore::executeQuerySync(GAEvents::DeleteBatchSql, batchParameters, 1);
+                    store::GAStore::eventsRemovedFromStore();
                 }
             }
         }
 
+        void GAEvents::markSessionTimeDirty()
+        {
+            GAEvents* i = GAEvents::getInstance();
+            if(!i)
+            {
+                return;
+            }
+
+            i->sessionTimeDirty = true;
+            flushSessionTime(false);
+        }
+
+        void GAEvents::flushSessionTime(bool force)
+        {
+            GAEvents* i = GAEvents::getInstance();
+            if(!i || !i->sessionTimeDirty)
+            {
+                return;
+            }
+
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (!force && now < i->nextSessionTimeUpdate)
+            {
+                return;
+            }
+
+            i->sessionTimeDirty = false;
+            i->nextSessionTimeUpdate = now + std::chrono::milliseconds(static_cast<int>(1000 * GAEvents::SessionTimeIntervalInSeconds));
+            GAEvents::updateSessionTime();
+        }
+
         void GAEvents::updateSessionTime()
         {
             if(state::GAState::sessionIsStarted())
@@ -976,17 +1078,7 @@ namespace gameanalytics
                 // Add custom dimensions
                 GAEvents::addDimensionsToEvent(ev);
 
-                rapidjson::Document cleanedFields;
-                cleanedFields.SetObject();
-
-                {
-                    rapidjson::Document d;
-                    d.SetObject();
-                    state::GAState::getGlobalCustomEventFields(d);
-                    state::GAState::validateAndCleanCustomFields(d, cleanedFields);
-                }
-
-                GAEvents::addCustomFieldsToEvent(ev, cleanedFields);
+                GAEvents::addCustomFieldsToEvent(ev, CustomFields(), false);
 
                 rapidjson::StringBuffer buffer;
                 {
@@ -1007,9 +1099,34 @@ namespace gameanalytics
             }
         }
 
+        int64_t GAEvents::nextBatchId()
+        {
+            GAEvents* i = GAEvents::getInstance();
+            if(!i)
+            {
+                return 1;
+            }
+
+            // continue after batches left in the store by an earlier run, they may not have been put back yet
+            if (i->lastBatchId < 0)
+            {
+                i->lastBatchId = 0;
+                store::GAStore::queryRowsSync("SELECT MAX(status) FROM ga_events;", [i](const store::GAStoreRow& row)
+                {
+                    if (!row.isNull(0))
+                    {
+                        i->lastBatchId = row.getInt64(0);
+                    }
+                    return false;
+                });
+            }
+
+            return ++i->lastBatchId;
+        }
+
         void GAEvents::cleanupEvents()
         {
-            store::GAStore::executeQuerySync("UPDATE ga_events SET status = 'new';");
+            store::GAStore::executeQuerySync("UPDATE ga_events SET status = 0 WHERE status != 0;");
         }
 
         void GAEvents::fixMissingSessionEndEvents()
@@ -1099,9 +1216,9 @@ namespace gameanalytics
                 return;
             }
 
-            // Check db size limits (10mb)
-            // If database is too large block all except user, session and business
-            if (store::GAStore::isDbTooLargeForEvents() && !utilities::GAUtilities::stringMatch(eventData["category"].GetString(), "^(user|session_end|business)$"))
+            // Check db size limits
+            // If nothing is left to evict only categories that are never evicted are stored
+            if (store::GAStore::isDbTooLargeForEvents() && store::GAStore::isEventCategoryEvictable(eventData["category"].GetString()))
             {
                 logging::GALogger::w("Database too large. Event has been blocked.");
                 http::GAHTTPApi* httpInstance = http::GAHTTPApi::getInstance();
@@ -1113,42 +1230,90 @@ namespace gameanalytics
                 return;
             }
 
+            // the static annotations are written pre-serialized, unless the event overrides one of them
+            bool useStaticAnnotations = true;
+            for (rapidjson::Value::ConstMemberIterator itr = eventData.MemberBegin(); itr != eventData.MemberEnd() && useStaticAnnotations; ++itr)
+            {
+                useStaticAnnotations = !state::GAState::isStaticEventAnnotation(itr->name.GetString());
+            }
+
             // Get default annotations
             rapidjson::Document ev;
-            ev.SetObject();
-            state::GAState::getEventAnnotations(ev);
+            if (useStaticAnnotations)
+            {
+                state::GAState::getDynamicEventAnnotations(ev);
+            }
+            else
+            {
+                state::GAState::getEventAnnotations(ev);
+            }
 
             // Merge with eventData
             mergeObjects(ev, eventData, ev.GetAllocator(), true);
 
+            // client_ts is only validated here, processEvents sends the stored string as it is
+            int64_t clientTs = ev.HasMember("client_ts") ? ev["client_ts"].GetInt64() : 0;
+            if (!validators::GAValidator::validateClientTs(clientTs))
+            {
+                ev.RemoveMember("client_ts");
+            }
+
             // Create json string representation
             rapidjson::StringBuffer evBuffer;
             {
                 rapidjson::Writer<rapidjson::StringBuffer> writer(evBuffer);
-                ev.Accept(writer);
+                if (useStaticAnnotations)
+                {
+                    // the members after the static ones always include event_uuid, so the comma is never trailing
+                    writer.StartObject();
+                    state::GAState::appendStaticEventAnnotations(evBuffer);
+                    evBuffer.Put(',');
+                    for (rapidjson::Value::ConstMemberIterator itr = ev.MemberBegin(); itr != ev.MemberEnd(); ++itr)
+                    {
+                        writer.Key(itr->name.GetString(), itr->name.GetStringLength());
+                        itr->value.Accept(writer);
+                    }
+                    writer.EndObject();
+                }
+                else
+                {
+                    ev.Accept(writer);
+                }
             }
             const char* json = evBuffer.GetString();
 
             // output if VERBOSE LOG enabled
-            logging::GALogger::ii("Event added to queue: %s", json);
+            if (logging::GALogger::isVerboseInfoEnabled())
+            {
+                logging::GALogger::ii("Event added to queue: %s", json);
+            }
 
-            // Add to store
-            char client_ts[21] = "";
-            snprintf(client_ts, sizeof(client_ts), "%" PRId64, ev["client_ts"].GetInt64());
-            const char* parameters[] = { "new", ev["category"].GetString(), ev["session_id"].GetString(), client_ts, json };
-            const char* sql = "INSERT INTO ga_events (status, category, session_id, client_ts, event) VALUES(?, ?, ?, ?, ?);";
+            GAEvents* i = GAEvents::getInstance();
+            if(!i)
+            {
+                return;
+            }
 
-            store::GAStore::executeQuerySync(sql, parameters, 5);
+            bool isSessionEnd = strcmp(eventData["category"].GetString(), GAEvents::CategorySessionEnd) == 0;
 
-            // Add to session store if not last
-            if (strcmp(eventData["category"].GetString(), GAEvents::CategorySessionEnd) == 0)
+            // Add to buffer, it is written to the store in one transaction per batch
+            bool flush = false;
             {
-                const char* params[] = { ev["session_id"].GetString() };
-                store::GAStore::executeQuerySync("DELETE FROM ga_session WHERE session_id = ?;", params, 1);
+                BufferedEvent e;
+                snprintf(e.category, sizeof(e.category), "%s", ev["category"].GetString());
+                snprintf(e.sessionId, sizeof(e.sessionId), "%s", ev["session_id"].GetString());
+                snprintf(e.clientTs, sizeof(e.clientTs), "%" PRId64, clientTs);
+                e.event.assign(json, json + evBuffer.GetSize() + 1);
+
+                std::lock_guard<std::mutex> lock(i->bufferMutex);
+                i->bufferedEvents.push_back(std::move(e));
+                flush = isSessionEnd || !i->keepRunning || i->eventBufferDurabilityWindow <= 0 || static_cast<int>(i->bufferedEvents.size()) >= i->eventBufferSize;
             }
-            else
+
+            // a session_end always flushes, the session row is removed once it is stored
+            if (flush)
             {
-                GAEvents::updateSessionTime();
+                flushEventBuffer();
             }
         }
 
@@ -1179,18 +1344,68 @@ namespace gameanalytics
             }
         }
 
-        void GAEvents::addCustomFieldsToEvent(rapidjson::Document &eventData, rapidjson::Document &fields)
+        void GAEvents::addCustomFieldsToEvent(rapidjson::Document &eventData, const CustomFields& fields, bool mergeFields)
         {
             if(eventData.IsNull())
             {
                 return;
             }
 
-            if (fields.IsObject() && fields.MemberCount() > 0)
+            // fields are validated when they are created, so they are copied straight into the event
+            rapidjson::Document::AllocatorType& allocator = eventData.GetAllocator();
+            rapidjson::Value customFields(rapidjson::kObjectType);
+            CustomFields::Field field;
+            size_t position = 0;
+            while(fields.next(position, field))
+            {
+                addCustomFieldToObject(customFields, field, allocator);
+            }
+
+            // global fields are used when the event has none of its own, or merged in when asked for
+            if(fields.isEmpty() || mergeFields)
+            {
+                const CustomFields& globalFields = state::GAState::getGlobalCustomEventFields();
+                position = 0;
+                while(customFields.MemberCount() < static_cast<rapidjson::SizeType>(CustomFields::MaxCount) && globalFields.next(position, field))
+                {
+                    if(!fields.has(field.key))
+                    {
+                        addCustomFieldToObject(customFields, field, allocator);
+                    }
+                }
+            }
+
+            if(customFields.MemberCount() > 0)
+            {
+                eventData.AddMember("custom_fields", customFields.Move(), allocator);
+            }
+        }
+
+        void GAEvents::addCustomFieldToObject(rapidjson::Value& object, const CustomFields::Field& field, rapidjson::Document::AllocatorType& allocator)
+        {
+            rapidjson::Value key(field.key, allocator);
+            if(field.isNumber)
+            {
+                object.AddMember(key.Move(), field.number, allocator);
+            }
+            else
+            {
+                rapidjson::Value value(field.string, allocator);
+                object.AddMember(key.Move(), value.Move(), allocator);
+            }
+        }
+
+        void GAEvents::customFieldsToString(const rapidjson::Document& eventData, rapidjson::StringBuffer& out)
+        {
+            rapidjson::Writer<rapidjson::StringBuffer> writer(out);
+            if(eventData.IsObject() && eventData.HasMember("custom_fields"))
+            {
+                eventData["custom_fields"].Accept(writer);
+            }
+            else
             {
-                rapidjson::Value v(rapidjson::kObjectType);
-                v.CopyFrom(fields, fields.GetAllocator());
-                eventData.AddMember("custom_fields", v.Move(), eventData.GetAllocator());
+                writer.StartObject();
+                writer.EndObject();
             }
         }
 
@@ -6,9 +6,14 @@
 #pragma once
 
 #include "GameAnalytics.h"
+#include "GAHTTPApi.h"
+#include "GAStore.h"
 #include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
 #include <mutex>
 #include <cstdlib>
+#include <vector>
+#include <chrono>
 
 namespace gameanalytics
 {
@@ -21,16 +26,29 @@ namespace gameanalytics
             static void ensureEventQueueIsRunning();
             static void addSessionStartEvent();
             static void addSessionEndEvent();
-            static void addBusinessEvent(const char* currency, int amount, const char* itemType, const char* itemId, const char* cartType, const rapidjson::Value& fields, bool mergeFields);
-            static void addResourceEvent(EGAResourceFlowType flowType, const char* currency, double amount, const char* itemType, const char* itemId, const rapidjson::Value& fields, bool mergeFields);
-            static void addProgressionEvent(EGAProgressionStatus progressionStatus, const char* progression01, const char* progression02, const char* progression03, int score, bool sendScore, const rapidjson::Value& fields, bool mergeFields);
-            static void addDesignEvent(const char* eventId, double value, bool sendValue, const rapidjson::Value& fields, bool mergeFields);
-            static void addErrorEvent(EGAErrorSeverity severity, const char* message, const rapidjson::Value& fields, bool mergeFields);
-            static void addErrorEvent(EGAErrorSeverity severity, const char* message, const rapidjson::Value& fields, bool mergeFields, bool skipAddingFields);
+            static void addBusinessEvent(const char* currency, int amount, const char* itemType, const char* itemId, const char* cartType, const CustomFields& fields, bool mergeFields);
+            static void addResourceEvent(EGAResourceFlowType flowType, const char* currency, double amount, const char* itemType, const char* itemId, const CustomFields& fields, bool mergeFields);
+            static void addProgressionEvent(EGAProgressionStatus progressionStatus, const char* progression01, const char* progression02, const char* progression03, int score, bool sendScore, const CustomFields& fields, bool mergeFields);
+            static void addDesignEvent(const char* eventId, double value, bool sendValue, const CustomFields& fields, bool mergeFields);
+            static void addErrorEvent(EGAErrorSeverity severity, const char* message, const CustomFields& fields, bool mergeFields);
+            static void addErrorEvent(EGAErrorSeverity severity, const char* message, const CustomFields& fields, bool mergeFields, bool skipAddingFields);
             static void progressionStatusString(EGAProgressionStatus progressionStatus, char* out);
             static void errorSeverityString(EGAErrorSeverity errorSeverity, char* out);
             static void resourceFlowTypeString(EGAResourceFlowType flowType, char* out);
             static void processEvents(const char* category, bool performCleanUp);
+            // without waitForResponse the request is sent in the background and its events are
+            // deleted or put back once the response arrives
+            static void processEvents(const char* category, bool performCleanUp, bool waitForResponse);
+
+            // write-behind buffer for event inserts, a window of 0 writes every event right away
+            static void setEventBufferDurabilityWindow(double seconds);
+            static void setEventBufferSize(int eventCount);
+            // false when the events could not be written, they stay buffered (up to MaxBufferedEventCount) for the next flush
+            static bool flushEventBuffer();
+            // claims the oldest MaxEventCount new events (of category, unless it is empty) for batchId and passes them to
+            // readEvent in insert order, in one transaction. returns false, with nothing claimed, when the claim or reading
+            // the rows fails or readEvent returns false
+            static bool claimEvents(const char* category, const char* batchId, const store::GAStore::RowVisitor& readEvent);
 
         private:
             GAEvents();
@@ -43,8 +61,24 @@ namespace gameanalytics
             static void fixMissingSessionEndEvents();
             static void addEventToStore(rapidjson::Document &eventData);
             static void addDimensionsToEvent(rapidjson::Document& eventData);
-            static void addCustomFieldsToEvent(rapidjson::Document& eventData, rapidjson::Document& fields);
+            static void addCustomFieldsToEvent(rapidjson::Document& eventData, const CustomFields& fields, bool mergeFields);
+            static void addCustomFieldToObject(rapidjson::Value& object, const CustomFields::Field& field, rapidjson::Document::AllocatorType& allocator);
+            static void customFieldsToString(const rapidjson::Document& eventData, rapidjson::StringBuffer& out);
             static void updateSessionTime();
+            // the session row is written at most every SessionTimeIntervalInSeconds, and when the queue stops
+            static void markSessionTimeDirty();
+            static void flushSessionTime(bool force);
+            static double getEventQueueTickInSeconds();
+            static void processEventsResponse(http::EGAHTTPApiResponse responseEnum, const rapidjson::Value& dataDict, int sentCount, const char* batchId);
+            static int64_t nextBatchId();
+
+            struct BufferedEvent
+            {
+                char category[33];
+                char sessionId[65];
+                char clientTs[21];
+                std::vector<char> event;
+            };
 
             static const char* CategorySessionStart;
             static const char* CategorySessionEnd;
@@ -54,7 +88,14 @@ namespace gameanalytics
             static const char* CategoryResource;
             static const char* CategoryError;
             static const double ProcessEventsIntervalInSeconds;
+            static const double SessionTimeIntervalInSeconds;
             static const int MaxEventCount;
+            static const double DefaultEventBufferDurabilityWindowInSeconds;
+            static const int DefaultEventBufferSize;
+            static const int MaxBufferedEventCount;
+            static const int MaxEventsRequestsInFlight;
+            static const char* DeleteBatchSql;
+            static const char* PutbackBatchSql;
 
             static bool _destroyed;
             static GAEvents* _instance;
@@ -73,6 +114,18 @@ namespace gameanalytics
 
             bool isRunning;
             bool keepRunning;
+            std::chrono::steady_clock::time_point nextProcessEventsTime;
+            // -1 until read from the store
+            int64_t lastBatchId;
+            // set when the session row is behind, written by flushSessionTime
+            bool sessionTimeDirty;
+            std::chrono::steady_clock::time_point nextSessionTimeUpdate;
+
+            // events not yet written to the store, guarded by bufferMutex
+            std::vector<BufferedEvent> bufferedEvents;
+            double eventBufferDurabilityWindow;
+            int eventBufferSize;
+            std::mutex bufferMutex;
         };
     }
 }
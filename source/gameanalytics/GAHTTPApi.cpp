@@ -9,7 +9,9 @@
 #include "GALogger.h"
 #include "GAUtilities.h"
 #include "GAValidator.h"
+#include "GAThreading.h"
 #include <future>
+#include <algorithm>
 #include <utility>
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/prettywriter.h"
@@ -19,7 +21,6 @@
 #if USE_TIZEN
 #include <net_connection.h>
 #endif
-#include <array>
 
 namespace gameanalytics
 {
@@ -40,6 +41,10 @@ namespace gameanalytics
         char GAHTTPApi::initializeUrlPath[5] = "init";
         char GAHTTPApi::eventsUrlPath[7] = "events";
 
+        const long GAHTTPApi::DnsCacheTimeoutInSeconds = 300;
+        const int GAHTTPApi::TransferPollTimeoutInMs = 1000;
+        const size_t GAHTTPApi::MaxFreePayloadBuffers = 4;
+
         void initResponseData(struct ResponseData *s)
         {
             s->len = 0;
@@ -71,7 +76,7 @@ namespace gameanalytics
         std::once_flag GAHTTPApi::_initInstanceFlag;
 
         // Constructor - setup the basic information for HTTP
-        GAHTTPApi::GAHTTPApi()
+        GAHTTPApi::GAHTTPApi() :sdkErrorQueue(MaxCount, MaxQueuedSdkErrors)
         {
             curl_global_init(CURL_GLOBAL_DEFAULT);
 
@@ -83,10 +88,72 @@ namespace gameanalytics
 #else
             useGzip = true;
 #endif
+            compressionLevel = utilities::GAGzipCompressor::BestCompression;
+            eventsPayloadSize = 0;
+
+            // DNS results, TLS sessions and open connections are shared by every handle
+            curlShare = curl_share_init();
+            if (curlShare)
+            {
+                curl_share_setopt(curlShare, CURLSHOPT_LOCKFUNC, &GAHTTPApi::lockShare);
+                curl_share_setopt(curlShare, CURLSHOPT_UNLOCKFUNC, &GAHTTPApi::unlockShare);
+                curl_share_setopt(curlShare, CURLSHOPT_USERDATA, this);
+                curl_share_setopt(curlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+                curl_share_setopt(curlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+                curl_share_setopt(curlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+            }
+            curlHandle = NULL;
+            requestCount = 0;
+            reusedConnectionCount = 0;
+            curlMulti = curl_multi_init();
+            eventsRequestsInFlight = 0;
+            stopTransfers = false;
+            stopSdkErrorSender = false;
         }
 
         GAHTTPApi::~GAHTTPApi()
         {
+            {
+                std::lock_guard<std::mutex> lock(sdkErrorMutex);
+                stopSdkErrorSender = true;
+            }
+            sdkErrorCondition.notify_one();
+            if (sdkErrorThread.joinable())
+            {
+                sdkErrorThread.join();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(requestsMutex);
+                stopTransfers = true;
+            }
+            if (transferThread.joinable())
+            {
+#if LIBCURL_VERSION_NUM >= 0x074400
+                curl_multi_wakeup(curlMulti);
+#endif
+                transferThread.join();
+            }
+            for (EventsRequest* request : pendingRequests)
+            {
+                releaseEventsRequest(request);
+                delete request;
+            }
+            for (EventsRequest* request : completedRequests)
+            {
+                delete request;
+            }
+            curl_multi_cleanup(curlMulti);
+            if (curlHandle)
+            {
+                curl_easy_cleanup(curlHandle);
+            }
+            if (curlShare)
+            {
+                curl_share_cleanup(curlShare);
+            }
             curl_global_cleanup();
         }
 
@@ -132,25 +199,8 @@ namespace gameanalytics
                 return;
             }
 
-            std::vector<char> payloadData = createPayloadData(JSONstring, useGzip);
+            std::vector<char> payloadData = createPayloadData(JSONstring, useGzip, compressionLevel);
 
-            CURL *curl;
-            CURLcode res;
-            curl = curl_easy_init();
-            if(!curl)
-            {
-                response_out = NoResponse;
-                json_out.SetNull();
-                return;
-            }
-
-            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-
-            struct ResponseData s;
-            initResponseData(&s);
-
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writefunc);
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &s);
 #if USE_TIZEN
             connection_h connection;
             int conn_err;
@@ -163,21 +213,28 @@ namespace gameanalytics
             }
 #endif
 
-            std::vector<char> authorization = createRequest(curl, url, payloadData, useGzip);
+            struct ResponseData s;
+            initResponseData(&s);
+            long response_code = 0;
+            std::vector<char> authorization;
 
-            res = curl_easy_perform(curl);
+            CURLcode res;
+            {
+                std::lock_guard<std::mutex> lock(curlMutex);
+                res = performRequest(getCurlHandle(), url, payloadData, useGzip, "Init", &s, response_code, authorization);
+            }
             if(res != CURLE_OK)
             {
                 logging::GALogger::d(curl_easy_strerror(res));
+                free(s.ptr);
+#if USE_TIZEN
+                connection_destroy(connection);
+#endif
                 response_out = NoResponse;
                 json_out.SetNull();
                 return;
             }
 
-            long response_code;
-            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
-            curl_easy_cleanup(curl);
-
             // process the response
             logging::GALogger::d("init request content: %s, JSONString: %s", s.ptr, JSONstring);
 
@@ -217,10 +274,13 @@ namespace gameanalytics
             // print reason if bad request
             if (requestResponseEnum == BadRequest)
             {
-                rapidjson::StringBuffer buffer;
-                rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
-                requestJsonDict.Accept(writer);
-                logging::GALogger::d("Failed Init Call. Bad request. Response: %s", buffer.GetString());
+                if (logging::GALogger::isDebugEnabled())
+                {
+                    rapidjson::StringBuffer buffer;
+                    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+                    requestJsonDict.Accept(writer);
+                    logging::GALogger::d("Failed Init Call. Bad request. Response: %s", buffer.GetString());
+                }
                 // return bad request result
 #if USE_TIZEN
                 connection_destroy(connection);
@@ -259,50 +319,94 @@ namespace gameanalytics
                 return;
             }
 
+            // make JSON string from data
+            rapidjson::StringBuffer buffer;
+            {
+                rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+                eventArray.Accept(writer);
+            }
+
+            sendEventsInArray(response_out, json_out, buffer.GetString());
+        }
+
+        void GAHTTPApi::sendEventsInArray(EGAHTTPApiResponse& response_out, rapidjson::Value& json_out, const char* jsonArray)
+        {
+            beginEventsPayload();
+            writeEventsPayload(jsonArray, strlen(jsonArray));
+            sendEventsPayload(response_out, json_out);
+        }
+
+        void GAHTTPApi::beginEventsPayload()
+        {
+            eventsPayloadSize = 0;
+            if (eventsPayloadData.capacity() == 0)
+            {
+                std::lock_guard<std::mutex> lock(requestsMutex);
+                if (!freePayloadBuffers.empty())
+                {
+                    eventsPayloadData.swap(freePayloadBuffers.back());
+                    freePayloadBuffers.pop_back();
+                }
+            }
+            if (useGzip)
+            {
+                eventsCompressor.begin(eventsPayloadData, compressionLevel);
+            }
+            else
+            {
+                eventsPayloadData.clear();
+            }
+        }
+
+        void GAHTTPApi::writeEventsPayload(const char* data, size_t size)
+        {
+            eventsPayloadSize += size;
+            if (useGzip)
+            {
+                eventsCompressor.write(data, size);
+            }
+            else
+            {
+                eventsPayloadData.insert(eventsPayloadData.end(), data, data + size);
+            }
+        }
+
+        bool GAHTTPApi::prepareEventsPayload(char* url, size_t urlSize)
+        {
             auto gameKey = state::GAState::getGameKey();
 
             // Generate URL
-            char url[513] = "";
-            snprintf(url, sizeof(url), "%s/%s/%s", baseUrl, gameKey, eventsUrlPath);
+            snprintf(url, urlSize, "%s/%s/%s", baseUrl, gameKey, eventsUrlPath);
 
             logging::GALogger::d("Sending 'events' URL: %s", url);
 
-            // make JSON string from data
-            rapidjson::StringBuffer buffer;
+            if (useGzip)
             {
-                rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-                eventArray.Accept(writer);
+                eventsCompressor.finish();
+                logging::GALogger::d("Gzip stats. Size: %lu, Compressed: %lu", eventsPayloadSize, eventsPayloadData.size());
             }
 
-            const char* JSONstring = buffer.GetString();
-
-            if (strlen(JSONstring) == 0)
+            if (eventsPayloadSize == 0 || eventsPayloadData.empty())
             {
                 logging::GALogger::d("sendEventsInArray JSON encoding failed of eventArray");
-                response_out = JsonEncodeFailed;
-                json_out.SetNull();;
-                return;
+                return false;
             }
 
-            std::vector<char> payloadData = createPayloadData(JSONstring, useGzip);
+            return true;
+        }
 
-            CURL *curl;
-            CURLcode res;
-            curl = curl_easy_init();
-            if(!curl)
+        void GAHTTPApi::sendEventsPayload(EGAHTTPApiResponse& response_out, rapidjson::Value& json_out)
+        {
+            char url[513] = "";
+            if (!prepareEventsPayload(url, sizeof(url)))
             {
-                response_out = NoResponse;
-                json_out.SetNull();
+                response_out = JsonEncodeFailed;
+                json_out.SetNull();;
                 return;
             }
 
-            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+            const std::vector<char>& payloadData = eventsPayloadData;
 
-            struct ResponseData s;
-            initResponseData(&s);
-
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writefunc);
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &s);
 #if USE_TIZEN
             connection_h connection;
             int conn_err;
@@ -314,77 +418,279 @@ namespace gameanalytics
                 return;
             }
 #endif
-            std::vector<char> authorization = createRequest(curl, url, payloadData, useGzip);
 
-            res = curl_easy_perform(curl);
+            struct ResponseData s;
+            initResponseData(&s);
+            long response_code = 0;
+            std::vector<char> authorization;
+
+            CURLcode res;
+            {
+                std::lock_guard<std::mutex> lock(curlMutex);
+                res = performRequest(getCurlHandle(), url, payloadData, useGzip, "Events", &s, response_code, authorization);
+            }
+#if USE_TIZEN
+            connection_destroy(connection);
+#endif
             if(res != CURLE_OK)
             {
                 logging::GALogger::d(curl_easy_strerror(res));
+                free(s.ptr);
                 response_out = NoResponse;
                 json_out.SetNull();
                 return;
             }
 
-            long response_code;
-            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
-            curl_easy_cleanup(curl);
+            rapidjson::Document requestJsonDict;
+            response_out = processEventsResponse(response_code, s.ptr, url, payloadData, authorization.data(), requestJsonDict);
+            free(s.ptr);
 
-            logging::GALogger::d("body: %s", s.ptr);
+            // return response
+            if (requestJsonDict.IsNull())
+            {
+                json_out = rapidjson::Value();
+            }
+            else
+            {
+                json_out.CopyFrom(requestJsonDict, requestJsonDict.GetAllocator());
+            }
+        }
 
-            EGAHTTPApiResponse requestResponseEnum = processRequestResponse(response_code, s.ptr, "Events");
+        EGAHTTPApiResponse GAHTTPApi::processEventsResponse(long statusCode, const char* body, const char* url, const std::vector<char>& payloadData, const char* authorization, rapidjson::Document& json_out)
+        {
+            logging::GALogger::d("body: %s", body);
+
+            EGAHTTPApiResponse requestResponseEnum = processRequestResponse(statusCode, body, "Events");
 
             // if not 200 result
             if (requestResponseEnum != Ok && requestResponseEnum != Created && requestResponseEnum != BadRequest)
             {
-                logging::GALogger::d("Failed Events Call. URL: %s, JSONString: %s, Authorization: %s", url, JSONstring, authorization.data());
-#if USE_TIZEN
-                connection_destroy(connection);
-#endif
-                response_out = requestResponseEnum;
-                json_out = rapidjson::Value();
+                if (useGzip)
+                {
+                    logging::GALogger::d("Failed Events Call. URL: %s, Compressed JSON size: %lu, Authorization: %s", url, payloadData.size(), authorization);
+                }
+                else
+                {
+                    logging::GALogger::d("Failed Events Call. URL: %s, JSONString: %.*s, Authorization: %s", url, static_cast<int>(payloadData.size()), payloadData.data(), authorization);
+                }
             }
 
             // decode JSON
-            rapidjson::Document requestJsonDict;
-            rapidjson::ParseResult ok = requestJsonDict.Parse(s.ptr);
+            rapidjson::ParseResult ok = json_out.Parse(body);
             if(!ok)
             {
                 logging::GALogger::d("sendEventsInArray -- JSON error (offset %u): %s", (unsigned)ok.Offset(), GetParseError_En(ok.Code()));
-                logging::GALogger::d("%s", s.ptr);
+                logging::GALogger::d("%s", body);
+                json_out.SetNull();
             }
-            free(s.ptr);
 
-            if (requestJsonDict.IsNull())
+            if (json_out.IsNull())
             {
-#if USE_TIZEN
-                connection_destroy(connection);
-#endif
-                response_out = JsonDecodeFailed;
-                json_out = rapidjson::Value();
-                return;
+                return JsonDecodeFailed;
             }
 
             // print reason if bad request
             if (requestResponseEnum == BadRequest)
             {
-                rapidjson::StringBuffer buffer;
-                rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
-                requestJsonDict.Accept(writer);
+                if (logging::GALogger::isDebugEnabled())
+                {
+                    rapidjson::StringBuffer buffer;
+                    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+                    json_out.Accept(writer);
+                    logging::GALogger::d("Failed Events Call. Bad request. Response: %s", buffer.GetString());
+                }
 
-                logging::GALogger::d("Failed Events Call. Bad request. Response: %s", buffer.GetString());
+                json_out.SetNull();
+                return requestResponseEnum;
+            }
 
-                response_out = requestResponseEnum;
-                json_out = rapidjson::Value();
-                return;
+            if (requestResponseEnum != Ok && requestResponseEnum != Created)
+            {
+                json_out.SetNull();
+            }
+
+            return requestResponseEnum;
+        }
+
+        bool GAHTTPApi::sendEventsPayloadAsync(const ResponseCallback& callback)
+        {
+            EventsRequest* request = new EventsRequest();
+            if (!prepareEventsPayload(request->url, sizeof(request->url)))
+            {
+                delete request;
+                return false;
+            }
+
+            request->curl = createCurlHandle();
+            if (!request->curl)
+            {
+                delete request;
+                return false;
             }
 
 #if USE_TIZEN
-            connection_destroy(connection);
+            int conn_err = connection_create(&request->connection);
+            if (conn_err != CONNECTION_ERROR_NONE)
+            {
+                curl_easy_cleanup(request->curl);
+                delete request;
+                return false;
+            }
 #endif
 
-            // return response
-            response_out = requestResponseEnum;
-            json_out.CopyFrom(requestJsonDict, requestJsonDict.GetAllocator());
+            // the request owns the body until it completes, the buffer comes back through freePayloadBuffers
+            request->payloadData.swap(eventsPayloadData);
+            request->callback = callback;
+            request->authorization = createRequest(request->curl, request->url, request->payloadData, useGzip, request->headers);
+            initResponseData(&request->response);
+            curl_easy_setopt(request->curl, CURLOPT_WRITEDATA, &request->response);
+            curl_easy_setopt(request->curl, CURLOPT_PRIVATE, request);
+
+            ++eventsRequestsInFlight;
+            {
+                std::lock_guard<std::mutex> lock(requestsMutex);
+                pendingRequests.push_back(request);
+                if (!transferThread.joinable())
+                {
+                    transferThread = std::thread(&GAHTTPApi::runTransfers, this);
+                }
+            }
+#if LIBCURL_VERSION_NUM >= 0x074400
+            curl_multi_wakeup(curlMulti);
+#endif
+            return true;
+        }
+
+        void GAHTTPApi::runCompletedRequestCallbacks()
+        {
+            std::vector<EventsRequest*> completed;
+            {
+                std::lock_guard<std::mutex> lock(requestsMutex);
+                completed.swap(completedRequests);
+            }
+
+            for (EventsRequest* request : completed)
+            {
+                request->callback(request->responseEnum, request->responseJson);
+                delete request;
+                --eventsRequestsInFlight;
+            }
+        }
+
+        int GAHTTPApi::getEventsRequestsInFlight()
+        {
+            return eventsRequestsInFlight;
+        }
+
+        void GAHTTPApi::runTransfers()
+        {
+            std::vector<EventsRequest*> activeRequests;
+
+            while (true)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(requestsMutex);
+                    if (stopTransfers)
+                    {
+                        break;
+                    }
+                    for (EventsRequest* request : pendingRequests)
+                    {
+                        curl_multi_add_handle(curlMulti, request->curl);
+                        activeRequests.push_back(request);
+                    }
+                    pendingRequests.clear();
+                }
+
+                int runningHandles = 0;
+                curl_multi_perform(curlMulti, &runningHandles);
+
+                CURLMsg* message;
+                int messagesLeft = 0;
+                bool hasCompleted = false;
+                while ((message = curl_multi_info_read(curlMulti, &messagesLeft)))
+                {
+                    if (message->msg != CURLMSG_DONE)
+                    {
+                        continue;
+                    }
+
+                    EventsRequest* request = NULL;
+                    curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &request);
+                    CURLcode res = message->data.result;
+                    curl_multi_remove_handle(curlMulti, request->curl);
+                    activeRequests.erase(std::remove(activeRequests.begin(), activeRequests.end(), request), activeRequests.end());
+
+                    completeEventsRequest(request, res);
+                    hasCompleted = true;
+                }
+
+                if (hasCompleted)
+                {
+                    // callbacks run on the GA thread, the event queue also picks them up in case this task is dropped
+                    threading::GAThreading::performTaskOnGAThread([]()
+                    {
+                        GAHTTPApi* http = GAHTTPApi::getInstance();
+                        if (http)
+                        {
+                            http->runCompletedRequestCallbacks();
+                        }
+                    });
+                }
+
+#if LIBCURL_VERSION_NUM >= 0x074400
+                curl_multi_poll(curlMulti, NULL, 0, TransferPollTimeoutInMs, NULL);
+#else
+                curl_multi_wait(curlMulti, NULL, 0, 100, NULL);
+#endif
+            }
+
+            // shutting down, requests still in flight are left as they are in the store and sent again next session
+            for (EventsRequest* request : activeRequests)
+            {
+                curl_multi_remove_handle(curlMulti, request->curl);
+                releaseEventsRequest(request);
+                delete request;
+            }
+        }
+
+        void GAHTTPApi::completeEventsRequest(EventsRequest* request, CURLcode res)
+        {
+            if (res == CURLE_OK)
+            {
+                long statusCode = 0;
+                curl_easy_getinfo(request->curl, CURLINFO_RESPONSE_CODE, &statusCode);
+                recordConnectionStats(request->curl, "Events");
+                request->responseEnum = processEventsResponse(statusCode, request->response.ptr, request->url, request->payloadData, request->authorization.data(), request->responseJson);
+            }
+            else
+            {
+                logging::GALogger::d(curl_easy_strerror(res));
+                request->responseEnum = NoResponse;
+            }
+            releaseEventsRequest(request);
+
+            std::lock_guard<std::mutex> lock(requestsMutex);
+            if (freePayloadBuffers.size() < MaxFreePayloadBuffers)
+            {
+                request->payloadData.clear();
+                freePayloadBuffers.push_back(std::vector<char>());
+                freePayloadBuffers.back().swap(request->payloadData);
+            }
+            completedRequests.push_back(request);
+        }
+
+        void GAHTTPApi::releaseEventsRequest(EventsRequest* request)
+        {
+            curl_easy_cleanup(request->curl);
+            request->curl = NULL;
+            curl_slist_free_all(request->headers);
+            request->headers = NULL;
+            free(request->response.ptr);
+            request->response.ptr = NULL;
+#if USE_TIZEN
+            connection_destroy(request->connection);
+#endif
         }
 
         void GAHTTPApi::sendSdkErrorEvent(EGASdkErrorCategory category, EGASdkErrorArea area, EGASdkErrorAction action, EGASdkErrorParameter parameter, const char* reason, const char* gameKey, const char* secretKey)
@@ -400,13 +706,6 @@ namespace gameanalytics
                 return;
             }
 
-            // Generate URL
-
-            std::array<char, 257> url = {'\0'};
-            snprintf(url.data(), url.size(), "%s/%s/%s", baseUrl, gameKey, eventsUrlPath);
-
-            logging::GALogger::d("Sending 'events' URL: %s", url);
-
             rapidjson::Document json;
             json.SetObject();
             state::GAState::getSdkErrorEventAnnotations(json);
@@ -446,128 +745,277 @@ namespace gameanalytics
                 json.AddMember("reason", v.Move(), json.GetAllocator());
             }
 
-            rapidjson::Document eventArray;
-            eventArray.SetArray();
-            rapidjson::Document::AllocatorType& allocator = eventArray.GetAllocator();
-            eventArray.PushBack(json, allocator);
             rapidjson::StringBuffer buffer;
             {
                 rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-                eventArray.Accept(writer);
+                json.Accept(writer);
             }
-            std::array<char, 10000> payloadJSONString = {'\0'};
-            snprintf(payloadJSONString.data(), payloadJSONString.size(), "%s", buffer.GetString());
 
-            if(strlen(payloadJSONString.data()) == 0)
+            if(buffer.GetSize() == 0)
             {
                 logging::GALogger::w("sendSdkErrorEvent: JSON encoding failed.");
                 return;
             }
 
-            logging::GALogger::d("sendSdkErrorEvent json: %s", payloadJSONString.data());
-
-            ErrorType errorType = std::make_tuple(category, area);
+            logging::GALogger::d("sendSdkErrorEvent json: %s", buffer.GetString());
 
 #if !NO_ASYNC
-            bool useGzip = this->useGzip;
+            SdkErrorEvent errorEvent;
+            errorEvent.type = std::make_tuple(category, area);
+            errorEvent.action = action;
+            errorEvent.gameKey = gameKey;
+            errorEvent.json.assign(buffer.GetString(), buffer.GetSize());
+
+            std::lock_guard<std::mutex> lock(sdkErrorMutex);
+            if (stopSdkErrorSender)
+            {
+                return;
+            }
 
-            std::async(std::launch::async, [url, payloadJSONString, useGzip, errorType]() -> void
+            switch (sdkErrorQueue.push(errorEvent, utilities::GAUtilities::timeIntervalSince1970()))
             {
-                int64_t now = utilities::GAUtilities::timeIntervalSince1970();
-                if(timestampMap.count(errorType) == 0)
-                {
-                    timestampMap[errorType] = now;
-                }
-                if(countMap.count(errorType) == 0)
+                case GASdkErrorQueue::RateLimited:
+                    return;
+                case GASdkErrorQueue::AlreadyQueued:
+                    // the same error waiting to be sent already tells the whole story
+                    logging::GALogger::d("sendSdkErrorEvent: same error already queued, skipping");
+                    return;
+                case GASdkErrorQueue::QueueFull:
+                    logging::GALogger::d("sendSdkErrorEvent: queue is full, dropping error");
+                    return;
+                default:
+                    break;
+            }
+
+            if (!sdkErrorThread.joinable())
+            {
+                sdkErrorThread = std::thread(&GAHTTPApi::runSdkErrorSender, this);
+            }
+            sdkErrorCondition.notify_one();
+#endif
+        }
+
+        void GAHTTPApi::runSdkErrorSender()
+        {
+            // only used by this thread, connections are still shared with the other handles
+            CURL* curl = NULL;
+
+            while (true)
+            {
+                std::vector<SdkErrorEvent> events;
                 {
-                    countMap[errorType] = 0;
+                    std::unique_lock<std::mutex> lock(sdkErrorMutex);
+                    sdkErrorCondition.wait(lock, [this]() { return stopSdkErrorSender || !sdkErrorQueue.isEmpty(); });
+                    if (stopSdkErrorSender)
+                    {
+                        if (!sdkErrorQueue.isEmpty())
+                        {
+                            logging::GALogger::d("runSdkErrorSender: stopping, dropping %lu queued sdk errors", static_cast<unsigned long>(sdkErrorQueue.size()));
+                        }
+                        break;
+                    }
+                    sdkErrorQueue.takeAll(events);
                 }
 
-                int64_t diff = now - timestampMap[errorType];
-                if(diff >= 3600)
+                if (!curl)
                 {
-                    countMap[errorType] = 0;
-                    timestampMap[errorType] = now;
+                    curl = createCurlHandle();
+                    if (curl)
+                    {
+                        curl_easy_setopt(curl, CURLOPT_TIMEOUT, SdkErrorRequestTimeoutInSeconds);
+                        // stopping shouldn't wait for the timeout
+                        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+#if LIBCURL_VERSION_NUM >= 0x072000
+                        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, &GAHTTPApi::sdkErrorProgress);
+                        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, this);
+#else
+                        curl_easy_setopt(curl, CURLOPT_PROGRESSFUNCTION, &GAHTTPApi::sdkErrorProgress);
+                        curl_easy_setopt(curl, CURLOPT_PROGRESSDATA, this);
+#endif
+                    }
                 }
 
-                if(countMap[errorType] >= MaxCount)
+                // everything queued for the same game goes out in one request
+                while (!events.empty())
                 {
-                    return;
+                    const std::string gameKey = events.front().gameKey;
+                    std::vector<SdkErrorEvent> sent;
+                    std::string payloadJSONString = "[";
+                    for (size_t i = 0; i < events.size();)
+                    {
+                        if (events[i].gameKey != gameKey)
+                        {
+                            ++i;
+                            continue;
+                        }
+                        if (!sent.empty())
+                        {
+                            payloadJSONString += ",";
+                        }
+                        payloadJSONString += events[i].json;
+                        sent.push_back(events[i]);
+                        events.erase(events.begin() + i);
+                    }
+                    payloadJSONString += "]";
+
+                    if (!curl || !sendSdkErrorPayload(curl, gameKey.c_str(), payloadJSONString.c_str()))
+                    {
+                        std::lock_guard<std::mutex> lock(sdkErrorMutex);
+                        sdkErrorQueue.sendFailed(sent);
+                    }
                 }
+            }
 
-                std::vector<char> payloadData = GAHTTPApi::getInstance()->createPayloadData(payloadJSONString.data(), useGzip);
+            if (curl)
+            {
+                curl_easy_cleanup(curl);
+            }
+        }
 
-                CURL *curl;
-                CURLcode res;
-                curl = curl_easy_init();
-                if(!curl)
-                {
-                    return;
-                }
+        bool GAHTTPApi::sendSdkErrorPayload(CURL* curl, const char* gameKey, const char* payloadJSONString)
+        {
+            char url[513] = "";
+            snprintf(url, sizeof(url), "%s/%s/%s", baseUrl, gameKey, eventsUrlPath);
 
-                curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+            logging::GALogger::d("Sending 'events' URL: %s", url);
 
-                struct ResponseData s;
-                initResponseData(&s);
+            std::vector<char> payloadData = createPayloadData(payloadJSONString, useGzip, compressionLevel);
 
-                curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writefunc);
-                curl_easy_setopt(curl, CURLOPT_WRITEDATA, &s);
 #if USE_TIZEN
-                connection_h connection;
-                int conn_err;
-                conn_err = connection_create(&connection);
-                if (conn_err != CONNECTION_ERROR_NONE)
-                {
-                    return;
-                }
+            connection_h connection;
+            int conn_err;
+            conn_err = connection_create(&connection);
+            if (conn_err != CONNECTION_ERROR_NONE)
+            {
+                return false;
+            }
+#endif
+
+            struct ResponseData s;
+            initResponseData(&s);
+            long statusCode = 0;
+            std::vector<char> authorization;
+
+            CURLcode res = performRequest(curl, url, payloadData, useGzip, "SdkError", &s, statusCode, authorization);
+#if USE_TIZEN
+            connection_destroy(connection);
+#endif
+            if(res != CURLE_OK)
+            {
+                logging::GALogger::d(curl_easy_strerror(res));
+                free(s.ptr);
+                return false;
+            }
+
+            // process the response
+            logging::GALogger::d("sdk error content : %s", s.ptr);
+            free(s.ptr);
+
+            // if not 200 result
+            if (statusCode != 200)
+            {
+                logging::GALogger::d("sdk error failed. response code not 200. status code: %ld", statusCode);
+                return false;
+            }
+
+            return true;
+        }
+
+#if LIBCURL_VERSION_NUM >= 0x072000
+        int GAHTTPApi::sdkErrorProgress(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+#else
+        int GAHTTPApi::sdkErrorProgress(void* clientp, double dltotal, double dlnow, double ultotal, double ulnow)
 #endif
-                GAHTTPApi::getInstance()->createRequest(curl, url.data(), payloadData, useGzip);
+        {
+            (void)dltotal;
+            (void)dlnow;
+            (void)ultotal;
+            (void)ulnow;
+            // non zero aborts the transfer
+            return static_cast<GAHTTPApi*>(clientp)->stopSdkErrorSender ? 1 : 0;
+        }
+
+        const int GAHTTPApi::MaxCount = 10;
+        const size_t GAHTTPApi::MaxQueuedSdkErrors = 20;
+        const long GAHTTPApi::SdkErrorRequestTimeoutInSeconds = 30;
+
+        GASdkErrorQueue::GASdkErrorQueue(int maxCountPerHour, size_t maxQueued) :
+            maxCountPerHour(maxCountPerHour),
+            maxQueued(maxQueued)
+        {
+        }
+
+        GASdkErrorQueue::PushResult GASdkErrorQueue::push(const SdkErrorEvent& errorEvent, int64_t now)
+        {
+            if(timestampMap.count(errorEvent.type) == 0 || now - timestampMap[errorEvent.type] >= 3600)
+            {
+                countMap[errorEvent.type] = 0;
+                timestampMap[errorEvent.type] = now;
+            }
 
-                res = curl_easy_perform(curl);
-                if(res != CURLE_OK)
+            if(countMap[errorEvent.type] >= maxCountPerHour)
+            {
+                return RateLimited;
+            }
+
+            for (const SdkErrorEvent& queued : queue)
+            {
+                if (queued.type == errorEvent.type && queued.action == errorEvent.action && queued.gameKey == errorEvent.gameKey)
                 {
-                    logging::GALogger::d(curl_easy_strerror(res));
-                    return;
+                    return AlreadyQueued;
                 }
+            }
 
-                long statusCode;
-                curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &statusCode);
-                curl_easy_cleanup(curl);
+            if (queue.size() >= maxQueued)
+            {
+                return QueueFull;
+            }
 
-                // process the response
-                logging::GALogger::d("sdk error content : %s", s.ptr);
-                free(s.ptr);
+            queue.push_back(errorEvent);
+            countMap[errorEvent.type] = countMap[errorEvent.type] + 1;
+            return Queued;
+        }
+
+        void GASdkErrorQueue::takeAll(std::vector<SdkErrorEvent>& events_out)
+        {
+            events_out.clear();
+            events_out.swap(queue);
+        }
 
-                // if not 200 result
-                if (statusCode != 200)
+        void GASdkErrorQueue::sendFailed(const std::vector<SdkErrorEvent>& events)
+        {
+            for (const SdkErrorEvent& errorEvent : events)
+            {
+                std::map<ErrorType, int>::iterator count = countMap.find(errorEvent.type);
+                if (count != countMap.end() && count->second > 0)
                 {
-                    logging::GALogger::d("sdk error failed. response code not 200. status code: %u", CURLE_OK);
-#if USE_TIZEN
-                    connection_destroy(connection);
-#endif
-                    return;
+                    --count->second;
                 }
+            }
+        }
 
-#if USE_TIZEN
-                connection_destroy(connection);
-#endif
+        bool GASdkErrorQueue::isEmpty() const
+        {
+            return queue.empty();
+        }
 
-                countMap[errorType] = countMap[errorType] + 1;
-            });
-#endif
+        size_t GASdkErrorQueue::size() const
+        {
+            return queue.size();
         }
 
-        const int GAHTTPApi::MaxCount = 10;
-        std::map<ErrorType, int> GAHTTPApi::countMap = std::map<ErrorType, int>();
-        std::map<ErrorType, int64_t> GAHTTPApi::timestampMap = std::map<ErrorType, int64_t>();
+        void GAHTTPApi::setCompressionLevel(int level)
+        {
+            compressionLevel = level;
+        }
 
-        std::vector<char> GAHTTPApi::createPayloadData(const char* payload, bool gzip)
+        std::vector<char> GAHTTPApi::createPayloadData(const char* payload, bool gzip, int level)
         {
             std::vector<char> payloadData;
 
             if (gzip)
             {
-                payloadData = utilities::GAUtilities::gzipCompress(payload);
+                payloadData = utilities::GAUtilities::gzipCompress(payload, level);
 
                 logging::GALogger::d("Gzip stats. Size: %lu, Compressed: %lu", strlen(payload), payloadData.size());
             }
@@ -584,11 +1032,97 @@ namespace gameanalytics
             return payloadData;
         }
 
-        std::vector<char> GAHTTPApi::createRequest(CURL *curl, const char* url, const std::vector<char>& payloadData, bool gzip)
+        void GAHTTPApi::lockShare(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr)
+        {
+            (void)handle;
+            (void)access;
+            static_cast<GAHTTPApi*>(userptr)->shareMutexes[data].lock();
+        }
+
+        void GAHTTPApi::unlockShare(CURL* handle, curl_lock_data data, void* userptr)
+        {
+            (void)handle;
+            static_cast<GAHTTPApi*>(userptr)->shareMutexes[data].unlock();
+        }
+
+        CURL* GAHTTPApi::createCurlHandle()
+        {
+            CURL* curl = curl_easy_init();
+            if(!curl)
+            {
+                return NULL;
+            }
+
+            if (curlShare)
+            {
+                curl_easy_setopt(curl, CURLOPT_SHARE, curlShare);
+            }
+            curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+            curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+            curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, DnsCacheTimeoutInSeconds);
+            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writefunc);
+
+            return curl;
+        }
+
+        CURL* GAHTTPApi::getCurlHandle()
+        {
+            if (!curlHandle)
+            {
+                curlHandle = createCurlHandle();
+            }
+            return curlHandle;
+        }
+
+        CURLcode GAHTTPApi::performRequest(CURL* curl, const char* url, const std::vector<char>& payloadData, bool gzip, const char* requestId, struct ResponseData* response, long& statusCode_out, std::vector<char>& authorization_out)
+        {
+            if (!curl)
+            {
+                return CURLE_FAILED_INIT;
+            }
+
+            struct curl_slist* headers = NULL;
+            authorization_out = createRequest(curl, url, payloadData, gzip, headers);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+
+            CURLcode res = curl_easy_perform(curl);
+
+            // the handle outlives this request, so it must not keep pointing at the header list
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, NULL);
+            curl_slist_free_all(headers);
+
+            if (res != CURLE_OK)
+            {
+                return res;
+            }
+
+            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &statusCode_out);
+            recordConnectionStats(curl, requestId);
+
+            return res;
+        }
+
+        void GAHTTPApi::recordConnectionStats(CURL* curl, const char* requestId)
+        {
+            // number of new connections made for the transfer, 0 when an open connection was reused
+            long newConnections = 0;
+            curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &newConnections);
+            int64_t requests = ++requestCount;
+            int64_t reused = newConnections == 0 ? ++reusedConnectionCount : reusedConnectionCount.load();
+            logging::GALogger::d("%s request. Connection reused: %s (%lld of %lld requests)", requestId, newConnections == 0 ? "yes" : "no", static_cast<long long>(reused), static_cast<long long>(requests));
+        }
+
+        void GAHTTPApi::getConnectionStats(int64_t& requests_out, int64_t& reusedConnections_out)
+        {
+            requests_out = requestCount;
+            reusedConnections_out = reusedConnectionCount;
+        }
+
+        std::vector<char> GAHTTPApi::createRequest(CURL *curl, const char* url, const std::vector<char>& payloadData, bool gzip, struct curl_slist*& header)
         {
             curl_easy_setopt(curl, CURLOPT_URL, url);
             curl_easy_setopt(curl, CURLOPT_POST, 1L);
-            struct curl_slist *header = NULL;
 
             if (gzip)
             {
@@ -16,6 +16,17 @@
 #include <mutex>
 #include <cstdlib>
 #include <tuple>
+#include <atomic>
+#include <functional>
+#if !USE_UWP
+#include <thread>
+#include <condition_variable>
+#include <string>
+#endif
+#include "GAUtilities.h"
+#if USE_TIZEN
+#include <net_connection.h>
+#endif
 
 namespace gameanalytics
 {
@@ -112,6 +123,48 @@ namespace gameanalytics
 
         typedef std::tuple<EGASdkErrorCategory, EGASdkErrorArea> ErrorType;
 
+#if !USE_UWP
+        struct SdkErrorEvent
+        {
+            ErrorType type;
+            EGASdkErrorAction action;
+            std::string gameKey;
+            std::string json;
+        };
+
+        // sdk errors waiting to be sent. an error counts against the hourly limit of its (category, area)
+        // when it is queued and the count is given back if sending it fails. not thread safe
+        class GASdkErrorQueue
+        {
+        public:
+            enum PushResult
+            {
+                Queued,
+                RateLimited,
+                AlreadyQueued,
+                QueueFull
+            };
+
+            GASdkErrorQueue(int maxCountPerHour, size_t maxQueued);
+
+            PushResult push(const SdkErrorEvent& errorEvent, int64_t now);
+            // moves the queued errors to events_out
+            void takeAll(std::vector<SdkErrorEvent>& events_out);
+            // gives back the counts of errors that could not be sent
+            void sendFailed(const std::vector<SdkErrorEvent>& events);
+            bool isEmpty() const;
+            size_t size() const;
+
+        private:
+            int maxCountPerHour;
+            size_t maxQueued;
+            std::vector<SdkErrorEvent> queue;
+            // queued or sent errors per (category, area) since the window started
+            std::map<ErrorType, int> countMap;
+            std::map<ErrorType, int64_t> timestampMap;
+        };
+#endif
+
         class GAHTTPApi
         {
         public:
@@ -121,12 +174,38 @@ namespace gameanalytics
 #if USE_UWP
             concurrency::task<std::pair<EGAHTTPApiResponse, std::string>> requestInitReturningDict(const char* configsHash);
             concurrency::task<std::pair<EGAHTTPApiResponse, std::string>> sendEventsInArray(const rapidjson::Value& eventArray);
+            // jsonArray is the already serialized array of events
+            concurrency::task<std::pair<EGAHTTPApiResponse, std::string>> sendEventsInArray(const char* jsonArray);
+            concurrency::task<std::pair<EGAHTTPApiResponse, std::string>> sendEventsPayload();
             void sendSdkErrorEvent(EGASdkErrorCategory category, EGASdkErrorArea area, EGASdkErrorAction action, EGASdkErrorParameter parameter, std::string reason, std::string gameKey, std::string secretKey);
 #else
             void requestInitReturningDict(EGAHTTPApiResponse& response_out, rapidjson::Document& json_out, const char* configsHash);
             void sendEventsInArray(EGAHTTPApiResponse& response_out, rapidjson::Value& json_out, const rapidjson::Value& eventArray);
+            // jsonArray is the already serialized array of events
+            void sendEventsInArray(EGAHTTPApiResponse& response_out, rapidjson::Value& json_out, const char* jsonArray);
+            void sendEventsPayload(EGAHTTPApiResponse& response_out, rapidjson::Value& json_out);
+
+            typedef std::function<void(EGAHTTPApiResponse response, const rapidjson::Value& json)> ResponseCallback;
+            // sends the events payload in the background, callback is run on the GA thread once the request completes.
+            // returns false (without calling callback) if the request could not be started
+            bool sendEventsPayloadAsync(const ResponseCallback& callback);
+            // runs callbacks of completed background requests, must be called on the GA thread
+            void runCompletedRequestCallbacks();
+            // background requests whose callbacks haven't run yet
+            int getEventsRequestsInFlight();
+
             void sendSdkErrorEvent(EGASdkErrorCategory category, EGASdkErrorArea area, EGASdkErrorAction action, EGASdkErrorParameter parameter, const char* reason, const char* gameKey, const char* secretKey);
+
+            // number of completed requests and how many of them went over an already open connection
+            void getConnectionStats(int64_t& requests_out, int64_t& reusedConnections_out);
 #endif
+            // the serialized events array can be written in pieces before sendEventsPayload,
+            // it is compressed while it is written when gzip is used
+            void beginEventsPayload();
+            void writeEventsPayload(const char* data, size_t size);
+
+            // gzip level, from utilities::GAGzipCompressor::BestSpeed to BestCompression (default)
+            void setCompressionLevel(int level);
 
             static void sdkErrorCategoryString(EGASdkErrorCategory value, char* out)
             {
@@ -320,15 +399,24 @@ namespace gameanalytics
             ~GAHTTPApi();
             GAHTTPApi(const GAHTTPApi&) = delete;
             GAHTTPApi& operator=(const GAHTTPApi&) = delete;
-            std::vector<char> createPayloadData(const char* payload, bool gzip);
+            static std::vector<char> createPayloadData(const char* payload, bool gzip, int level);
 
 #if USE_UWP
             std::vector<char> createRequest(Windows::Web::Http::HttpRequestMessage^ message, const std::string& url, const std::vector<char>& payloadData, bool gzip);
             EGAHTTPApiResponse processRequestResponse(Windows::Web::Http::HttpResponseMessage^ response, const std::string& requestId);
             concurrency::task<Windows::Storage::Streams::InMemoryRandomAccessStream^> createStream(std::string data);
 #else
-            std::vector<char> createRequest(CURL *curl, const char* url, const std::vector<char>& payloadData, bool gzip);
+            // header is set to the list used by the request, the caller frees it after the transfer
+            std::vector<char> createRequest(CURL *curl, const char* url, const std::vector<char>& payloadData, bool gzip, struct curl_slist*& header);
+            CURLcode performRequest(CURL* curl, const char* url, const std::vector<char>& payloadData, bool gzip, const char* requestId, struct ResponseData* response, long& statusCode_out, std::vector<char>& authorization_out);
             EGAHTTPApiResponse processRequestResponse(long statusCode, const char* body, const char* requestId);
+            void recordConnectionStats(CURL* curl, const char* requestId);
+            CURL* createCurlHandle();
+            CURL* getCurlHandle();
+            bool prepareEventsPayload(char* url, size_t urlSize);
+            EGAHTTPApiResponse processEventsResponse(long statusCode, const char* body, const char* url, const std::vector<char>& payloadData, const char* authorization, rapidjson::Document& json_out);
+            static void lockShare(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr);
+            static void unlockShare(CURL* handle, curl_lock_data data, void* userptr);
 #endif
             static char protocol[];
             static char hostName[];
@@ -339,9 +427,17 @@ namespace gameanalytics
             static char initializeUrlPath[];
             static char eventsUrlPath[];
             bool useGzip;
+            std::atomic<int> compressionLevel;
+            // body of the events request, reused between submissions
+            utilities::GAGzipCompressor eventsCompressor;
+            std::vector<char> eventsPayloadData;
+            size_t eventsPayloadSize;
             static const int MaxCount;
+#if USE_UWP
+            // sent sdk errors per (category, area) in the last hour
             static std::map<ErrorType, int> countMap;
             static std::map<ErrorType, int64_t> timestampMap;
+#endif
 
             static bool _destroyed;
             static GAHTTPApi* _instance;
@@ -358,6 +454,78 @@ namespace gameanalytics
             }
 #if USE_UWP
             Windows::Web::Http::HttpClient^ httpClient;
+#else
+            static const long DnsCacheTimeoutInSeconds;
+
+            // long lived handle for init and events requests, guarded by curlMutex
+            CURL* curlHandle;
+            std::mutex curlMutex;
+            CURLSH* curlShare;
+            std::mutex shareMutexes[CURL_LOCK_DATA_LAST];
+            std::atomic<int64_t> requestCount;
+            std::atomic<int64_t> reusedConnectionCount;
+
+            struct EventsRequest
+            {
+                EventsRequest() :curl(NULL), headers(NULL), responseEnum(NoResponse)
+                {
+                    url[0] = '\0';
+                    response.ptr = NULL;
+                    response.len = 0;
+                }
+
+                CURL* curl;
+                struct curl_slist* headers;
+                char url[513];
+                std::vector<char> payloadData;
+                std::vector<char> authorization;
+                struct ResponseData response;
+                ResponseCallback callback;
+                EGAHTTPApiResponse responseEnum;
+                rapidjson::Document responseJson;
+#if USE_TIZEN
+                connection_h connection;
+#endif
+            };
+
+            static const int TransferPollTimeoutInMs;
+            static const size_t MaxFreePayloadBuffers;
+
+            // background transfers are driven by transferThread through curlMulti
+            void runTransfers();
+            void completeEventsRequest(EventsRequest* request, CURLcode res);
+            void releaseEventsRequest(EventsRequest* request);
+
+            CURLM* curlMulti;
+            std::thread transferThread;
+            // guards stopTransfers, the request lists and freePayloadBuffers
+            std::mutex requestsMutex;
+            bool stopTransfers;
+            std::vector<EventsRequest*> pendingRequests;
+            std::vector<EventsRequest*> completedRequests;
+            std::vector<std::vector<char> > freePayloadBuffers;
+            std::atomic<int> eventsRequestsInFlight;
+
+            static const size_t MaxQueuedSdkErrors;
+            static const long SdkErrorRequestTimeoutInSeconds;
+
+            // sdk errors are sent by sdkErrorThread, queued errors are sent together in one request
+            void runSdkErrorSender();
+            bool sendSdkErrorPayload(CURL* curl, const char* gameKey, const char* payloadJSONString);
+            // aborts the sdk error request in flight once the sender is stopped
+#if LIBCURL_VERSION_NUM >= 0x072000
+            static int sdkErrorProgress(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
+#else
+            static int sdkErrorProgress(void* clientp, double dltotal, double dlnow, double ultotal, double ulnow);
+#endif
+
+            std::thread sdkErrorThread;
+            // guards stopSdkErrorSender and sdkErrorQueue
+            std::mutex sdkErrorMutex;
+            std::condition_variable sdkErrorCondition;
+            // also read without the lock by sdkErrorProgress
+            std::atomic<bool> stopSdkErrorSender;
+            GASdkErrorQueue sdkErrorQueue;
 #endif
         };
 
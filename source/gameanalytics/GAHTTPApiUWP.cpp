@@ -40,6 +40,8 @@ namespace gameanalytics
 #else
             useGzip = false;
 #endif
+            compressionLevel = utilities::GAGzipCompressor::BestCompression;
+            eventsPayloadSize = 0;
             snprintf(GAHTTPApi::baseUrl, sizeof(GAHTTPApi::baseUrl), "%s://%s/%s", protocol, hostName, version);
             snprintf(GAHTTPApi::remoteConfigsBaseUrl, sizeof(GAHTTPApi::remoteConfigsBaseUrl), "%s://%s/remote_configs/%s", protocol, hostName, remoteConfigsVersion);
             httpClient = ref new Windows::Web::Http::HttpClient();
@@ -132,7 +134,7 @@ namespace gameanalytics
                 });
             }
 
-            std::vector<char> payloadData = createPayloadData(JSONstring.c_str(), useGzip);
+            std::vector<char> payloadData = createPayloadData(JSONstring.c_str(), useGzip, compressionLevel);
             auto message = ref new Windows::Web::Http::HttpRequestMessage();
 
             std::vector<char> authorization = createRequest(message, url, payloadData, useGzip);
@@ -207,22 +209,64 @@ namespace gameanalytics
                 logging::GALogger::d("sendEventsInArray called with missing eventArray");
             }
 
+            // make JSON string from data
+            rapidjson::StringBuffer buffer;
+            {
+                rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+                eventArray.Accept(writer);
+            }
+
+            return sendEventsInArray(buffer.GetString());
+        }
+
+        concurrency::task<std::pair<EGAHTTPApiResponse, std::string>> GAHTTPApi::sendEventsInArray(const char* jsonArray)
+        {
+            beginEventsPayload();
+            writeEventsPayload(jsonArray, strlen(jsonArray));
+            return sendEventsPayload();
+        }
+
+        void GAHTTPApi::beginEventsPayload()
+        {
+            eventsPayloadSize = 0;
+            if (useGzip)
+            {
+                eventsCompressor.begin(eventsPayloadData, compressionLevel);
+            }
+            else
+            {
+                eventsPayloadData.clear();
+            }
+        }
+
+        void GAHTTPApi::writeEventsPayload(const char* data, size_t size)
+        {
+            eventsPayloadSize += size;
+            if (useGzip)
+            {
+                eventsCompressor.write(data, size);
+            }
+            else
+            {
+                eventsPayloadData.insert(eventsPayloadData.end(), data, data + size);
+            }
+        }
+
+        concurrency::task<std::pair<EGAHTTPApiResponse, std::string>> GAHTTPApi::sendEventsPayload()
+        {
             auto gameKey = state::GAState::getGameKey();
 
             // Generate URL
             std::string url = std::string(baseUrl) + "/" + std::string(gameKey) + "/" + std::string(eventsUrlPath);
             logging::GALogger::d("Sending 'events' URL: %s", url.c_str());
 
-            // make JSON string from data
-            rapidjson::StringBuffer buffer;
+            if (useGzip)
             {
-                rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-                eventArray.Accept(writer);
+                eventsCompressor.finish();
+                logging::GALogger::d("Gzip stats. Size: %d, Compressed: %d", eventsPayloadSize, eventsPayloadData.size());
             }
 
-            std::string JSONstring = buffer.GetString();
-
-            if (JSONstring.empty())
+            if (eventsPayloadSize == 0 || eventsPayloadData.empty())
             {
                 logging::GALogger::d("sendEventsInArray JSON encoding failed of eventArray");
                 return concurrency::create_task([]()
@@ -231,7 +275,9 @@ namespace gameanalytics
                 });
             }
 
-            std::vector<char> payloadData = createPayloadData(JSONstring.c_str(), useGzip);
+            // only kept for logging failed calls
+            std::string JSONstring = useGzip ? std::string() : std::string(eventsPayloadData.begin(), eventsPayloadData.end());
+            const std::vector<char>& payloadData = eventsPayloadData;
             auto message = ref new Windows::Web::Http::HttpRequestMessage();
 
             std::string authorization = createRequest(message, url, payloadData, useGzip).data();
@@ -388,7 +434,7 @@ namespace gameanalytics
                 return;
             }
 
-            std::vector<char> payloadData = createPayloadData(payloadJSONString.c_str(), useGzip);
+            std::vector<char> payloadData = createPayloadData(payloadJSONString.c_str(), useGzip, compressionLevel);
             auto message = ref new Windows::Web::Http::HttpRequestMessage();
 
             std::vector<char> authorization = createRequest(message, url, payloadData, useGzip);
@@ -425,13 +471,18 @@ namespace gameanalytics
         std::map<ErrorType, int> GAHTTPApi::countMap = std::map<ErrorType, int>();
         std::map<ErrorType, int64_t> GAHTTPApi::timestampMap = std::map<ErrorType, int64_t>();
 
-        std::vector<char> GAHTTPApi::createPayloadData(const char* payload, bool gzip)
+        void GAHTTPApi::setCompressionLevel(int level)
+        {
+            compressionLevel = level;
+        }
+
+        std::vector<char> GAHTTPApi::createPayloadData(const char* payload, bool gzip, int level)
         {
             std::vector<char> payloadData;
 
             if (gzip)
             {
-                payloadData = utilities::GAUtilities::gzipCompress(payload);
+                payloadData = utilities::GAUtilities::gzipCompress(payload, level);
                 logging::GALogger::d("Gzip stats. Size: %d, Compressed: %d", strlen(payload), payloadData.size());
             }
             else
@@ -4,6 +4,8 @@
 #include "GADevice.h"
 #include <cstdarg>
 #include <exception>
+#include <stdexcept>
+#include <cstring>
 #if USE_UWP
 #include "GAUtilities.h"
 #include <collection.h>
@@ -30,6 +32,9 @@ namespace gameanalytics
     namespace logging
     {
         const char* GALogger::tag = "GameAnalytics";
+        const int GALogger::LogWriterIntervalInMs = 100;
+        const long long GALogger::DefaultMaxLogFileSize = 1048576;
+        const int GALogger::DefaultLogGenerations = 1;
 
         bool GALogger::_destroyed = false;
         GALogger* GALogger::_instance = 0;
@@ -38,6 +43,7 @@ namespace gameanalytics
         GALogger::GALogger()
         {
             infoLogEnabled = false;
+            infoLogVerboseEnabled = false;
             customLogHandler = {};
 
 #if defined(_DEBUG)
@@ -54,19 +60,43 @@ namespace gameanalytics
 
 #if !USE_UWP && !USE_TIZEN
             logInitialized = false;
-            currentLogCount = 0;
-            maxLogCount = 5000;
+            currentLogSize = 0;
+            maxLogSize = DefaultMaxLogFileSize;
+            logGenerations = DefaultLogGenerations;
+            queuedLineCount = 0;
+            droppedMessages = 0;
+            reportedDroppedMessages = 0;
+            wakeWriter = false;
+            stopWriter = false;
 #endif
         }
 
         GALogger::~GALogger()
         {
 #if !USE_UWP && !USE_TIZEN
+            if(writerThread.joinable())
+            {
+                {
+                    std::lock_guard<std::mutex> lock(writerMutex);
+                    stopWriter = true;
+                    writerCondition.notify_one();
+                }
+                writerThread.join();
+            }
+            while(writeQueuedLines())
+            {
+            }
+
             if(logInitialized)
             {
                 fclose(log_file);
             }
 #endif
+            LogLine* line = nullptr;
+            while(linePool.tryPop(line))
+            {
+                delete line;
+            }
         }
 
         void GALogger::cleanUp()
@@ -113,6 +143,24 @@ namespace gameanalytics
             i->infoLogVerboseEnabled = enabled;
         }
 
+        bool GALogger::isInfoEnabled()
+        {
+            GALogger* i = GALogger::getInstance();
+            return i && i->infoLogEnabled;
+        }
+
+        bool GALogger::isVerboseInfoEnabled()
+        {
+            GALogger* i = GALogger::getInstance();
+            return i && i->infoLogVerboseEnabled;
+        }
+
+        bool GALogger::isDebugEnabled()
+        {
+            GALogger* i = GALogger::getInstance();
+            return i && i->debugEnabled;
+        }
+
 #if !USE_UWP && !USE_TIZEN
         void GALogger::file_output_callback(const zf_log_message *msg, void *arg)
         {
@@ -123,40 +171,61 @@ namespace gameanalytics
             }
 
             (void)arg;
+            std::lock_guard<std::mutex> lock(i->fileMutex);
+            if(!i->logInitialized)
+            {
+                return;
+            }
             *msg->p = '\n';
             fwrite(msg->buf, msg->p - msg->buf + 1, 1, i->log_file);
             fflush(i->log_file);
         }
 
-        void GALogger::initializeLog()
+        bool GALogger::openLogFile()
         {
-            GALogger *ga = GALogger::getInstance();
-            if(!ga)
+            // sets up the default writable path when none has been configured
+            device::GADevice::getWritablePath();
+            if(device::GADevice::getWritablePathStatus() <= 0)
             {
-                return;
+                return false;
             }
 
-            if(!ga->logInitialized)
             {
-                const char* writablepath = device::GADevice::getWritablePath();
-
-                if(device::GADevice::getWritablePathStatus() <= 0)
+                std::lock_guard<std::mutex> lock(fileMutex);
+                if(logInitialized)
                 {
-                    return;
+                    fclose(log_file);
+                    logInitialized = false;
                 }
-                snprintf(ga->p, sizeof(ga->p), "%s%sga_log.txt", writablepath, utilities::GAUtilities::getPathSeparator());
 
-                ga->log_file = fopen(ga->p, "w");
-                if (!ga->log_file)
+                logFilePath(0, p, sizeof(p));
+                log_file = fopen(p, "w");
+                if (log_file)
                 {
-                    ZF_LOGW("Failed to open log file %s", ga->p);
-                    return;
+                    logInitialized = true;
+                    currentLogSize = 0;
                 }
-                zf_log_set_output_v(ZF_LOG_PUT_STD, 0, file_output_callback);
+            }
+
+            if (!logInitialized)
+            {
+                ZF_LOGW("Failed to open log file %s", p);
+                return false;
+            }
+            zf_log_set_output_v(ZF_LOG_PUT_STD, 0, file_output_callback);
+            return true;
+        }
 
-                ga->logInitialized = true;
-                ga->currentLogCount = 0;
+        void GALogger::initializeLog()
+        {
+            GALogger *ga = GALogger::getInstance();
+            if(!ga)
+            {
+                return;
+            }
 
+            if(!ga->logInitialized && ga->openLogFile())
+            {
                 GALogger::i("Log file added under: %s", device::GADevice::getWritablePath());
             }
         }
@@ -169,30 +238,70 @@ namespace gameanalytics
                 return;
             }
 
-            if(ga->logInitialized)
+            // lines queued so far belong in the previous file
+            while(ga->writeQueuedLines())
             {
-                fclose(ga->log_file);
             }
+            if(ga->openLogFile())
+            {
+                GALogger::i("Log file added under: %s", device::GADevice::getWritablePath());
+            }
+        }
 
-            const char* writablepath = device::GADevice::getWritablePath();
-
-            if(device::GADevice::getWritablePathStatus() <= 0)
+        void GALogger::flushLog()
+        {
+            GALogger *ga = GALogger::getInstance();
+            if(!ga)
             {
                 return;
             }
-            snprintf(ga->p, sizeof(ga->p), "%s%sga_log.txt", writablepath, utilities::GAUtilities::getPathSeparator());
 
-            ga->log_file = fopen(ga->p, "w");
-            if (!ga->log_file)
+            while(ga->writeQueuedLines())
+            {
+            }
+        }
+
+        void GALogger::setLogRotation(long long maxFileSizeBytes, int generations)
+        {
+            GALogger *ga = GALogger::getInstance();
+            if(!ga)
             {
-                ZF_LOGW("Failed to open log file %s", ga->p);
                 return;
             }
-            zf_log_set_output_v(ZF_LOG_PUT_STD, 0, file_output_callback);
 
-            ga->logInitialized = true;
+            std::lock_guard<std::mutex> lock(ga->fileMutex);
+            ga->maxLogSize = maxFileSizeBytes;
+            ga->logGenerations = generations;
+        }
+
+        void GALogger::logFilePath(int generation, char* out, size_t size)
+        {
+            const char* writablepath = device::GADevice::getWritablePath();
+            const char* separator = utilities::GAUtilities::getPathSeparator();
+
+            if(generation == 0)
+            {
+                snprintf(out, size, "%s%sga_log.txt", writablepath, separator);
+            }
+            else if(generation == 1)
+            {
+                snprintf(out, size, "%s%sga_log-prev.txt", writablepath, separator);
+            }
+            else
+            {
+                snprintf(out, size, "%s%sga_log-prev%d.txt", writablepath, separator, generation);
+            }
+        }
+
+        unsigned long long GALogger::getDroppedMessageCount()
+        {
+            GALogger *ga = GALogger::getInstance();
+            if(!ga)
+            {
+                return 0;
+            }
 
-            GALogger::i("Log file added under: %s", device::GADevice::getWritablePath());
+            return ga->droppedMessages;
         }
 #endif
 
@@ -215,32 +324,10 @@ namespace gameanalytics
                 return;
             }
 
-            try
-            {
-                va_list args;
-                va_start (args, format);
-                size_t len = std::vsnprintf(NULL, 0, format, args);
-                va_end (args);
-                char* formatted = new char[len + 1];
-                va_start (args, format);
-                std::vsnprintf(formatted, len + 1, format, args);
-                va_end (args);
-
-                size_t s = len + 1 + 11 + strlen(ga->tag);
-                char* message = new char[s];
-                snprintf(message, s, "Info/%s: %s", ga->tag, formatted);
-                ga->sendNotificationMessage(message, LogInfo);
-                delete[] message;
-                delete[] formatted;
-            }
-            catch(const std::exception& e)
-            {
-                if (!ga->debugEnabled) {
-                    // No logging of debug unless in full debug logging mode
-                    return;
-                }
-                ga->sendNotificationMessage(format, LogDebug);
-            }
+            va_list args;
+            va_start (args, format);
+            ga->logMessage(LogInfo, "Info", format, args);
+            va_end (args);
         }
 
 
@@ -258,32 +345,10 @@ namespace gameanalytics
                 return;
             }
 
-            try
-            {
-                va_list args;
-                va_start (args, format);
-                size_t len = std::vsnprintf(NULL, 0, format, args);
-                va_end (args);
-                char* formatted = new char[len + 1];
-                va_start (args, format);
-                std::vsnprintf(formatted, len + 1, format, args);
-                va_end (args);
-
-                size_t s = len + 1 + 14 + strlen(ga->tag);
-                char* message = new char[s];
-                snprintf(message, s, "Warning/%s: %s", ga->tag, formatted);
-                ga->sendNotificationMessage(message, LogWarning);
-                delete[] message;
-                delete[] formatted;
-            }
-            catch(const std::exception& e)
-            {
-                if (!ga->debugEnabled) {
-                    // No logging of debug unless in full debug logging mode
-                    return;
-                }
-                ga->sendNotificationMessage(format, LogDebug);
-            }
+            va_list args;
+            va_start (args, format);
+            ga->logMessage(LogWarning, "Warning", format, args);
+            va_end (args);
         }
 
 
@@ -302,32 +367,10 @@ namespace gameanalytics
                 return;
             }
 
-            try
-            {
-                va_list args;
-                va_start (args, format);
-                size_t len = std::vsnprintf(NULL, 0, format, args);
-                va_end (args);
-                char* formatted = new char[len + 1];
-                va_start (args, format);
-                std::vsnprintf(formatted, len + 1, format, args);
-                va_end (args);
-
-                size_t s = len + 1 + 12 + strlen(ga->tag);
-                char* message = new char[s];
-                snprintf(message, s, "Error/%s: %s", ga->tag, formatted);
-                ga->sendNotificationMessage(message, LogError);
-                delete[] message;
-                delete[] formatted;
-            }
-            catch(const std::exception& e)
-            {
-                if (!ga->debugEnabled) {
-                    // No logging of debug unless in full debug logging mode
-                    return;
-                }
-                ga->sendNotificationMessage(format, LogDebug);
-            }
+            va_list args;
+            va_start (args, format);
+            ga->logMessage(LogError, "Error", format, args);
+            va_end (args);
         }
 
 
@@ -349,32 +392,10 @@ namespace gameanalytics
                 return;
             }
 
-            try
-            {
-                va_list args;
-                va_start (args, format);
-                size_t len = std::vsnprintf(NULL, 0, format, args);
-                va_end (args);
-                char* formatted = new char[len + 1];
-                va_start (args, format);
-                std::vsnprintf(formatted, len + 1, format, args);
-                va_end (args);
-
-                size_t s = len + 1 + 12 + strlen(ga->tag);
-                char* message = new char[s];
-                snprintf(message, s, "Debug/%s: %s", ga->tag, formatted);
-                ga->sendNotificationMessage(message, LogDebug);
-                delete[] message;
-                delete[] formatted;
-            }
-            catch(const std::exception& e)
-            {
-                if (!ga->debugEnabled) {
-                    // No logging of debug unless in full debug logging mode
-                    return;
-                }
-                ga->sendNotificationMessage(format, LogDebug);
-            }
+            va_list args;
+            va_start (args, format);
+            ga->logMessage(LogDebug, "Debug", format, args);
+            va_end (args);
         }
 
 
@@ -395,113 +416,265 @@ namespace gameanalytics
                 return;
             }
 
+            va_list args;
+            va_start (args, format);
+            ga->logMessage(LogInfo, "Verbose", format, args);
+            va_end (args);
+        }
+
+        void GALogger::logMessage(EGALoggerMessageType type, const char* prefix, const char* format, va_list args)
+        {
+            LogLine* line = nullptr;
             try
             {
-                va_list args;
-                va_start (args, format);
-                size_t len = std::vsnprintf(NULL, 0, format, args);
-                va_end (args);
-                char* formatted = new char[len + 1];
-                va_start (args, format);
-                std::vsnprintf(formatted, len + 1, format, args);
-                va_end (args);
-
-                size_t s = len + 1 + 14 + strlen(ga->tag);
-                char* message = new char[s];
-                snprintf(message, s, "Verbose/%s: %s", ga->tag, formatted);
-                ga->sendNotificationMessage(message, LogInfo);
-                delete[] message;
-                delete[] formatted;
+                line = acquireLine();
+                line->length = formatMessage(line->text, prefix, format, args);
+                line->type = type;
             }
             catch(const std::exception& e)
             {
-                if (!ga->debugEnabled) {
+                releaseLine(line);
+                if (!debugEnabled) {
                     // No logging of debug unless in full debug logging mode
                     return;
                 }
-                ga->sendNotificationMessage(format, LogDebug);
+                sendNotificationMessage(format, LogDebug);
+                return;
             }
+
+#if !USE_UWP && !USE_TIZEN
+            if(!customLogHandler)
+            {
+                queueLine(line);
+                return;
+            }
+#endif
+            sendNotificationMessage(line->text.data(), type);
+            releaseLine(line);
         }
 
-        void GALogger::sendNotificationMessage(const char* message, EGALoggerMessageType type)
+        size_t GALogger::formatMessage(std::vector<char>& out, const char* prefix, const char* format, va_list args)
         {
-            if(GameAnalytics::isThreadEnding())
+            if(out.size() < DefaultLineCapacity)
             {
-                //return;
+                out.resize(DefaultLineCapacity);
             }
 
-            if(customLogHandler)
+            int prefixLength = snprintf(out.data(), out.size(), "%s/%s: ", prefix, tag);
+            if(prefixLength < 0 || static_cast<size_t>(prefixLength) >= out.size())
+            {
+                throw std::runtime_error("log prefix does not fit");
+            }
+
+            // a single pass unless the message is longer than the pooled buffer
+            va_list copy;
+            va_copy(copy, args);
+            int length = std::vsnprintf(out.data() + prefixLength, out.size() - prefixLength, format, copy);
+            va_end(copy);
+            if(length < 0)
+            {
+                throw std::runtime_error("invalid log format");
+            }
+
+            size_t size = static_cast<size_t>(prefixLength) + length;
+            if(size >= out.size())
+            {
+                out.resize(size + 1);
+                std::vsnprintf(out.data() + prefixLength, out.size() - prefixLength, format, args);
+            }
+            return size;
+        }
+
+        GALogger::LogLine* GALogger::acquireLine()
+        {
+            LogLine* line = nullptr;
+            if(!linePool.tryPop(line))
+            {
+                line = new LogLine();
+            }
+            return line;
+        }
+
+        void GALogger::releaseLine(LogLine* line)
+        {
+            if(!line)
             {
-                customLogHandler(message, type);
                 return;
             }
 
+            line->length = 0;
+            // don't hold on to buffers grown by unusually large messages
+            if(line->text.capacity() > MaxPooledLineCapacity || !linePool.tryPush(line))
+            {
+                delete line;
+            }
+        }
+
 #if !USE_UWP && !USE_TIZEN
-            if(logInitialized)
+        void GALogger::queueLine(LogLine* line)
+        {
+            if(!logInitialized)
             {
-                ++currentLogCount;
-                if(currentLogCount >= maxLogCount)
+                initializeLog();
+            }
+            if(device::GADevice::getWritablePathStatus() <= 0)
+            {
+                releaseLine(line);
+                return;
+            }
+            startLogWriter();
+
+            bool isError = line->type == LogError;
+            if(!queuedLines.tryPush(line))
+            {
+                ++droppedMessages;
+                releaseLine(line);
+                return;
+            }
+
+            // the writer wakes up on its own every LogWriterIntervalInMs, errors and a half full queue don't wait for it
+            size_t count = ++queuedLineCount;
+            if(isError || count == LogQueueCapacity / 2)
+            {
+                wakeLogWriter();
+            }
+        }
+
+        void GALogger::startLogWriter()
+        {
+            std::call_once(writerStartedFlag, [this]()
+            {
+                writerThread = std::thread(&GALogger::runLogWriter, this);
+            });
+        }
+
+        void GALogger::wakeLogWriter()
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            wakeWriter = true;
+            writerCondition.notify_one();
+        }
+
+        void GALogger::runLogWriter()
+        {
+            std::unique_lock<std::mutex> lock(writerMutex);
+            bool hasMoreLines = false;
+            while(!stopWriter)
+            {
+                if(!hasMoreLines)
                 {
-                    fclose(log_file);
+                    writerCondition.wait_for(lock, std::chrono::milliseconds(LogWriterIntervalInMs), [this]() { return wakeWriter || stopWriter; });
+                }
+                wakeWriter = false;
 
-                    char p_prev[513] = "";
-                    const char* writablepath = device::GADevice::getWritablePath();
+                lock.unlock();
+                hasMoreLines = writeQueuedLines();
+                lock.lock();
+            }
+        }
 
-                    if(device::GADevice::getWritablePathStatus() <= 0)
-                    {
-                        return;
-                    }
-                    snprintf(p_prev, sizeof(p_prev), "%s%sga_log-prev.txt", writablepath, utilities::GAUtilities::getPathSeparator());
+        bool GALogger::writeQueuedLines()
+        {
+            std::lock_guard<std::mutex> lock(fileMutex);
 
-                    log_file = fopen(p, "r");
-                    if (!log_file)
-                    {
-                        ZF_LOGW("Failed to open log file %s", p);
-                        return;
-                    }
-                    FILE *log_file_prev;
-                    log_file_prev = fopen(p_prev, "w");
-                    if (!log_file_prev)
-                    {
-                        ZF_LOGW("Failed to open log file %s", p_prev);
-                        return;
-                    }
+            batch.clear();
+            int lineCount = 0;
+            LogLine* line = nullptr;
+            while(lineCount < static_cast<int>(LogQueueCapacity) && queuedLines.tryPop(line))
+            {
+                --queuedLineCount;
+                batch.insert(batch.end(), line->text.data(), line->text.data() + line->length);
+                batch.push_back('\n');
+                ++lineCount;
+                releaseLine(line);
+            }
 
-                    char ch;
-                    while((ch = fgetc(log_file)) != EOF)
-                    {
-                        fputc(ch, log_file_prev);
-                    }
+            unsigned long long dropped = droppedMessages;
+            if(dropped != reportedDroppedMessages)
+            {
+                char message[128] = "";
+                int length = snprintf(message, sizeof(message), "Warning/%s: %llu log messages dropped, the log queue was full\n", tag, dropped - reportedDroppedMessages);
+                batch.insert(batch.end(), message, message + length);
+                reportedDroppedMessages = dropped;
+                ++lineCount;
+            }
 
-                    fclose(log_file);
-                    fclose(log_file_prev);
+            if(batch.empty())
+            {
+                return false;
+            }
 
-                    log_file = fopen(p, "w");
-                    if (!log_file)
-                    {
-                        ZF_LOGW("Failed to open log file %s", p);
-                        return;
-                    }
-                    currentLogCount = 0;
-                }
+            fwrite(batch.data(), 1, batch.size(), stdout);
+            fflush(stdout);
+            if(logInitialized)
+            {
+                fwrite(batch.data(), 1, batch.size(), log_file);
+                fflush(log_file);
+                rotateLogIfNeeded(batch.size());
             }
-#endif
-#if USE_UWP
-            auto m = ref new Platform::String(utilities::GAUtilities::s2ws(message).c_str());
-            Platform::Collections::Vector<Platform::String^>^ lines = ref new Platform::Collections::Vector<Platform::String^>();
-            lines->Append(m);
+            return lineCount >= static_cast<int>(LogQueueCapacity);
+        }
+
+        void GALogger::rotateLogIfNeeded(size_t writtenBytes)
+        {
+            currentLogSize += writtenBytes;
+            if(maxLogSize <= 0 || currentLogSize < maxLogSize)
+            {
+                return;
+            }
+
+            fclose(log_file);
+            logInitialized = false;
+
+            // rename doesn't replace an existing file everywhere, so the oldest generation is removed first
+            // and every rename below moves onto a name that was just freed
+            char from[513] = "";
+            char to[513] = "";
+            logFilePath(logGenerations, to, sizeof(to));
+            remove(to);
+            for(int generation = logGenerations; generation > 0; --generation)
+            {
+                logFilePath(generation - 1, from, sizeof(from));
+                logFilePath(generation, to, sizeof(to));
+                rename(from, to);
+            }
+
+            log_file = fopen(p, "w");
+            if (!log_file)
+            {
+                return;
+            }
+            logInitialized = true;
+            currentLogSize = 0;
+        }
 #endif
 
-#if !USE_UWP && !USE_TIZEN
-            if(!logInitialized)
+        void GALogger::sendNotificationMessage(const char* message, EGALoggerMessageType type)
+        {
+            if(GameAnalytics::isThreadEnding())
             {
-                initializeLog();
+                //return;
             }
-            if(device::GADevice::getWritablePathStatus() <= 0)
+
+            if(customLogHandler)
             {
+                customLogHandler(message, type);
                 return;
             }
+
+#if !USE_UWP && !USE_TIZEN
+            LogLine* line = acquireLine();
+            line->length = strlen(message);
+            line->text.assign(message, message + line->length + 1);
+            line->type = type;
+            queueLine(line);
+#else
+#if USE_UWP
+            auto m = ref new Platform::String(utilities::GAUtilities::s2ws(message).c_str());
+            Platform::Collections::Vector<Platform::String^>^ lines = ref new Platform::Collections::Vector<Platform::String^>();
+            lines->Append(m);
 #endif
+
             switch(type)
             {
                 case gameanalytics::LogError:
@@ -516,9 +689,6 @@ namespace gameanalytics
                     LogMessageToConsole(m);
 #elif USE_TIZEN
                     dlog_print(DLOG_ERROR, GALogger::tag, message);
-#else
-                    std::cout << message << std::endl;
-                    fprintf(log_file, "%s\n", message);
 #endif
                     break;
 
@@ -534,9 +704,6 @@ namespace gameanalytics
                     LogMessageToConsole(m);
 #elif USE_TIZEN
                     dlog_print(DLOG_WARN, GALogger::tag, message);
-#else
-                    std::cout << message << std::endl;
-                    fprintf(log_file, "%s\n", message);
 #endif
                     break;
 
@@ -552,9 +719,6 @@ namespace gameanalytics
                     LogMessageToConsole(m);
 #elif USE_TIZEN
                     dlog_print(DLOG_DEBUG, GALogger::tag, message);
-#else
-                    std::cout << message << std::endl;
-                    fprintf(log_file, "%s\n", message);
 #endif
                     break;
 
@@ -570,12 +734,10 @@ namespace gameanalytics
                     LogMessageToConsole(m);
 #elif USE_TIZEN
                     dlog_print(DLOG_INFO, GALogger::tag, message);
-#else
-                    std::cout << message << std::endl;
-                    fprintf(log_file, "%s\n", message);
 #endif
                     break;
             }
+#endif
         }
 
 #if USE_UWP
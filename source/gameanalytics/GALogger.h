@@ -7,14 +7,20 @@
 
 #include <memory>
 #include <cstdio>
+#include <cstdarg>
 #include <future>
+#include <vector>
+#include <atomic>
 #if !USE_UWP && !USE_TIZEN
 #define ZF_LOG_SRCLOC ZF_LOG_SRCLOC_NONE
 #include "zf_log.h"
+#include <thread>
+#include <condition_variable>
 #endif
 #include <mutex>
 #include <cstdlib>
 #include "GameAnalytics.h"
+#include "GAThreading.h"
 
 namespace gameanalytics
 {
@@ -28,6 +34,11 @@ namespace gameanalytics
             static void setVerboseInfoLog(bool enabled);
             static void setCustomLogHandler(const std::function<void(const char *, EGALoggerMessageType)> &handler);
 
+            // check these before building anything that is only needed for an i/ii/d message
+            static bool isInfoEnabled();
+            static bool isVerboseInfoEnabled();
+            static bool isDebugEnabled();
+
             // Debug (w/e always shows, d only shows during SDK development, i shows when client has set debugEnabled to YES)
             static void w(const char *format, ...);
             static void  e(const char* format, ...);
@@ -37,6 +48,13 @@ namespace gameanalytics
 
 #if !USE_UWP && !USE_TIZEN
             static void customInitializeLog();
+            // blocks until every queued line has been written out
+            static void flushLog();
+            // lines dropped because the log queue was full
+            static unsigned long long getDroppedMessageCount();
+            // ga_log.txt is renamed to ga_log-prev.txt once it reaches maxFileSizeBytes (0 never rotates),
+            // older files move on to ga_log-prev2.txt and so on up to the given number of generations
+            static void setLogRotation(long long maxFileSizeBytes, int generations);
 #endif
         private:
             GALogger();
@@ -44,7 +62,30 @@ namespace gameanalytics
             GALogger(const GALogger&) = delete;
             GALogger& operator=(const GALogger&) = delete;
 
+            // a formatted message, recycled through linePool once it has been written
+            struct LogLine
+            {
+                LogLine() :length(0), type(LogInfo) {}
+
+                std::vector<char> text;
+                size_t length;
+                EGALoggerMessageType type;
+            };
+
+            void logMessage(EGALoggerMessageType type, const char* prefix, const char* format, va_list args);
             void sendNotificationMessage(const char* message, EGALoggerMessageType type);
+            static size_t formatMessage(std::vector<char>& out, const char* prefix, const char* format, va_list args);
+            LogLine* acquireLine();
+            void releaseLine(LogLine* line);
+
+            static const size_t LogQueueCapacity = 4096;
+            static const size_t DefaultLineCapacity = 256;
+            static const size_t MaxPooledLineCapacity = 16384;
+            static const int LogWriterIntervalInMs;
+            static const long long DefaultMaxLogFileSize;
+            static const int DefaultLogGenerations;
+
+            threading::GABoundedQueue<LogLine*, LogQueueCapacity> linePool;
 
             static bool _destroyed;
             static GALogger* _instance;
@@ -77,10 +118,36 @@ namespace gameanalytics
 #endif
 #if !USE_UWP && !USE_TIZEN
             static void file_output_callback(const zf_log_message *msg, void *arg);
-            bool logInitialized;
+            bool openLogFile();
+            // lines are written to stdout and the log file by the writer thread in batches
+            void queueLine(LogLine* line);
+            void startLogWriter();
+            void wakeLogWriter();
+            void runLogWriter();
+            // returns true when it stopped with lines still queued
+            bool writeQueuedLines();
+            void rotateLogIfNeeded(size_t writtenBytes);
+            // generation 0 is the current log file
+            static void logFilePath(int generation, char* out, size_t size);
+
+            threading::GABoundedQueue<LogLine*, LogQueueCapacity> queuedLines;
+            std::atomic<size_t> queuedLineCount;
+            std::atomic_ullong droppedMessages;
+            unsigned long long reportedDroppedMessages;
+            std::vector<char> batch;
+            std::once_flag writerStartedFlag;
+            std::thread writerThread;
+            std::mutex writerMutex;
+            std::condition_variable writerCondition;
+            bool wakeWriter;
+            bool stopWriter;
+            // guards log_file, batch and the rotation settings
+            std::mutex fileMutex;
+            std::atomic<bool> logInitialized;
             FILE *log_file;
-            int currentLogCount;
-            int maxLogCount;
+            long long currentLogSize;
+            long long maxLogSize;
+            int logGenerations;
             char p[513] = {'\0'};
 #endif
         };
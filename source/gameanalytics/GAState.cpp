@@ -40,6 +40,73 @@ namespace gameanalytics
         rapidjson::Document GAState::countMap;
         rapidjson::Document GAState::timestampMap;
 
+        RemoteConfigsSnapshot::RemoteConfigsSnapshot()
+        {
+            configurations.SetObject();
+        }
+
+        void RemoteConfigsSnapshot::buildIndex()
+        {
+            index.clear();
+            numberStrings.clear();
+            index.reserve(configurations.MemberCount());
+            for (rapidjson::Value::ConstMemberIterator itr = configurations.MemberBegin(); itr != configurations.MemberEnd(); ++itr)
+            {
+                // the first of duplicate keys wins, like rapidjson's own lookup
+                if(index.find(itr->name.GetString()) != index.end())
+                {
+                    continue;
+                }
+
+                RemoteConfigsEntry& entry = index[itr->name.GetString()];
+                if(itr->value.IsString())
+                {
+                    entry.string = itr->value.GetString();
+                    // numbers and booleans sent as strings, parsed as JSON so the decimal point doesn't depend on the locale
+                    rapidjson::Document parsed;
+                    parsed.Parse(entry.string);
+                    if(!parsed.HasParseError())
+                    {
+                        convertValue(parsed, entry);
+                    }
+                }
+                else if(itr->value.IsNumber())
+                {
+                    rapidjson::StringBuffer buffer;
+                    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+                    itr->value.Accept(writer);
+                    numberStrings.push_back(buffer.GetString());
+                    entry.string = numberStrings.back().c_str();
+                    convertValue(itr->value, entry);
+                }
+            }
+        }
+
+        void RemoteConfigsSnapshot::convertValue(const rapidjson::Value& value, RemoteConfigsEntry& out)
+        {
+            if(value.IsInt64())
+            {
+                out.int64Value = value.GetInt64();
+                out.isInt64 = true;
+            }
+            if(value.IsNumber())
+            {
+                out.doubleValue = value.GetDouble();
+                out.isDouble = true;
+            }
+            else if(value.IsBool())
+            {
+                out.boolValue = value.GetBool();
+                out.isBool = true;
+            }
+        }
+
+        const RemoteConfigsEntry* RemoteConfigsSnapshot::find(const char* key) const
+        {
+            std::unordered_map<const char*, RemoteConfigsEntry, CStringHash, CStringEqual>::const_iterator itr = index.find(key);
+            return itr != index.end() ? &itr->second : nullptr;
+        }
+
         GAState::GAState()
         {
         }
@@ -163,15 +230,17 @@ namespace gameanalytics
             return i->_currentCustomDimension03;
         }
 
-        void GAState::getGlobalCustomEventFields(rapidjson::Document& out)
+        const CustomFields& GAState::getGlobalCustomEventFields()
         {
+            static const CustomFields empty;
+
             GAState *i = getInstance();
             if (!i)
             {
-                return;
+                return empty;
             }
 
-            out.CopyFrom(i->_currentGlobalCustomEventFields, out.GetAllocator());
+            return i->_currentGlobalCustomEventFields;
         }
 
         void GAState::setAvailableCustomDimensions01(const StringVector& availableCustomDimensions)
@@ -279,6 +348,7 @@ namespace gameanalytics
             }
 
             snprintf(i->_build, sizeof(i->_build), "%s", build);
+            invalidateEventAnnotations();
 
             logging::GALogger::i("Set build: %s", build);
         }
@@ -388,27 +458,31 @@ namespace gameanalytics
                 return;
             }
 
+            i->_currentGlobalCustomEventFields.clear();
             if (!customFields || strlen(customFields) == 0)
             {
-                rapidjson::Document d;
-                d.SetObject();
-                i->_currentGlobalCustomEventFields.CopyFrom(d, i->_currentGlobalCustomEventFields.GetAllocator());
                 return;
             }
 
+            // validated once here instead of for every event
             rapidjson::Document d;
             d.Parse(customFields);
-            if(!d.IsNull())
-            {
-                i->_currentGlobalCustomEventFields.CopyFrom(d, i->_currentGlobalCustomEventFields.GetAllocator());
-            }
-            else
+            validateAndCleanCustomFields(d, i->_currentGlobalCustomEventFields);
+
+            logging::GALogger::i("Set global custom event fields: %s", customFields);
+        }
+
+        void GAState::setGlobalCustomEventFields(const CustomFields& customFields)
+        {
+            GAState *i = getInstance();
+            if (!i)
             {
-                d.SetObject();
-                i->_currentGlobalCustomEventFields.CopyFrom(d, i->_currentGlobalCustomEventFields.GetAllocator());
+                return;
             }
 
-            logging::GALogger::i("Set global custom event fields: %s", customFields);
+            i->_currentGlobalCustomEventFields = customFields;
+
+            logging::GALogger::i("Set global custom event fields: %d fields", customFields.getCount());
         }
 
         void GAState::incrementSessionNum()
@@ -629,6 +703,19 @@ namespace gameanalytics
         }
 
         void GAState::getEventAnnotations(rapidjson::Document& out)
+        {
+            out.SetObject();
+            addStaticEventAnnotations(out, out.GetAllocator());
+            addDynamicEventAnnotations(out, out.GetAllocator());
+        }
+
+        void GAState::getDynamicEventAnnotations(rapidjson::Document& out)
+        {
+            out.SetObject();
+            addDynamicEventAnnotations(out, out.GetAllocator());
+        }
+
+        void GAState::appendStaticEventAnnotations(rapidjson::StringBuffer& out)
         {
             GAState* i = getInstance();
             if(!i)
@@ -636,21 +723,67 @@ namespace gameanalytics
                 return;
             }
 
-            out.SetObject();
-            rapidjson::Document::AllocatorType& allocator = out.GetAllocator();
+            std::lock_guard<std::mutex> lock(i->_annotationsMtx);
+            int version = i->_annotationsVersion;
+            if (version != i->_staticAnnotationsVersion)
+            {
+                rapidjson::Document annotations;
+                annotations.SetObject();
+                addStaticEventAnnotations(annotations, annotations.GetAllocator());
 
-            // ---- REQUIRED ---- //
+                rapidjson::StringBuffer buffer;
+                rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+                annotations.Accept(writer);
 
-            // collector event API version
-            out.AddMember("v", 2, allocator);
+                // without the surrounding braces
+                const char* json = buffer.GetString();
+                i->_staticAnnotations.assign(json + 1, json + buffer.GetSize() - 1);
+                i->_staticAnnotationsVersion = version;
+            }
 
-            // Event UUID
+            if (!i->_staticAnnotations.empty())
             {
-                char id[129] = "";
-                utilities::GAUtilities::generateUUID(id);
-                rapidjson::Value v(id, allocator);
-                out.AddMember("event_uuid", v.Move(), allocator);
+                memcpy(out.Push(i->_staticAnnotations.size()), i->_staticAnnotations.data(), i->_staticAnnotations.size());
             }
+        }
+
+        bool GAState::isStaticEventAnnotation(const char* key)
+        {
+            static const char* keys[] = { "v", "user_id", "configurations", "ab_id", "ab_variant_id", "sdk_version", "os_version",
+                "manufacturer", "device", "platform", "engine_version", "uwp_aid", "uwp_id", "tizen_id", "build" };
+
+            for (const char* k : keys)
+            {
+                if (strcmp(k, key) == 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void GAState::invalidateEventAnnotations()
+        {
+            GAState* i = getInstance();
+            if(!i)
+            {
+                return;
+            }
+            ++i->_annotationsVersion;
+        }
+
+        void GAState::addStaticEventAnnotations(rapidjson::Value& out, rapidjson::Document::AllocatorType& allocator)
+        {
+            GAState* i = getInstance();
+            if(!i)
+            {
+                return;
+            }
+
+            // ---- REQUIRED ---- //
+
+            // collector event API version
+            out.AddMember("v", 2, allocator);
 
             // User identifier
             {
@@ -659,11 +792,14 @@ namespace gameanalytics
             }
 
             // remote configs configurations
-            if(i->_configurations.IsObject() && i->_configurations.MemberCount() > 0)
             {
-                rapidjson::Value v(rapidjson::kObjectType);
-                v.CopyFrom(i->_configurations, i->_configurations.GetAllocator());
-                out.AddMember("configurations", v.Move(), allocator);
+                std::shared_ptr<const RemoteConfigsSnapshot> remoteConfigs = getRemoteConfigsSnapshot();
+                if(remoteConfigs && remoteConfigs->configurations.MemberCount() > 0)
+                {
+                    rapidjson::Value v(rapidjson::kObjectType);
+                    v.CopyFrom(remoteConfigs->configurations, allocator);
+                    out.AddMember("configurations", v.Move(), allocator);
+                }
             }
 
             // A/B testing
@@ -678,8 +814,6 @@ namespace gameanalytics
                 out.AddMember("ab_variant_id", v.Move(), allocator);
             }
 
-            // Client Timestamp (the adjusted timestamp)
-            out.AddMember("client_ts", GAState::getClientTsAdjusted(), allocator);
             // SDK version
             {
                 rapidjson::Value v(device::GADevice::getRelevantSdkVersion(), allocator);
@@ -705,21 +839,6 @@ namespace gameanalytics
                 rapidjson::Value v(device::GADevice::getBuildPlatform(), allocator);
                 out.AddMember("platform", v.Move(), allocator);
             }
-            // Session identifier
-            {
-                rapidjson::Value v(i->_sessionId, allocator);
-                out.AddMember("session_id", v.Move(), allocator);
-            }
-            // Session number
-            out.AddMember("session_num", getSessionNum(), allocator);
-
-            // type of connection the user is currently on (add if valid)
-            const char* connection_type = device::GADevice::getConnectionType();
-            if (validators::GAValidator::validateConnectionType(connection_type))
-            {
-                rapidjson::Value v(connection_type, allocator);
-                out.AddMember("connection_type", v.Move(), allocator);
-            }
 
             if(strlen(device::GADevice::getGameEngineVersion()) > 0)
             {
@@ -756,6 +875,50 @@ namespace gameanalytics
             }
         }
 
+        void GAState::addDynamicEventAnnotations(rapidjson::Value& out, rapidjson::Document::AllocatorType& allocator)
+        {
+            GAState* i = getInstance();
+            if(!i)
+            {
+                return;
+            }
+
+            // Event UUID
+            {
+                char id[129] = "";
+                utilities::GAUtilities::generateUUID(id);
+                rapidjson::Value v(id, allocator);
+                out.AddMember("event_uuid", v.Move(), allocator);
+            }
+
+            // Client Timestamp (the adjusted timestamp)
+            out.AddMember("client_ts", GAState::getClientTsAdjusted(), allocator);
+
+            // Session identifier
+            {
+                rapidjson::Value v(i->_sessionId, allocator);
+                out.AddMember("session_id", v.Move(), allocator);
+            }
+            // Session number
+            out.AddMember("session_num", getSessionNum(), allocator);
+
+            // type of connection the user is currently on (add if valid), only validated when it changes
+            const char* connection_type = device::GADevice::getConnectionType();
+            {
+                std::lock_guard<std::mutex> lock(i->_annotationsMtx);
+                if (strcmp(connection_type, i->_connectionType) != 0)
+                {
+                    snprintf(i->_connectionType, sizeof(i->_connectionType), "%s", connection_type);
+                    i->_connectionTypeIsValid = validators::GAValidator::validateConnectionType(i->_connectionType);
+                }
+                if (i->_connectionTypeIsValid)
+                {
+                    rapidjson::Value v(i->_connectionType, allocator);
+                    out.AddMember("connection_type", v.Move(), allocator);
+                }
+            }
+        }
+
         void GAState::getSdkErrorEventAnnotations(rapidjson::Document& out)
         {
             out.SetObject();
@@ -901,6 +1064,7 @@ namespace gameanalytics
                 snprintf(i->_identifier, sizeof(i->_identifier), "%s", i->_defaultUserId);
             }
 
+            invalidateEventAnnotations();
             logging::GALogger::d("identifier, {clean:%s}", i->_identifier);
         }
 
@@ -1042,6 +1206,9 @@ namespace gameanalytics
 
             logging::GALogger::i("Starting a new session.");
 
+            // device ids can arrive after the previous session started
+            invalidateEventAnnotations();
+
             // make sure the current custom dimensions are valid
             GAState::validateAndFixCurrentDimensions();
 
@@ -1277,21 +1444,16 @@ namespace gameanalytics
         std::vector<char> GAState::getRemoteConfigsStringValue(const char* key, const char* defaultValue)
         {
             std::vector<char> result;
-            GAState* i = getInstance();
-            if(!i)
+            std::shared_ptr<const RemoteConfigsSnapshot> remoteConfigs = getRemoteConfigsSnapshot();
+            if(!remoteConfigs)
             {
                 result.push_back('\0');
                 return result;
             }
-            std::lock_guard<std::mutex> lg(i->_mtx);
-            const char* returnValue = i->_configurations.HasMember(key) ? i->_configurations[key].GetString() : defaultValue;
 
-            size_t s = strlen(returnValue);
-            for(size_t i = 0; i < s; ++i)
-            {
-                result.push_back(returnValue[i]);
-            }
-            result.push_back('\0');
+            const RemoteConfigsEntry* entry = remoteConfigs->find(key);
+            const char* returnValue = entry ? entry->string : defaultValue;
+            result.assign(returnValue, returnValue + strlen(returnValue) + 1);
 
             return result;
         }
@@ -1314,6 +1476,7 @@ namespace gameanalytics
                 return;
             }
 
+            std::lock_guard<std::mutex> lock(i->_remoteConfigsListenersMtx);
             if(std::find(i->_remoteConfigsListeners.begin(), i->_remoteConfigsListeners.end(), listener) == i->_remoteConfigsListeners.end())
             {
                 i->_remoteConfigsListeners.push_back(listener);
@@ -1328,6 +1491,7 @@ namespace gameanalytics
                 return;
             }
 
+            std::lock_guard<std::mutex> lock(i->_remoteConfigsListenersMtx);
             if(std::find(i->_remoteConfigsListeners.begin(), i->_remoteConfigsListeners.end(), listener) != i->_remoteConfigsListeners.end())
             {
                 i->_remoteConfigsListeners.erase(std::remove(i->_remoteConfigsListeners.begin(), i->_remoteConfigsListeners.end(), listener), i->_remoteConfigsListeners.end());
@@ -1337,8 +1501,8 @@ namespace gameanalytics
         std::vector<char> GAState::getRemoteConfigsContentAsString()
         {
             std::vector<char> result;
-            GAState* i = getInstance();
-            if(!i)
+            std::shared_ptr<const RemoteConfigsSnapshot> remoteConfigs = getRemoteConfigsSnapshot();
+            if(!remoteConfigs)
             {
                 result.push_back('\0');
                 return result;
@@ -1346,17 +1510,32 @@ namespace gameanalytics
 
             rapidjson::StringBuffer buffer;
             rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
-            i->_configurations.Accept(writer);
-            const char* returnValue = buffer.GetString();
+            remoteConfigs->configurations.Accept(writer);
+            result.assign(buffer.GetString(), buffer.GetString() + buffer.GetSize() + 1);
 
-            size_t s = strlen(returnValue);
-            for(size_t i = 0; i < s; ++i)
+            return result;
+        }
+
+        std::shared_ptr<const RemoteConfigsSnapshot> GAState::getRemoteConfigsSnapshot()
+        {
+            GAState* i = getInstance();
+            if(!i)
             {
-                result.push_back(returnValue[i]);
+                return nullptr;
             }
-            result.push_back('\0');
 
-            return result;
+            return std::atomic_load(&i->_remoteConfigs);
+        }
+
+        int GAState::getRemoteConfigsVersion()
+        {
+            GAState* i = getInstance();
+            if(!i)
+            {
+                return -1;
+            }
+
+            return i->_remoteConfigsVersion;
         }
 
         void GAState::populateConfigurations(rapidjson::Value& sdkConfig)
@@ -1366,16 +1545,17 @@ namespace gameanalytics
             {
                 return;
             }
-            i->_mtx.lock();
 
-            i->_configurations.SetObject();
-            rapidjson::Document::AllocatorType& allocator = i->_configurations.GetAllocator();
+            // built aside and swapped in whole, readers keep the snapshot they already hold
+            std::shared_ptr<RemoteConfigsSnapshot> remoteConfigs = std::make_shared<RemoteConfigsSnapshot>();
+            rapidjson::Document& configurations = remoteConfigs->configurations;
+            rapidjson::Document::AllocatorType& allocator = configurations.GetAllocator();
 
             if(sdkConfig.HasMember("configs") && sdkConfig["configs"].IsArray())
             {
-                rapidjson::Value& configurations = sdkConfig["configs"];
+                rapidjson::Value& sdkConfigurations = sdkConfig["configs"];
 
-                for (rapidjson::Value::ConstValueIterator itr = configurations.Begin(); itr != configurations.End(); ++itr)
+                for (rapidjson::Value::ConstValueIterator itr = sdkConfigurations.Begin(); itr != sdkConfigurations.End(); ++itr)
                 {
                     const rapidjson::Value& configuration = *itr;
 
@@ -1392,7 +1572,7 @@ namespace gameanalytics
                             {
                                 rapidjson::Value v(key, allocator);
                                 rapidjson::Value v1(configuration["value"].GetString(), allocator);
-                                i->_configurations.AddMember(v.Move(), v1.Move(), allocator);
+                                configurations.AddMember(v.Move(), v1.Move(), allocator);
                             }
                             else if(configuration["value"].IsNumber())
                             {
@@ -1400,35 +1580,48 @@ namespace gameanalytics
 
                                 if(configuration["value"].IsInt64())
                                 {
-                                    i->_configurations.AddMember(v.Move(), configuration["value"].GetInt64(), allocator);
+                                    configurations.AddMember(v.Move(), configuration["value"].GetInt64(), allocator);
                                 }
                                 else if(configuration["value"].IsInt())
                                 {
-                                    i->_configurations.AddMember(v.Move(), configuration["value"].GetInt(), allocator);
+                                    configurations.AddMember(v.Move(), configuration["value"].GetInt(), allocator);
                                 }
                                 else if(configuration["value"].IsDouble())
                                 {
-                                    i->_configurations.AddMember(v.Move(), configuration["value"].GetDouble(), allocator);
+                                    configurations.AddMember(v.Move(), configuration["value"].GetDouble(), allocator);
                                 }
                             }
 
-                            rapidjson::StringBuffer buffer;
-                            rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
-                            configuration.Accept(writer);
+                            if (logging::GALogger::isDebugEnabled())
+                            {
+                                rapidjson::StringBuffer buffer;
+                                rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+                                configuration.Accept(writer);
 
-                            logging::GALogger::d("configuration added: %s", buffer.GetString());
+                                logging::GALogger::d("configuration added: %s", buffer.GetString());
+                            }
                         }
                     }
                 }
             }
+            remoteConfigs->buildIndex();
 
+            std::atomic_store(&i->_remoteConfigs, std::shared_ptr<const RemoteConfigsSnapshot>(remoteConfigs));
+            // after the snapshot, so whoever sees the new version also gets the new snapshot
+            ++i->_remoteConfigsVersion;
             i->_remoteConfigsIsReady = true;
-            for(auto& listener : i->_remoteConfigsListeners)
+            invalidateEventAnnotations();
+
+            // listeners are called without holding a lock, so they can read the new configs or (un)register listeners
+            std::vector<std::shared_ptr<IRemoteConfigsListener>> listeners;
+            {
+                std::lock_guard<std::mutex> lock(i->_remoteConfigsListenersMtx);
+                listeners = i->_remoteConfigsListeners;
+            }
+            for(auto& listener : listeners)
             {
                 listener->onRemoteConfigsUpdated();
             }
-
-            i->_mtx.unlock();
         }
 
         void GAState::addErrorEvent(const char* baseMessage, EGAErrorSeverity severity, const char* message)
@@ -1480,11 +1673,9 @@ namespace gameanalytics
             std::array<char, 8200> message_ = {'\0'};
             snprintf(message_.data(), message_.size(), "%s", message ? message : "");
 
-            threading::GAThreading::performTaskOnGAThread([baseMessage_, severity, message_]()
+            threading::GAThreading::performEventTaskOnGAThread([baseMessage_, severity, message_]()
             {
-                rapidjson::Document fieldsJson;
-                fieldsJson.Parse("{}");
-                events::GAEvents::addErrorEvent(severity, message_.data(), fieldsJson, true);
+                events::GAEvents::addErrorEvent(severity, message_.data(), CustomFields(), true);
 
                 countMap.FindMember(baseMessage_.data())->value = countMap[baseMessage_.data()].GetInt() + 1;
             });
@@ -1492,18 +1683,41 @@ namespace gameanalytics
 
         void GAState::validateAndCleanCustomFields(const rapidjson::Value& fields, rapidjson::Value& out)
         {
+            CustomFields cleanedFields;
+            validateAndCleanCustomFields(fields, cleanedFields);
+
             rapidjson::Document result;
             result.SetObject();
             rapidjson::Document::AllocatorType& allocator = result.GetAllocator();
 
-            if (fields.IsObject() && fields.MemberCount() > 0)
+            size_t position = 0;
+            CustomFields::Field field;
+            while (cleanedFields.next(position, field))
             {
-                int count = 0;
+                rapidjson::Value v(field.key, allocator);
+                if (field.isNumber)
+                {
+                    result.AddMember(v.Move(), field.number, allocator);
+                }
+                else
+                {
+                    rapidjson::Value v1(field.string, allocator);
+                    result.AddMember(v.Move(), v1.Move(), allocator);
+                }
+            }
+
+            out.CopyFrom(result, allocator);
+        }
 
+        void GAState::validateAndCleanCustomFields(const rapidjson::Value& fields, CustomFields& out)
+        {
+            if (fields.IsObject() && fields.MemberCount() > 0)
+            {
                 for (rapidjson::Value::ConstMemberIterator itr = fields.MemberBegin(); itr != fields.MemberEnd(); ++itr)
                 {
                     const char* key = itr->name.GetString();
-                    if(fields[key].IsNull())
+                    const rapidjson::Value& value = itr->value;
+                    if(value.IsNull())
                     {
                         const char* baseMessage = "validateAndCleanCustomFields: entry with key=%s, value=null has been omitted because its key or value is null";
                         std::array<char, 8200> message = {'\0'};
@@ -1511,36 +1725,25 @@ namespace gameanalytics
                         logging::GALogger::w(message.data());
                         addErrorEvent(baseMessage, EGAErrorSeverity::Warning, message.data());
                     }
-                    else if(count < MAX_CUSTOM_FIELDS_COUNT)
+                    else if(out.getCount() < MAX_CUSTOM_FIELDS_COUNT)
                     {
-                        char pattern[65] = "";
-                        snprintf(pattern, sizeof(pattern), "^[a-zA-Z0-9_]{1,%d}$", MAX_CUSTOM_FIELDS_KEY_LENGTH);
-                        if(utilities::GAUtilities::stringMatch(key, pattern))
+                        if(validators::GAValidator::validateCustomFieldKey(key))
                         {
-                            const rapidjson::Value& value = fields[key];
-
                             if(value.IsNumber())
                             {
-                                rapidjson::Value v(key, allocator);
-                                result.AddMember(v.Move(), value.GetDouble(), allocator);
-                                ++count;
+                                out.append(key, value.GetDouble());
                             }
                             else if(value.IsString())
                             {
-                                std::string valueAsString = value.GetString();
-
-                                if(valueAsString.length() <= MAX_CUSTOM_FIELDS_VALUE_STRING_LENGTH && valueAsString.length() > 0)
+                                if(validators::GAValidator::validateCustomFieldStringValue(value.GetString()))
                                 {
-                                    rapidjson::Value v(key, allocator);
-                                    rapidjson::Value v1(value.GetString(), allocator);
-                                    result.AddMember(v.Move(), v1.Move(), allocator);
-                                    ++count;
+                                    out.append(key, value.GetString());
                                 }
                                 else
                                 {
                                     const char* baseMessage = "validateAndCleanCustomFields: entry with key=%s, value=%s has been omitted because its value is an empty string or exceeds the max number of characters (%d)";
                                     std::array<char, 8200> message = {'\0'};
-                                    snprintf(message.data(), message.size(), baseMessage, key, fields[key].GetString(), MAX_CUSTOM_FIELDS_VALUE_STRING_LENGTH);
+                                    snprintf(message.data(), message.size(), baseMessage, key, value.GetString(), MAX_CUSTOM_FIELDS_VALUE_STRING_LENGTH);
                                     logging::GALogger::w(message.data());
                                     addErrorEvent(baseMessage, EGAErrorSeverity::Warning, message.data());
                                 }
@@ -1558,7 +1761,7 @@ namespace gameanalytics
                         {
                             const char* baseMessage = "validateAndCleanCustomFields: entry with key=%s, value=%s has been omitted because its key contains illegal character, is empty or exceeds the max number of characters (%d)";
                             std::array<char, 8200> message = {'\0'};
-                            snprintf(message.data(), message.size(), baseMessage, key, fields[key].GetString(), MAX_CUSTOM_FIELDS_KEY_LENGTH);
+                            snprintf(message.data(), message.size(), baseMessage, key, value.IsString() ? value.GetString() : "", MAX_CUSTOM_FIELDS_KEY_LENGTH);
                             logging::GALogger::w(message.data());
                             addErrorEvent(baseMessage, EGAErrorSeverity::Warning, message.data());
                         }
@@ -1573,8 +1776,6 @@ namespace gameanalytics
                     }
                 }
             }
-
-            out.CopyFrom(result, allocator);
         }
 
         int64_t GAState::getClientTsAdjusted()
@@ -1710,6 +1911,7 @@ namespace gameanalytics
             }
 
             snprintf(i->_abId, sizeof(i->_abId), "%s", abId);
+            invalidateEventAnnotations();
         }
 
         void GAState::setAbVariantId(const char* abVariantId)
@@ -1721,6 +1923,7 @@ namespace gameanalytics
             }
 
             snprintf(i->_abVariantId, sizeof(i->_abVariantId), "%s", abVariantId);
+            invalidateEventAnnotations();
         }
 
         std::vector<char> GAState::getAbId()
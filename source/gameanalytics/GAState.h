@@ -7,10 +7,16 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <deque>
+#include <string>
+#include <memory>
 #include <functional>
 #include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
 #include "GameAnalytics.h"
 #include <mutex>
+#include <atomic>
 #include <cstdlib>
 
 namespace gameanalytics
@@ -28,6 +34,63 @@ namespace gameanalytics
             }
         };
 
+        // FNV-1a
+        struct CStringHash
+        {
+            size_t operator()(const char* s) const
+            {
+                size_t hash = 2166136261u;
+                for(; *s != '\0'; ++s)
+                {
+                    hash = (hash ^ static_cast<unsigned char>(*s)) * 16777619u;
+                }
+                return hash;
+            }
+        };
+
+        struct CStringEqual
+        {
+            bool operator()(const char* first, const char* second) const
+            {
+                return strcmp(first, second) == 0;
+            }
+        };
+
+        // a remote config value, converted to every type it can be read as when the snapshot is built
+        struct RemoteConfigsEntry
+        {
+            // the value as text, numbers included
+            const char* string = "";
+            int64_t int64Value = 0;
+            double doubleValue = 0;
+            bool boolValue = false;
+            bool isInt64 = false;
+            bool isDouble = false;
+            bool isBool = false;
+        };
+
+        // the remote configs of one refresh, never changed once published so a reader holding one needs no lock
+        class RemoteConfigsSnapshot
+        {
+         public:
+            RemoteConfigsSnapshot();
+
+            // indexes the members of configurations, called once they have all been added
+            void buildIndex();
+            // null when there is no config with the key
+            const RemoteConfigsEntry* find(const char* key) const;
+
+            rapidjson::Document configurations;
+
+         private:
+            static void convertValue(const rapidjson::Value& value, RemoteConfigsEntry& out);
+
+            // keys point into configurations
+            std::unordered_map<const char*, RemoteConfigsEntry, CStringHash, CStringEqual> index;
+            // text of the number values, a deque never moves its strings
+            std::deque<std::string> numberStrings;
+        };
+
         struct ProgressionTry
         {
         public:
@@ -107,7 +170,7 @@ namespace gameanalytics
             static const char* getCurrentCustomDimension01();
             static const char* getCurrentCustomDimension02();
             static const char* getCurrentCustomDimension03();
-            static void getGlobalCustomEventFields(rapidjson::Document& out);
+            static const CustomFields& getGlobalCustomEventFields();
             static const char* getGameKey();
             static const char* getGameSecret();
             static void setAvailableCustomDimensions01(const StringVector& dimensions);
@@ -121,6 +184,7 @@ namespace gameanalytics
             static void setCustomDimension02(const char* dimension);
             static void setCustomDimension03(const char* dimension);
             static void setGlobalCustomEventFields(const char *customFields);
+            static void setGlobalCustomEventFields(const CustomFields& customFields);
             static void incrementSessionNum();
             static void incrementTransactionNum();
             static void incrementProgressionTries(const char* progression);
@@ -135,6 +199,13 @@ namespace gameanalytics
             static void endSessionAndStopQueue(bool endThread);
             static void resumeSessionAndStartQueue();
             static void getEventAnnotations(rapidjson::Document& out);
+            // the annotations that change per event (event_uuid, client_ts, session and connection)
+            static void getDynamicEventAnnotations(rapidjson::Document& out);
+            // appends the other annotations as serialized members (no braces), rebuilt only after invalidateEventAnnotations
+            static void appendStaticEventAnnotations(rapidjson::StringBuffer& out);
+            static bool isStaticEventAnnotation(const char* key);
+            // call when an input of the static annotations changes
+            static void invalidateEventAnnotations();
             static void getSdkErrorEventAnnotations(rapidjson::Document& out);
             static void getInitAnnotations(rapidjson::Document& out);
             static void internalInitialize();
@@ -147,11 +218,19 @@ namespace gameanalytics
             static bool isEventSubmissionEnabled();
             static bool sessionIsStarted();
             static void validateAndCleanCustomFields(const rapidjson::Value& fields, rapidjson::Value& out);
+            static void validateAndCleanCustomFields(const rapidjson::Value& fields, CustomFields& out);
             static std::vector<char> getRemoteConfigsStringValue(const char* key, const char* defaultValue);
             static bool isRemoteConfigsReady();
             static void addRemoteConfigsListener(const std::shared_ptr<IRemoteConfigsListener>& listener);
             static void removeRemoteConfigsListener(const std::shared_ptr<IRemoteConfigsListener>& listener);
             static std::vector<char> getRemoteConfigsContentAsString();
+            // the current remote configs, stays valid after a refresh for as long as it is held.
+            // briefly locks (see _remoteConfigs), keys read every frame should use RemoteConfigsValue
+            static std::shared_ptr<const RemoteConfigsSnapshot> getRemoteConfigsSnapshot();
+            // changes every time a new snapshot is published
+            static int getRemoteConfigsVersion();
+            // publishes the "configs" of an init response as a new snapshot
+            static void populateConfigurations(rapidjson::Value& sdkConfig);
             static std::vector<char> getAbId();
             static std::vector<char> getAbVariantId();
 
@@ -170,7 +249,8 @@ namespace gameanalytics
             static void validateAndFixCurrentDimensions();
             static const char* getBuild();
             static int64_t calculateServerTimeOffset(int64_t serverTs);
-            static void populateConfigurations(rapidjson::Value& sdkConfig);
+            static void addStaticEventAnnotations(rapidjson::Value& out, rapidjson::Document::AllocatorType& allocator);
+            static void addDynamicEventAnnotations(rapidjson::Value& out, rapidjson::Document::AllocatorType& allocator);
             static void setConfigsHash(const char* configsHash);
             static void setAbId(const char* abId);
             static void setAbVariantId(const char* abVariantId);
@@ -201,7 +281,7 @@ namespace gameanalytics
             char _currentCustomDimension01[65] = {'\0'};
             char _currentCustomDimension02[65] = {'\0'};
             char _currentCustomDimension03[65] = {'\0'};
-            rapidjson::Document _currentGlobalCustomEventFields;
+            CustomFields _currentGlobalCustomEventFields;
             char _gameKey[65] = {'\0'};
             char _gameSecret[65] = {'\0'};
             StringVector _availableCustomDimensions01;
@@ -225,10 +305,22 @@ namespace gameanalytics
             bool _useManualSessionHandling = false;
             bool _enableErrorReporting = true;
             bool _enableEventSubmission = true;
-            rapidjson::Document _configurations;
-            bool _remoteConfigsIsReady;
+            // published with std::atomic_store by populateConfigurations and read with std::atomic_load.
+            // the shared_ptr atomics are not lock-free in libstdc++ or MSVC, they take a short mutex from a global pool
+            std::shared_ptr<const RemoteConfigsSnapshot> _remoteConfigs = std::make_shared<RemoteConfigsSnapshot>();
+            std::atomic<int> _remoteConfigsVersion{0};
+            std::atomic<bool> _remoteConfigsIsReady{false};
             std::vector<std::shared_ptr<IRemoteConfigsListener>> _remoteConfigsListeners;
-            std::mutex _mtx;
+            std::mutex _remoteConfigsListenersMtx;
+
+            // serialized static annotations and the _annotationsVersion they were built from
+            std::atomic<int> _annotationsVersion{0};
+            int _staticAnnotationsVersion = -1;
+            std::vector<char> _staticAnnotations;
+            std::mutex _annotationsMtx;
+            // last connection type seen and if it passed validation
+            char _connectionType[33] = {'\0'};
+            bool _connectionTypeIsValid = false;
 
             static const int MaxCount;
             static rapidjson::Document countMap;
@@ -8,8 +8,9 @@
 #include "GAThreading.h"
 #include "GALogger.h"
 #include "GAUtilities.h"
-#include <fstream>
 #include <string.h>
+#include <ctype.h>
+#include <algorithm>
 #if USE_UWP
 #elif USE_TIZEN
 #elif _WIN32
@@ -23,15 +24,28 @@ namespace gameanalytics
 {
     namespace store
     {
-        const int GAStore::MaxDbSizeBytes = 6291456;
-        const int GAStore::MaxDbSizeBytesBeforeTrim = 5242880;
+        const long long GAStore::DefaultEventQuotaBytes = 5242880;
+        const int GAStore::EvictionBatchSize = 100;
+        const int GAStore::KeepEventPriority = 10;
+        const size_t GAStore::MaxCachedStatements = 16;
 
         bool GAStore::_destroyed = false;
         GAStore* GAStore::_instance = 0;
         std::once_flag GAStore::_initInstanceFlag;
 
         GAStore::GAStore()
+            :eventQuotaBytes(DefaultEventQuotaBytes)
         {
+            // session and business events are kept, errors and design events go first
+            eventPriorities = {
+                { "user", KeepEventPriority },
+                { "session_end", KeepEventPriority },
+                { "business", KeepEventPriority },
+                { "progression", 4 },
+                { "resource", 3 },
+                { "design", 2 },
+                { "error", 1 }
+            };
         }
 
         void GAStore::cleanUp()
@@ -85,136 +99,377 @@ namespace gameanalytics
 
         void GAStore::executeQuerySync(const char* sql, const char* parameters[], size_t size, bool useTransaction, rapidjson::Document& out)
         {
-            GAStore* i = getInstance();
-            if(!i)
+            // Create mutable array for results
+            out.SetArray();
+            rapidjson::Document::AllocatorType& allocator = out.GetAllocator();
+
+            bool success = queryRowsSync(sql, parameters, size, useTransaction, [&out, &allocator](const GAStoreRow& result)
             {
-                return;
+                rapidjson::Value row(rapidjson::kObjectType);
+                int columnCount = result.getColumnCount();
+                for (int i = 0; i < columnCount; i++)
+                {
+                    const char *column = result.getColumnName(i);
+
+                    if (!column || result.isNull(i))
+                    {
+                        continue;
+                    }
+
+                    rapidjson::Value v(column, allocator);
+                    switch (result.getColumnType(i))
+                    {
+                        case SQLITE_INTEGER:
+                        {
+                            row.AddMember(v.Move(), static_cast<int>(result.getInt64(i)), allocator);
+                            break;
+                        }
+                        case SQLITE_FLOAT:
+                        {
+                            row.AddMember(v.Move(), result.getDouble(i), allocator);
+                            break;
+                        }
+                        default:
+                        {
+                            const char* value = result.getString(i);
+                            rapidjson::Value v1(value, static_cast<rapidjson::SizeType>(result.getStringLength(i)), allocator);
+                            row.AddMember(v.Move(), v1.Move(), allocator);
+                        }
+                    }
+                }
+                out.PushBack(row, allocator);
+                return true;
+            });
+
+            if (!success)
+            {
+                out.SetNull();
             }
-            // Force transaction if it is an update, insert or delete.
-            size_t arraySize = strlen(sql) + 1;
-            char* sqlUpper = new char[arraySize];
-            snprintf(sqlUpper, arraySize, "%s", sql);
-            utilities::GAUtilities::uppercaseString(sqlUpper);
-            if (utilities::GAUtilities::stringMatch(sqlUpper, "^(UPDATE|INSERT|DELETE)"))
+        }
+
+        bool GAStore::queryRowsSync(const char* sql, const RowVisitor& visitor)
+        {
+            return queryRowsSync(sql, {}, 0, false, visitor);
+        }
+
+        bool GAStore::queryRowsSync(const char* sql, const char* parameters[], size_t size, const RowVisitor& visitor)
+        {
+            return queryRowsSync(sql, parameters, size, false, visitor);
+        }
+
+        bool GAStore::queryRowsSync(const char* sql, const char* parameters[], size_t size, bool useTransaction, const RowVisitor& visitor)
+        {
+            GAStore* i = getInstance();
+            if(!i)
             {
-                useTransaction = true;
+                return false;
             }
-            delete[] sqlUpper;
 
             // Get database connection from singelton getInstance
             sqlite3 *sqlDatabasePtr = i->getDatabase();
 
-            // Create mutable array for results
-            out.SetArray();
-            rapidjson::Document::AllocatorType& allocator = out.GetAllocator();
+            // Parameterised statements are reused, sql with inlined values is prepared for this call only
+            sqlite3_stmt *statement;
+            bool isWrite;
+            if (!i->acquireStatement(sql, size > 0, statement, isWrite))
+            {
+                // TODO(nikolaj): Should we do a db validation to see if the db is corrupt here?
+                logging::GALogger::e("SQLITE3 PREPARE ERROR: %s", sqlite3_errmsg(sqlDatabasePtr));
+                return false;
+            }
+
+            // Force transaction if it is an update, insert or delete, unless it runs inside one already
+            useTransaction = (useTransaction || isWrite) && sqlite3_get_autocommit(sqlDatabasePtr) != 0;
 
             if (useTransaction)
             {
-                if (sqlite3_exec(sqlDatabasePtr, "BEGIN;", 0, 0, 0) != SQLITE_OK)
+                if (!i->executeStatement("BEGIN;"))
                 {
                     logging::GALogger::e("SQLITE3 BEGIN ERROR: %s", sqlite3_errmsg(sqlDatabasePtr));
-                    out.SetNull();
-                    return;
+                    i->releaseStatement(statement);
+                    return false;
                 }
             }
 
-            // Create statement
-            sqlite3_stmt *statement;
+            // Bind parameters
+            if (size > 0)
+            {
+                for (size_t index = 0; index < size; index++)
+                {
+                    sqlite3_bind_text(statement, static_cast<int>(index + 1), parameters[index], -1, 0);
+                }
+            }
+
+            // Loop through results
+            GAStoreRow row(statement);
+            while (sqlite3_step(statement) == SQLITE_ROW)
+            {
+                if (!visitor(row))
+                {
+                    break;
+                }
+            }
 
-            // Prepare statement
-            if (sqlite3_prepare_v2(sqlDatabasePtr, sql, -1, &statement, nullptr) == SQLITE_OK)
+            // Hand the statement back (also check for errors of the last step)
+            if (i->releaseStatement(statement) == SQLITE_OK)
             {
-                // Bind parameters
-                if (size > 0)
+                if (useTransaction)
                 {
-                    for (size_t index = 0; index < size; index++)
+                    if (isWrite)
+                    {
+                        i->refreshDbSize();
+                    }
+                    if (!i->executeStatement("COMMIT;"))
                     {
-                        sqlite3_bind_text(statement, static_cast<int>(index + 1), parameters[index], -1, 0);
+                        logging::GALogger::e("SQLITE3 COMMIT ERROR: %s", sqlite3_errmsg(sqlDatabasePtr));
+                        return false;
                     }
                 }
+            }
+            else
+            {
+                logging::GALogger::d("SQLITE3 FINALIZE ERROR: %s", sqlite3_errmsg(sqlDatabasePtr));
 
-                // get columns count
-                int columnCount = sqlite3_column_count(statement);
-
-                // Loop through results
-                while (sqlite3_step(statement) == SQLITE_ROW)
+                if (useTransaction)
                 {
-                    rapidjson::Value row(rapidjson::kObjectType);
-                    for (int i = 0; i < columnCount; i++)
+                    if (!i->executeStatement("ROLLBACK;"))
                     {
-                        const char *column = (const char *)sqlite3_column_name(statement, i);
-                        const char *value = (const char *)sqlite3_column_text(statement, i);
+                        logging::GALogger::e("SQLITE3 ROLLBACK ERROR: %s", sqlite3_errmsg(sqlDatabasePtr));
+                    }
+                }
+                return false;
+            }
 
-                        if (!column || !value)
-                        {
-                            continue;
-                        }
+            return true;
+        }
 
-                        switch (sqlite3_column_type(statement, i))
-                        {
-                            case SQLITE_INTEGER:
-                            {
-                                rapidjson::Value v(column, allocator);
-                                row.AddMember(v.Move(), (int)strtol(value, NULL, 10), allocator);
-                                break;
-                            }
-                            case SQLITE_FLOAT:
-                            {
-                                rapidjson::Value v(column, allocator);
-                                double d;
-                                sscanf(value, "%lf", &d);
-                                row.AddMember(v.Move(), d, allocator);
-                                break;
-                            }
-                            default:
-                            {
-                                rapidjson::Value v(column, allocator);
-                                rapidjson::Value v1(value, allocator);
-                                row.AddMember(v.Move(), v1.Move(), allocator);
-                            }
-                        }
+        bool GAStore::executeBatchQuerySync(const char* sql, const char* parameters[], size_t size, size_t rowCount)
+        {
+            GAStore* i = getInstance();
+            if(!i)
+            {
+                return false;
+            }
+
+            if(rowCount == 0)
+            {
+                return true;
+            }
+
+            sqlite3 *sqlDatabasePtr = i->getDatabase();
+
+            sqlite3_stmt *statement;
+            bool isWrite;
+            if (!i->acquireStatement(sql, true, statement, isWrite))
+            {
+                logging::GALogger::e("SQLITE3 PREPARE ERROR: %s", sqlite3_errmsg(sqlDatabasePtr));
+                return false;
+            }
+
+            bool useTransaction = sqlite3_get_autocommit(sqlDatabasePtr) != 0;
+            if (useTransaction && !i->executeStatement("BEGIN;"))
+            {
+                logging::GALogger::e("SQLITE3 BEGIN ERROR: %s", sqlite3_errmsg(sqlDatabasePtr));
+                i->releaseStatement(statement);
+                return false;
+            }
+
+            bool success = true;
+            for (size_t row = 0; row < rowCount && success; row++)
+            {
+                for (size_t index = 0; index < size; index++)
+                {
+                    sqlite3_bind_text(statement, static_cast<int>(index + 1), parameters[row * size + index], -1, 0);
+                }
+
+                if (sqlite3_step(statement) != SQLITE_DONE)
+                {
+                    logging::GALogger::e("SQLITE3 STEP ERROR: %s", sqlite3_errmsg(sqlDatabasePtr));
+                    success = false;
+                }
+
+                sqlite3_reset(statement);
+                sqlite3_clear_bindings(statement);
+            }
+
+            i->releaseStatement(statement);
+
+            if (!useTransaction)
+            {
+                return success;
+            }
+
+            if (success)
+            {
+                i->refreshDbSize();
+            }
+            if (success && i->executeStatement("COMMIT;"))
+            {
+                return true;
+            }
 
-                        //row[column] = value;
+            if (success)
+            {
+                logging::GALogger::e("SQLITE3 COMMIT ERROR: %s", sqlite3_errmsg(sqlDatabasePtr));
+            }
+            if (!i->executeStatement("ROLLBACK;"))
+            {
+                logging::GALogger::e("SQLITE3 ROLLBACK ERROR: %s", sqlite3_errmsg(sqlDatabasePtr));
+            }
+            return false;
+        }
+
+        bool GAStore::executeInTransactionSync(const std::function<bool()>& body)
+        {
+            GAStore* i = getInstance();
+            if(!i)
+            {
+                return false;
+            }
+
+            sqlite3 *sqlDatabasePtr = i->getDatabase();
+
+            if (!i->executeStatement("BEGIN;"))
+            {
+                logging::GALogger::e("SQLITE3 BEGIN ERROR: %s", sqlite3_errmsg(sqlDatabasePtr));
+                return false;
+            }
+
+            if (body())
+            {
+                i->refreshDbSize();
+                if (i->executeStatement("COMMIT;"))
+                {
+                    return true;
+                }
+                logging::GALogger::e("SQLITE3 COMMIT ERROR: %s", sqlite3_errmsg(sqlDatabasePtr));
+            }
+
+            if (!i->executeStatement("ROLLBACK;"))
+            {
+                logging::GALogger::e("SQLITE3 ROLLBACK ERROR: %s", sqlite3_errmsg(sqlDatabasePtr));
+            }
+            return false;
+        }
+
+        bool GAStore::isWriteStatement(const char* sql)
+        {
+            static const char* writeKeywords[] = { "UPDATE", "INSERT", "DELETE" };
+
+            for (const char* keyword : writeKeywords)
+            {
+                size_t index = 0;
+                while (keyword[index] != '\0' && toupper(static_cast<unsigned char>(sql[index])) == keyword[index])
+                {
+                    ++index;
+                }
+                if (keyword[index] == '\0')
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool GAStore::acquireStatement(const char* sql, bool cache, sqlite3_stmt*& statement, bool& isWrite)
+        {
+            if (cache)
+            {
+                std::lock_guard<std::mutex> lock(statementCacheMutex);
+
+                for (size_t index = 0; index < cachedStatements.size(); index++)
+                {
+                    CachedStatement& cached = cachedStatements[index];
+                    if (!cached.inUse && strcmp(sqlite3_sql(cached.statement), sql) == 0)
+                    {
+                        cached.inUse = true;
+                        statement = cached.statement;
+                        isWrite = cached.isWrite;
+
+                        // keep the most recently used statements at the back
+                        std::rotate(cachedStatements.begin() + index, cachedStatements.begin() + index + 1, cachedStatements.end());
+                        return true;
                     }
-                    out.PushBack(row, allocator);
                 }
             }
-            else
+
+            if (sqlite3_prepare_v2(sqlDatabase, sql, -1, &statement, nullptr) != SQLITE_OK)
             {
-                // TODO(nikolaj): Should we do a db validation to see if the db is corrupt here?
-                logging::GALogger::e("SQLITE3 PREPARE ERROR: %s", sqlite3_errmsg(sqlDatabasePtr));
-                out.SetNull();
-                return;
+                return false;
             }
+            isWrite = isWriteStatement(sql);
 
-            // Destroy statement
-            if (sqlite3_finalize(statement) == SQLITE_OK)
+            if (cache)
             {
-                if (useTransaction)
+                std::lock_guard<std::mutex> lock(statementCacheMutex);
+
+                if (cachedStatements.size() >= MaxCachedStatements)
                 {
-                    if (sqlite3_exec(sqlDatabasePtr, "COMMIT", 0, 0, 0) != SQLITE_OK)
+                    // evict the least recently used statement that is not running right now
+                    for (size_t index = 0; index < cachedStatements.size(); index++)
                     {
-                        logging::GALogger::e("SQLITE3 COMMIT ERROR: %s", sqlite3_errmsg(sqlDatabasePtr));
-                        out.SetNull();
-                        return;
+                        if (!cachedStatements[index].inUse)
+                        {
+                            sqlite3_finalize(cachedStatements[index].statement);
+                            cachedStatements.erase(cachedStatements.begin() + index);
+                            break;
+                        }
                     }
                 }
+
+                if (cachedStatements.size() < MaxCachedStatements)
+                {
+                    CachedStatement cached = { statement, isWrite, true };
+                    cachedStatements.push_back(cached);
+                }
             }
-            else
+
+            return true;
+        }
+
+        int GAStore::releaseStatement(sqlite3_stmt* statement)
+        {
             {
-                logging::GALogger::d("SQLITE3 FINALIZE ERROR: %s", sqlite3_errmsg(sqlDatabasePtr));
+                std::lock_guard<std::mutex> lock(statementCacheMutex);
 
-                out.Clear();
-                if (useTransaction)
+                for (CachedStatement& cached : cachedStatements)
                 {
-                    if (sqlite3_exec(sqlDatabasePtr, "ROLLBACK", 0, 0, 0) != SQLITE_OK)
+                    if (cached.statement == statement)
                     {
-                        logging::GALogger::e("SQLITE3 ROLLBACK ERROR: %s", sqlite3_errmsg(sqlDatabasePtr));
+                        // reset returns the error of the last step, just like finalize does
+                        int result = sqlite3_reset(statement);
+                        sqlite3_clear_bindings(statement);
+                        cached.inUse = false;
+                        return result;
                     }
                 }
-                out.SetNull();
-                return;
             }
+
+            return sqlite3_finalize(statement);
+        }
+
+        bool GAStore::executeStatement(const char* sql)
+        {
+            sqlite3_stmt *statement;
+            bool isWrite;
+            if (!acquireStatement(sql, true, statement, isWrite))
+            {
+                return false;
+            }
+
+            sqlite3_step(statement);
+            return releaseStatement(statement) == SQLITE_OK;
+        }
+
+        void GAStore::finalizeCachedStatements()
+        {
+            std::lock_guard<std::mutex> lock(statementCacheMutex);
+
+            for (CachedStatement& cached : cachedStatements)
+            {
+                sqlite3_finalize(cached.statement);
+            }
+            cachedStatements.clear();
         }
 
         sqlite3* GAStore::getDatabase()
@@ -255,6 +510,15 @@ namespace gameanalytics
 #endif
             }
 
+            // statements prepared on a previously opened database can't be reused
+            i->finalizeCachedStatements();
+            if (i->sqlDatabase)
+            {
+                sqlite3_close(i->sqlDatabase);
+                i->sqlDatabase = nullptr;
+                i->dbReady = false;
+            }
+
             // Open database
             if (sqlite3_open(i->dbPath, &i->sqlDatabase) != SQLITE_OK)
             {
@@ -268,6 +532,9 @@ namespace gameanalytics
                 logging::GALogger::i("Database opened: %s", i->dbPath);
             }
 
+            i->applyDatabaseSettings();
+            i->ensureIncrementalVacuum();
+
             if (dropDatabase)
             {
                 logging::GALogger::d("Drop tables");
@@ -279,18 +546,34 @@ namespace gameanalytics
             }
 
             // Create statements
-            const char* sql_ga_events = "CREATE TABLE IF NOT EXISTS ga_events(status CHAR(50) NOT NULL, category CHAR(50) NOT NULL, session_id CHAR(50) NOT NULL, client_ts CHAR(50) NOT NULL, event TEXT NOT NULL);";
+            // status is 0 for new events and the batch id while an event is being sent
+            const char* sql_ga_events = "CREATE TABLE IF NOT EXISTS ga_events(id INTEGER PRIMARY KEY AUTOINCREMENT, status INTEGER NOT NULL DEFAULT 0, category CHAR(50) NOT NULL, session_id CHAR(50) NOT NULL, client_ts INTEGER NOT NULL, event TEXT NOT NULL);";
             const char* sql_ga_session = "CREATE TABLE IF NOT EXISTS ga_session(session_id CHAR(50) PRIMARY KEY NOT NULL, timestamp CHAR(50) NOT NULL, event TEXT NOT NULL);";
             const char* sql_ga_state = "CREATE TABLE IF NOT EXISTS ga_state(key CHAR(255) PRIMARY KEY NOT NULL, value TEXT);";
             const char* sql_ga_progression = "CREATE TABLE IF NOT EXISTS ga_progression(progression CHAR(255) PRIMARY KEY NOT NULL, tries CHAR(255));";
 
+            // tables created by older versions have no id column and keep everything as text
+            bool hasEventTable = false;
+            bool hasEventIdColumn = false;
+            GAStore::queryRowsSync("PRAGMA table_info(ga_events);", [&hasEventTable, &hasEventIdColumn](const GAStoreRow& row)
+            {
+                hasEventTable = true;
+                hasEventIdColumn = hasEventIdColumn || strcmp(row.getString(1), "id") == 0;
+                return true;
+            });
+            if (hasEventTable && !hasEventIdColumn && !i->migrateEventTable(sql_ga_events))
+            {
+                logging::GALogger::d("ga_events could not be migrated, recreating.");
+                GAStore::executeQuerySync("DROP TABLE ga_events");
+            }
+
             if (!GAStore::executeQuerySync(sql_ga_events))
             {
                 logging::GALogger::d("ensureDatabase failed: %s", sql_ga_events);
                 return false;
             }
 
-            if (!GAStore::executeQuerySync("SELECT status FROM ga_events LIMIT 0,1"))
+            if (!GAStore::executeQuerySync("SELECT id, status FROM ga_events LIMIT 0,1"))
             {
                 logging::GALogger::d("ga_events corrupt, recreating.");
                 GAStore::executeQuerySync("DROP TABLE ga_events");
@@ -301,6 +584,13 @@ namespace gameanalytics
                 }
             }
 
+            // new events are picked in id order, (status) covers that while (status, category, client_ts) serves the category filter
+            if (!GAStore::executeQuerySync("CREATE INDEX IF NOT EXISTS ga_events_status ON ga_events(status);")
+                || !GAStore::executeQuerySync("CREATE INDEX IF NOT EXISTS ga_events_status_category_client_ts ON ga_events(status, category, client_ts);"))
+            {
+                logging::GALogger::w("Could not create ga_events indexes");
+            }
+
             if (!GAStore::executeQuerySync(sql_ga_session))
             {
                 return false;
@@ -349,7 +639,9 @@ namespace gameanalytics
                 }
             }
 
-            trimEventTable();
+            i->refreshDbSize();
+            measureEvents(i->eventCountBound, i->eventBytesBound);
+            enforceEventQuota();
 
             i->tableReady = true;
             logging::GALogger::d("Database tables ensured present");
@@ -357,6 +649,146 @@ namespace gameanalytics
             return true;
         }
 
+        bool GAStore::migrateEventTable(const char* createSql)
+        {
+            logging::GALogger::i("Migrating ga_events to the current schema");
+
+            // pending events are kept, events that were being sent are treated as new again
+            char sql[1025] = "";
+            snprintf(sql, sizeof(sql),
+                "BEGIN;"
+                "ALTER TABLE ga_events RENAME TO ga_events_v1;"
+                "%s"
+                "INSERT INTO ga_events (status, category, session_id, client_ts, event) SELECT 0, category, session_id, CAST(client_ts AS INTEGER), event FROM ga_events_v1 ORDER BY CAST(client_ts AS INTEGER);"
+                "DROP TABLE ga_events_v1;"
+                "COMMIT;", createSql);
+
+            char* error = NULL;
+            if (sqlite3_exec(sqlDatabase, sql, NULL, NULL, &error) != SQLITE_OK)
+            {
+                logging::GALogger::w("ga_events migration failed: %s", error ? error : "");
+                sqlite3_free(error);
+                sqlite3_exec(sqlDatabase, "ROLLBACK;", NULL, NULL, NULL);
+                return false;
+            }
+
+            return true;
+        }
+
+        bool GAStore::executeSetting(const char* sql)
+        {
+            // not run through the statement cache, these are one-off statements
+            char* error = NULL;
+            if (sqlite3_exec(sqlDatabase, sql, NULL, NULL, &error) != SQLITE_OK)
+            {
+                logging::GALogger::w("%s failed: %s", sql, error ? error : "");
+                sqlite3_free(error);
+                return false;
+            }
+            return true;
+        }
+
+        bool GAStore::querySetting(const char* sql, char* out, size_t size)
+        {
+            struct Result
+            {
+                char* out;
+                size_t size;
+            } result = { out, size };
+
+            out[0] = '\0';
+            // the callback stops after the first row, which makes sqlite3_exec return SQLITE_ABORT
+            int rc = sqlite3_exec(sqlDatabase, sql, [](void* r, int columns, char** values, char**) -> int
+            {
+                Result* result = static_cast<Result*>(r);
+                if (columns > 0 && values[0])
+                {
+                    snprintf(result->out, result->size, "%s", values[0]);
+                }
+                return 1;
+            }, &result, NULL);
+            return rc == SQLITE_OK || rc == SQLITE_ABORT;
+        }
+
+        void GAStore::ensureIncrementalVacuum()
+        {
+            // 2 is INCREMENTAL
+            char mode[33] = "";
+            querySetting("PRAGMA auto_vacuum;", mode, sizeof(mode));
+            if (strcmp(mode, "2") == 0)
+            {
+                return;
+            }
+
+            // a new database takes it right away, an existing one is rebuilt once by VACUUM
+            logging::GALogger::d("Enabling incremental auto vacuum");
+            if (executeSetting("PRAGMA auto_vacuum = INCREMENTAL;"))
+            {
+                executeSetting("VACUUM;");
+            }
+        }
+
+        void GAStore::applyDatabaseSettings()
+        {
+            static const char* journalModes[] = { "", "DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL" };
+            static const char* synchronousLevels[] = { "", "OFF", "NORMAL", "FULL", "EXTRA" };
+
+            int journal = 0;
+            int sync = 0;
+            int page = 0;
+            int cache = 0;
+            long long mmap = -1;
+            {
+                std::lock_guard<std::mutex> lock(settingsMutex);
+                journal = journalMode;
+                sync = synchronous;
+                page = pageSize;
+                cache = cacheSizeKibibytes;
+                mmap = mmapSizeBytes;
+            }
+
+            char sql[129] = "";
+
+            // before any table is created, an existing database keeps its page size
+            if (page > 0)
+            {
+                snprintf(sql, sizeof(sql), "PRAGMA page_size = %d;", page);
+                executeSetting(sql);
+            }
+
+            if (journal > 0)
+            {
+                // the mode actually in use is returned, WAL is refused by some file systems
+                snprintf(sql, sizeof(sql), "PRAGMA journal_mode = %s;", journalModes[journal]);
+                char mode[33] = "";
+                querySetting(sql, mode, sizeof(mode));
+                logging::GALogger::d("Database journal mode: %s", mode);
+                if (sqlite3_stricmp(mode, journalModes[journal]) != 0)
+                {
+                    logging::GALogger::w("Could not set database journal mode to %s, using %s", journalModes[journal], mode);
+                }
+            }
+
+            if (sync > 0)
+            {
+                snprintf(sql, sizeof(sql), "PRAGMA synchronous = %s;", synchronousLevels[sync]);
+                executeSetting(sql);
+            }
+
+            if (cache > 0)
+            {
+                // negative values are in KiB instead of pages
+                snprintf(sql, sizeof(sql), "PRAGMA cache_size = -%d;", cache);
+                executeSetting(sql);
+            }
+
+            if (mmap >= 0)
+            {
+                snprintf(sql, sizeof(sql), "PRAGMA mmap_size = %lld;", mmap);
+                executeSetting(sql);
+            }
+        }
+
         void GAStore::setState(const char* key, const char* value)
         {
             if (strlen(value) == 0)
@@ -374,8 +806,30 @@ namespace gameanalytics
         // long long is C 64 bit int
         long long GAStore::getDbSizeBytes()
         {
-            std::ifstream in(getInstance()->dbPath, std::ifstream::ate | std::ifstream::binary);
-            return in.tellg();
+            GAStore* i = GAStore::getInstance();
+            if(!i)
+            {
+                return 0;
+            }
+            return i->dbSizeBytes;
+        }
+
+        void GAStore::refreshDbSize()
+        {
+            // called before a write commits, while sqlite has the page count in memory.
+            // in WAL mode this is the size of the database including pages still in the log
+            sqlite3_stmt* statement;
+            bool isWrite;
+            if (!acquireStatement("SELECT page_count * page_size FROM pragma_page_count(), pragma_page_size();", true, statement, isWrite))
+            {
+                return;
+            }
+
+            if (sqlite3_step(statement) == SQLITE_ROW)
+            {
+                dbSizeBytes = sqlite3_column_int64(statement, 0);
+            }
+            releaseStatement(statement);
         }
 
         bool GAStore::getTableReady()
@@ -390,56 +844,306 @@ namespace gameanalytics
 
         bool GAStore::isDbTooLargeForEvents()
         {
-            return getDbSizeBytes() > MaxDbSizeBytes;
+            GAStore* i = GAStore::getInstance();
+            if(!i)
+            {
+                return false;
+            }
+            return i->quotaExceeded;
         }
 
 
-        bool GAStore::trimEventTable()
+        void GAStore::setJournalMode(EGADatabaseJournalMode mode)
         {
-            if(getDbSizeBytes() > MaxDbSizeBytesBeforeTrim)
+            GAStore* i = GAStore::getInstance();
+            if(!i)
             {
-                rapidjson::Document resultSessionArray;
-                executeQuerySync("SELECT session_id, Max(client_ts) FROM ga_events GROUP BY session_id ORDER BY client_ts LIMIT 3", resultSessionArray);
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(i->settingsMutex);
+                i->journalMode = mode;
+            }
+            if(i->dbReady)
+            {
+                i->applyDatabaseSettings();
+            }
+        }
 
-                if(!resultSessionArray.IsNull() && resultSessionArray.Size() > 0)
-                {
-                    char sessionDeleteString[257] = "";
+        void GAStore::setSynchronous(EGADatabaseSynchronous level)
+        {
+            GAStore* i = GAStore::getInstance();
+            if(!i)
+            {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(i->settingsMutex);
+                i->synchronous = level;
+            }
+            if(i->dbReady)
+            {
+                i->applyDatabaseSettings();
+            }
+        }
 
-                    unsigned int i = 0;
-                    for (rapidjson::Value::ConstValueIterator itr = resultSessionArray.Begin(); itr != resultSessionArray.End(); ++itr)
-                    {
-                        const rapidjson::Value& result = *itr;
-                        const char* session_id = result.GetString();
-                        char tmp[257] = "";
+        void GAStore::setPageSize(int bytes)
+        {
+            GAStore* i = GAStore::getInstance();
+            if(!i)
+            {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(i->settingsMutex);
+                i->pageSize = bytes;
+            }
+            if(i->dbReady)
+            {
+                i->applyDatabaseSettings();
+            }
+        }
 
-                        if(i < resultSessionArray.Size() - 1)
-                        {
-                            snprintf(tmp, 257, "%s%s%s", sessionDeleteString, session_id, ",");
-                        }
-                        else
-                        {
-                            snprintf(tmp, 257, "%s%s", sessionDeleteString, session_id);
-                        }
-                        snprintf(sessionDeleteString, 257, "%s", tmp);
-                        ++i;
-                    }
+        void GAStore::setCacheSize(int kibibytes)
+        {
+            GAStore* i = GAStore::getInstance();
+            if(!i)
+            {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(i->settingsMutex);
+                i->cacheSizeKibibytes = kibibytes;
+            }
+            if(i->dbReady)
+            {
+                i->applyDatabaseSettings();
+            }
+        }
 
-                    char deleteOldSessionsSql[513] = "";
-                    snprintf(deleteOldSessionsSql, 513, "DELETE FROM ga_events WHERE session_id IN (\"%s\");", sessionDeleteString);
-                    logging::GALogger::w("Database too large when initializing. Deleting the oldest 3 sessions.");
-                    executeQuerySync(deleteOldSessionsSql);
-                    executeQuerySync("VACUUM");
+        void GAStore::setMmapSize(long long bytes)
+        {
+            GAStore* i = GAStore::getInstance();
+            if(!i)
+            {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(i->settingsMutex);
+                i->mmapSizeBytes = bytes;
+            }
+            if(i->dbReady)
+            {
+                i->applyDatabaseSettings();
+            }
+        }
 
+        void GAStore::setEventQuota(long long maxBytes, int maxEventCount)
+        {
+            GAStore* i = GAStore::getInstance();
+            if(!i)
+            {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(i->settingsMutex);
+            i->eventQuotaBytes = maxBytes;
+            i->eventQuotaCount = maxEventCount;
+            i->measureOnNextCheck = true;
+        }
+
+        bool GAStore::setEventEvictionPriority(const char* category, int priority)
+        {
+            GAStore* i = GAStore::getInstance();
+            if(!i || !category)
+            {
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(i->settingsMutex);
+            for (EventCategoryPriority& p : i->eventPriorities)
+            {
+                if (strcmp(p.category, category) == 0)
+                {
+                    p.priority = priority;
+                    i->measureOnNextCheck = true;
                     return true;
                 }
-                else
+            }
+            return false;
+        }
+
+        bool GAStore::isEventCategoryEvictable(const char* category)
+        {
+            GAStore* i = GAStore::getInstance();
+            if(!i)
+            {
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(i->settingsMutex);
+            for (const EventCategoryPriority& p : i->eventPriorities)
+            {
+                if (strcmp(p.category, category) == 0)
                 {
-                    return false;
+                    return p.priority < KeepEventPriority;
                 }
             }
-
             return true;
         }
 
+        bool GAStore::measureEvents(long long& count, long long& bytes)
+        {
+            return queryRowsSync("SELECT COUNT(*), COALESCE(SUM(LENGTH(CAST(event AS BLOB))), 0) FROM ga_events;", [&count, &bytes](const GAStoreRow& row)
+            {
+                count = row.getInt64(0);
+                bytes = row.getInt64(1);
+                return false;
+            });
+        }
+
+        void GAStore::addEventsToQuota(int eventCount, long long eventBytes)
+        {
+            GAStore* i = GAStore::getInstance();
+            if(!i)
+            {
+                return;
+            }
+            i->eventCountBound += eventCount;
+            i->eventBytesBound += eventBytes;
+            enforceEventQuota();
+        }
+
+        void GAStore::eventsRemovedFromStore()
+        {
+            GAStore* i = GAStore::getInstance();
+            if(!i)
+            {
+                return;
+            }
+            i->measureOnNextCheck = true;
+        }
+
+        void GAStore::enforceEventQuota()
+        {
+            GAStore* i = GAStore::getInstance();
+            if(!i || !i->dbReady)
+            {
+                return;
+            }
+
+            long long maxBytes = 0;
+            long long maxCount = 0;
+            std::vector<EventCategoryPriority> priorities;
+            {
+                std::lock_guard<std::mutex> lock(i->settingsMutex);
+                maxBytes = i->eventQuotaBytes;
+                maxCount = i->eventQuotaCount;
+                priorities = i->eventPriorities;
+            }
+
+            auto isOverQuota = [maxBytes, maxCount](long long count, long long bytes)
+            {
+                return (maxBytes > 0 && bytes > maxBytes) || (maxCount > 0 && count > maxCount);
+            };
+
+            // the bounds are never below the real values, under the quota nothing has to be read
+            if (!isOverQuota(i->eventCountBound, i->eventBytesBound))
+            {
+                i->quotaExceeded = false;
+                return;
+            }
+
+            // only events that can't be evicted were added since the last check found nothing to evict,
+            // measuring again would find the same
+            bool measure = i->measureOnNextCheck.exchange(false);
+            if (i->quotaExceeded && !measure)
+            {
+                bool grown = (maxBytes > 0 && i->eventBytesBound > i->unevictableBytes + maxBytes / 10)
+                    || (maxCount > 0 && i->eventCountBound > i->unevictableCount + maxCount / 10);
+                if (!grown)
+                {
+                    return;
+                }
+            }
+
+            long long count = 0;
+            long long bytes = 0;
+            if (!measureEvents(count, bytes))
+            {
+                i->measureOnNextCheck = true;
+                return;
+            }
+
+            // evict down to 90% so the next measurement is some events away
+            long long targetBytes = maxBytes - maxBytes / 10;
+            long long targetCount = maxCount - maxCount / 10;
+            auto isOverTarget = [maxBytes, maxCount, targetBytes, targetCount](long long count, long long bytes)
+            {
+                return (maxBytes > 0 && bytes > targetBytes) || (maxCount > 0 && count > targetCount);
+            };
+
+            int evicted = 0;
+            if (isOverQuota(count, bytes))
+            {
+                std::stable_sort(priorities.begin(), priorities.end(), [](const EventCategoryPriority& a, const EventCategoryPriority& b)
+                {
+                    return a.priority < b.priority;
+                });
+
+                // oldest first within a category, events being sent are left alone
+                char batchSize[11] = "";
+                snprintf(batchSize, sizeof(batchSize), "%d", EvictionBatchSize);
+                const char* selectSql = "SELECT COUNT(*), COALESCE(SUM(LENGTH(CAST(event AS BLOB))), 0) FROM (SELECT event FROM ga_events WHERE status = 0 AND category = ? ORDER BY id LIMIT ?);";
+                const char* deleteSql = "DELETE FROM ga_events WHERE id IN (SELECT id FROM ga_events WHERE status = 0 AND category = ? ORDER BY id LIMIT ?);";
+
+                for (const EventCategoryPriority& p : priorities)
+                {
+                    if (p.priority >= KeepEventPriority || !isOverTarget(count, bytes))
+                    {
+                        break;
+                    }
+
+                    while (isOverTarget(count, bytes))
+                    {
+                        // sizes the batch and deletes it in one transaction
+                        const char* parameters[2] = { p.category, batchSize };
+                        long long batchCount = 0;
+                        long long batchBytes = 0;
+                        bool success = executeInTransactionSync([&]()
+                        {
+                            return queryRowsSync(selectSql, parameters, 2, [&batchCount, &batchBytes](const GAStoreRow& row)
+                            {
+                                batchCount = row.getInt64(0);
+                                batchBytes = row.getInt64(1);
+                                return false;
+                            }) && (batchCount == 0 || queryRowsSync(deleteSql, parameters, 2, [](const GAStoreRow&) { return true; }));
+                        });
+                        if (!success || batchCount == 0)
+                        {
+                            break;
+                        }
+                        count -= batchCount;
+                        bytes -= batchBytes;
+                        evicted += static_cast<int>(batchCount);
+                    }
+                }
+            }
+
+            i->eventCountBound = count;
+            i->eventBytesBound = bytes;
+            i->quotaExceeded = isOverQuota(count, bytes);
+
+            if (evicted > 0)
+            {
+                logging::GALogger::w("Event store over quota, evicted %d events", evicted);
+                // only releases the free pages, unlike VACUUM it doesn't rebuild the database
+                i->executeSetting("PRAGMA incremental_vacuum;");
+                i->refreshDbSize();
+            }
+            if (i->quotaExceeded)
+            {
+                i->unevictableCount = count;
+                i->unevictableBytes = bytes;
+                logging::GALogger::w("Event store over quota, no events left that can be evicted");
+            }
+        }
     }
 }
@@ -10,16 +10,51 @@
 #include "rapidjson/document.h"
 #include "GameAnalytics.h"
 #include <mutex>
+#include <atomic>
 #include <cstdlib>
+#include <cstdint>
+#include <functional>
 
 namespace gameanalytics
 {
     namespace store
     {
+        /*!
+        typed view of the current row of a query, reading straight from sqlite.
+        strings point into sqlite's own buffer and are only valid until the visitor returns.
+        */
+        class GAStoreRow
+        {
+         public:
+            explicit GAStoreRow(sqlite3_stmt* statement) :statement(statement) {}
+
+            int getColumnCount() const { return sqlite3_column_count(statement); }
+            const char* getColumnName(int column) const { return sqlite3_column_name(statement, column); }
+            // SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT, SQLITE_BLOB or SQLITE_NULL
+            int getColumnType(int column) const { return sqlite3_column_type(statement, column); }
+            bool isNull(int column) const { return getColumnType(column) == SQLITE_NULL; }
+            int64_t getInt64(int column) const { return sqlite3_column_int64(statement, column); }
+            double getDouble(int column) const { return sqlite3_column_double(statement, column); }
+            // never null, NULL columns read as an empty string
+            const char* getString(int column) const
+            {
+                const char* s = reinterpret_cast<const char*>(sqlite3_column_text(statement, column));
+                return s ? s : "";
+            }
+            // length in bytes of the string returned by getString (call it after getString)
+            size_t getStringLength(int column) const { return static_cast<size_t>(sqlite3_column_bytes(statement, column)); }
+
+         private:
+            sqlite3_stmt* statement;
+        };
+
         class GAStore
         {
          public:
 
+            // called for every result row, return false to stop reading rows
+            typedef std::function<bool(const GAStoreRow& row)> RowVisitor;
+
             sqlite3* getDatabase();
             static bool isDestroyed();
 
@@ -36,11 +71,49 @@ namespace gameanalytics
             static void executeQuerySync(const char* sql, const char* parameters[], size_t size, bool useTransaction);
             static void executeQuerySync(const char* sql, const char* parameters[], size_t size, bool useTransaction, rapidjson::Document& out);
 
+            // streams the result rows to visitor without building a document, returns false on errors
+            static bool queryRowsSync(const char* sql, const RowVisitor& visitor);
+            static bool queryRowsSync(const char* sql, const char* parameters[], size_t size, const RowVisitor& visitor);
+            static bool queryRowsSync(const char* sql, const char* parameters[], size_t size, bool useTransaction, const RowVisitor& visitor);
+
+            // runs sql once for each row of parameters (rowCount rows of size parameters each) inside a single transaction
+            static bool executeBatchQuerySync(const char* sql, const char* parameters[], size_t size, size_t rowCount);
+
+            // runs body in one transaction, queries made by body join it instead of opening their own.
+            // committed when body returns true, rolled back otherwise
+            static bool executeInTransactionSync(const std::function<bool()>& body);
+
+            // size of the database as of the last committed write, kept in memory
             static long long getDbSizeBytes();
 
+            // connection settings, applied when the database is opened (or right away when it already is).
+            // 0 (-1 for mmap size) keeps the sqlite default
+            static void setJournalMode(EGADatabaseJournalMode mode);
+            static void setSynchronous(EGADatabaseSynchronous level);
+            // only takes effect for a database that has no tables yet (or after a VACUUM)
+            static void setPageSize(int bytes);
+            static void setCacheSize(int kibibytes);
+            static void setMmapSize(long long bytes);
+
             static bool getTableReady();
+            // true while the store is over its quota and only holds events that can't be evicted
             static bool isDbTooLargeForEvents();
 
+            // limits for the stored events (bytes of event json), 0 disables a limit
+            static void setEventQuota(long long maxBytes, int maxEventCount);
+            // when over quota the oldest events of the lowest priority category are evicted first,
+            // categories with KeepEventPriority are never evicted. returns false for unknown categories
+            static bool setEventEvictionPriority(const char* category, int priority);
+            static bool isEventCategoryEvictable(const char* category);
+            // called after events are written, evicts events when the store went over its quota
+            static void addEventsToQuota(int eventCount, long long eventBytes);
+            // evicts events until the store is within its quota again
+            static void enforceEventQuota();
+            // called after sent events are deleted, the next quota check measures the store again
+            static void eventsRemovedFromStore();
+
+            static const int KeepEventPriority;
+
         private:
             GAStore();
             GAStore(const GAStore&) = delete;
@@ -61,7 +134,36 @@ namespace gameanalytics
                 }
             }
 
-            static bool trimEventTable();
+            // switches the database to auto_vacuum=INCREMENTAL so evicted events give their pages back
+            void ensureIncrementalVacuum();
+            // counts the stored events and their bytes
+            static bool measureEvents(long long& count, long long& bytes);
+            // moves rows of a ga_events table created by an older version into one created with createSql
+            bool migrateEventTable(const char* createSql);
+            // runs the PRAGMAs for the configured connection settings
+            void applyDatabaseSettings();
+            bool executeSetting(const char* sql);
+            // runs sql and copies the first column of its first row to out
+            bool querySetting(const char* sql, char* out, size_t size);
+            // reads the database size from sqlite into dbSizeBytes
+            void refreshDbSize();
+
+            // prepared statements kept between calls, reset and unbound when handed back
+            struct CachedStatement
+            {
+                sqlite3_stmt* statement;
+                bool isWrite;
+                bool inUse;
+            };
+
+            static bool isWriteStatement(const char* sql);
+            // prepares sql or reuses an idle cached statement for it, cache decides if a newly prepared one is kept
+            bool acquireStatement(const char* sql, bool cache, sqlite3_stmt*& statement, bool& isWrite);
+            // returns the result of the last step
+            int releaseStatement(sqlite3_stmt* statement);
+            // runs a statement without parameters or results (BEGIN, COMMIT, ...)
+            bool executeStatement(const char* sql);
+            void finalizeCachedStatements();
 
             // set when calling "ensureDatabase"
             // using a "writablePath" that needs to be set into the C++ component before
@@ -78,8 +180,47 @@ namespace gameanalytics
             // bool to determine if tables are ensured ready
             bool tableReady = false;
 
-            static const int MaxDbSizeBytes;
-            static const int MaxDbSizeBytesBeforeTrim;
+            static const long long DefaultEventQuotaBytes;
+            static const int EvictionBatchSize;
+            static const size_t MaxCachedStatements;
+
+            // guarded by settingsMutex, read on the GA thread when the database is opened
+            int journalMode = 0;
+            int synchronous = 0;
+            int pageSize = 0;
+            int cacheSizeKibibytes = 0;
+            long long mmapSizeBytes = -1;
+            std::mutex settingsMutex;
+
+            // updated by refreshDbSize, read for every stored event
+            std::atomic<long long> dbSizeBytes{0};
+
+            struct EventCategoryPriority
+            {
+                const char* category;
+                int priority;
+            };
+
+            // guarded by settingsMutex
+            long long eventQuotaBytes;
+            int eventQuotaCount = 0;
+            std::vector<EventCategoryPriority> eventPriorities;
+            // set by enforceEventQuota when eviction could not get under the quota
+            std::atomic<bool> quotaExceeded{false};
+            // upper bounds for the stored events, only grown by inserts and set to the real
+            // values when measured. deletes are not tracked, so measuring is only needed
+            // once these go over the quota
+            long long eventCountBound = 0;
+            long long eventBytesBound = 0;
+            // measured when nothing could be evicted, the bounds have to grow past these by
+            // a tenth of the quota before measuring again, unless events were removed
+            long long unevictableCount = 0;
+            long long unevictableBytes = 0;
+            std::atomic<bool> measureOnNextCheck{true};
+
+            // most recently used statements are at the back
+            std::vector<CachedStatement> cachedStatements;
+            std::mutex statementCacheMutex;
         };
     }
 }
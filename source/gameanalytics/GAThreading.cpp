@@ -18,7 +18,14 @@ namespace gameanalytics
         // static members
         std::atomic<bool> GAThreading::_endThread(false);
         std::atomic_llong GAThreading::_threadDeadline(GAThreading::getTimeInNs());
+        std::atomic<std::thread::id> GAThreading::_gaThreadId;
         std::unique_ptr<GAThreading::State> GAThreading::state(new GAThreading::State());
+        std::atomic_ullong GAThreading::_dispatchLatencyCounts[GAThreading::DispatchLatencyBucketCount] = {};
+        std::atomic_llong GAThreading::_dispatchLatencyMaxInUs(0);
+        GABoundedQueue<GAThreading::TaskPayload*, 256> GAThreading::TaskPayload::pool;
+        std::atomic<int> GAThreading::_taskQueueFullPolicy(DropOldest);
+        std::atomic_ullong GAThreading::_droppedTaskCount(0);
+        const long long GAThreading::DispatchLatencyHistogram::BucketUpperBoundsInUs[GAThreading::DispatchLatencyBucketCount - 1] = { 10, 100, 1000, 10000, 100000, 1000000 };
 
         void GAThreading::scheduleTimer(double interval, const Block& callback)
         {
@@ -33,10 +40,8 @@ namespace gameanalytics
                 state->scheduledBlock = { callback, std::chrono::steady_clock::now() + std::chrono::milliseconds(static_cast<int>(1000 * interval)) };
                 state->hasScheduledBlockRun = false;
                 GAThreading::_threadDeadline = GAThreading::getTimeInNs(interval + 2.0);
-                if(state->isThreadFinished())
-                {
-                    state->setThread(GAThreading::thread_routine, GAThreading::_endThread, GAThreading::_threadDeadline);
-                }
+                ensureThreadIsRunning();
+                state->condition.notify_all();
             }
         }
 
@@ -46,19 +51,173 @@ namespace gameanalytics
             {
                 return;
             }
-            std::lock_guard<std::mutex> lock(state->mutex);
-            state->blocks.push_back({ taskBlock, std::chrono::steady_clock::now()} );
-            std::push_heap(state->blocks.begin(), state->blocks.end());
+
+            TimedBlock timedBlock(taskBlock, std::chrono::steady_clock::now());
+            pushTask(timedBlock);
+        }
+
+        void GAThreading::performEventTaskOnGAThread(TaskFunction function, TaskPayload* payload)
+        {
+            if(_endThread)
+            {
+                TaskPayload::release(payload);
+                return;
+            }
+
+            TimedBlock timedBlock(function, payload, std::chrono::steady_clock::now());
+            pushTask(timedBlock);
+        }
+
+        void GAThreading::performEventTaskOnGAThread(const Block& taskBlock)
+        {
+            if(_endThread)
+            {
+                return;
+            }
+
+            TimedBlock timedBlock(taskBlock, std::chrono::steady_clock::now(), true);
+            pushTask(timedBlock);
+        }
+
+        void GAThreading::pushTask(TimedBlock& timedBlock)
+        {
+            if(!state->tasks.tryPush(timedBlock))
+            {
+                int policy = _taskQueueFullPolicy.load();
+                if(isGAThread())
+                {
+                    // only the GA thread makes room, so it can't wait for itself
+                    if(timedBlock.droppable)
+                    {
+                        dropTask(timedBlock, "Task queue is full, dropping event task queued from the GA thread");
+                        return;
+                    }
+                    std::lock_guard<std::mutex> lock(state->popMutex);
+                    state->overflowTasks.push_back(std::move(timedBlock));
+                    ++state->overflowCount;
+                }
+                else if(timedBlock.droppable && policy == DropNewest)
+                {
+                    dropTask(timedBlock, "Task queue is full, dropping newest event task");
+                    return;
+                }
+                else if(policy == DropOldest)
+                {
+                    pushTaskDroppingOldest(timedBlock);
+                }
+                else if(!pushTaskWaitingForSpace(timedBlock))
+                {
+                    return;
+                }
+            }
+
             GAThreading::_threadDeadline = GAThreading::getTimeInNs(10.0);
-            if(state->isThreadFinished())
+            if(!state->isRunning)
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                ensureThreadIsRunning();
+            }
+            notifyThread();
+        }
+
+        void GAThreading::pushTaskDroppingOldest(TimedBlock& timedBlock)
+        {
+            std::lock_guard<std::mutex> lock(state->popMutex);
+            TimedBlock oldestBlock;
+            while(!state->tasks.tryPush(timedBlock))
+            {
+                if(!state->tasks.tryPop(oldestBlock))
+                {
+                    continue;
+                }
+
+                if(oldestBlock.droppable)
+                {
+                    dropTask(oldestBlock, "Task queue is full, dropping oldest event task");
+                }
+                else
+                {
+                    state->overflowTasks.push_back(std::move(oldestBlock));
+                    ++state->overflowCount;
+                    oldestBlock = TimedBlock();
+                }
+            }
+        }
+
+        bool GAThreading::pushTaskWaitingForSpace(TimedBlock& timedBlock)
+        {
+            ++state->spaceWaiters;
+            // pairs with the fence in notifySpace, either the GA thread sees the waiter or we see the free cell
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            bool pushed = true;
+            {
+                std::unique_lock<std::mutex> lock(state->spaceMutex);
+                while(!state->tasks.tryPush(timedBlock))
+                {
+                    if(_endThread)
+                    {
+                        timedBlock.clear();
+                        pushed = false;
+                        break;
+                    }
+                    if(!state->isRunning)
+                    {
+                        std::lock_guard<std::mutex> threadLock(state->mutex);
+                        ensureThreadIsRunning();
+                    }
+                    notifyThread();
+                    state->spaceCondition.wait(lock);
+                }
+            }
+
+            --state->spaceWaiters;
+            return pushed;
+        }
+
+        void GAThreading::dropTask(TimedBlock& timedBlock, const char* reason)
+        {
+            ++_droppedTaskCount;
+            logging::GALogger::w("%s", reason);
+            timedBlock.clear();
+        }
+
+        void GAThreading::notifySpace()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(state->spaceWaiters > 0)
+            {
+                std::lock_guard<std::mutex> lock(state->spaceMutex);
+                state->spaceCondition.notify_all();
+            }
+        }
+
+        void GAThreading::ensureThreadIsRunning()
+        {
+            if(!state->isRunning)
             {
                 state->setThread(GAThreading::thread_routine, GAThreading::_endThread, GAThreading::_threadDeadline);
+                state->isRunning = true;
+            }
+        }
+
+        void GAThreading::notifyThread()
+        {
+            // the GA thread sets isWaiting before checking the queue a last time, so either it sees the new task or we see the flag
+            if(state->isWaiting)
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->condition.notify_all();
             }
         }
 
         void GAThreading::endThread()
         {
             _endThread = true;
+            if(state)
+            {
+                state->wakeUp();
+            }
         }
 
         bool GAThreading::isThreadFinished()
@@ -71,19 +230,89 @@ namespace gameanalytics
             return _endThread;
         }
 
-        bool GAThreading::getNextBlock(TimedBlock& timedBlock)
+        bool GAThreading::isGAThread()
         {
-            std::lock_guard<std::mutex> lock(state->mutex);
+            return _gaThreadId.load() == std::this_thread::get_id();
+        }
+
+        void GAThreading::clearGAThreadId()
+        {
+            // a new GA thread may already have started and set its own id
+            std::thread::id id = std::this_thread::get_id();
+            _gaThreadId.compare_exchange_strong(id, std::thread::id());
+        }
 
-            if((!state->blocks.empty() && state->blocks.front().deadline <= std::chrono::steady_clock::now()))
+        void GAThreading::setTaskQueueFullPolicy(EGATaskQueueFullPolicy policy)
+        {
+            _taskQueueFullPolicy = policy;
+        }
+
+        unsigned long long GAThreading::getDroppedTaskCount()
+        {
+            return _droppedTaskCount;
+        }
+
+        void GAThreading::getDispatchLatencyHistogram(DispatchLatencyHistogram& out)
+        {
+            out.total = 0;
+            for(int i = 0; i < DispatchLatencyBucketCount; ++i)
             {
-                timedBlock = state->blocks.front();
-                std::pop_heap(state->blocks.begin(), state->blocks.end());
-                state->blocks.pop_back();
-                return true;
+                out.counts[i] = _dispatchLatencyCounts[i];
+                out.total += out.counts[i];
             }
+            out.maxInUs = _dispatchLatencyMaxInUs;
+        }
 
-            return false;
+        void GAThreading::resetDispatchLatencyHistogram()
+        {
+            for(int i = 0; i < DispatchLatencyBucketCount; ++i)
+            {
+                _dispatchLatencyCounts[i] = 0;
+            }
+            _dispatchLatencyMaxInUs = 0;
+        }
+
+        void GAThreading::recordDispatchLatency(const TimedBlock::time_point& deadline)
+        {
+            long long latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - deadline).count();
+            if(latency < 0)
+            {
+                latency = 0;
+            }
+
+            int bucket = 0;
+            while(bucket < DispatchLatencyBucketCount - 1 && latency >= DispatchLatencyHistogram::BucketUpperBoundsInUs[bucket])
+            {
+                ++bucket;
+            }
+            ++_dispatchLatencyCounts[bucket];
+
+            long long currentMax = _dispatchLatencyMaxInUs;
+            while(latency > currentMax && !_dispatchLatencyMaxInUs.compare_exchange_weak(currentMax, latency))
+            {
+            }
+        }
+
+        bool GAThreading::getNextBlock(TimedBlock& timedBlock)
+        {
+            bool found = false;
+            {
+                std::lock_guard<std::mutex> lock(state->popMutex);
+                if(state->overflowCount > 0)
+                {
+                    timedBlock = std::move(state->overflowTasks.front());
+                    state->overflowTasks.pop_front();
+                    --state->overflowCount;
+                    return true;
+                }
+                found = state->tasks.tryPop(timedBlock);
+            }
+
+            if(found)
+            {
+                notifySpace();
+            }
+            return found;
         }
 
         bool GAThreading::getScheduledBlock(TimedBlock& timedBlock)
@@ -121,46 +350,108 @@ namespace gameanalytics
 
             while (getNextBlock(timedBlock))
             {
-                assert(timedBlock.block);
+                assert(timedBlock.block || timedBlock.function);
                 assert(timedBlock.deadline <= std::chrono::steady_clock::now());
-                timedBlock.block();
+                recordDispatchLatency(timedBlock.deadline);
+                try
+                {
+                    timedBlock.run();
+                }
+                catch(...)
+                {
+                    timedBlock.clear();
+                    throw;
+                }
                 // clear the block, so that the assert works
-                timedBlock.block = {};
+                timedBlock.clear();
             }
 
             if(getScheduledBlock(timedBlock))
             {
                 assert(timedBlock.block);
                 assert(timedBlock.deadline <= std::chrono::steady_clock::now());
+                recordDispatchLatency(timedBlock.deadline);
                 timedBlock.block();
                 // clear the block, so that the assert works
                 timedBlock.block = {};
             }
         }
 
+        void GAThreading::waitForNextBlock(std::atomic<bool>& endThread, std::atomic_llong& threadDeadline)
+        {
+            if(!state)
+            {
+                return;
+            }
+
+            std::unique_lock<std::mutex> lock(state->mutex);
+
+            if(endThread)
+            {
+                return;
+            }
+
+            state->isWaiting = true;
+            if(state->hasTasks())
+            {
+                state->isWaiting = false;
+                return;
+            }
+
+            // sleep until the earliest of: scheduled timer, thread deadline
+            TimedBlock::time_point wakeUpTime(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(threadDeadline.load())));
+            if(!state->hasScheduledBlockRun && state->scheduledBlock.deadline < wakeUpTime)
+            {
+                wakeUpTime = state->scheduledBlock.deadline;
+            }
+
+            // pushing a task or timer notifies the condition, the deadlines are then recalculated by the caller
+            state->condition.wait_until(lock, wakeUpTime);
+            state->isWaiting = false;
+        }
+
         void GAThreading::thread_routine(std::atomic<bool>& endThread, std::atomic_llong& threadDeadline)
         {
             logging::GALogger::d("thread_routine start");
+            _gaThreadId = std::this_thread::get_id();
 
             try
             {
-                while (!endThread && threadDeadline >= GAThreading::getTimeInNs())
+                for(;;)
                 {
+                    while (!endThread && threadDeadline >= GAThreading::getTimeInNs())
+                    {
+                        if(!state)
+                        {
+                            break;
+                        }
+                        runBlocks();
+                        waitForNextBlock(endThread, threadDeadline);
+                    }
+
+                    // run any last blocks added
+                    runBlocks();
+
                     if(!state)
                     {
                         break;
                     }
-                    runBlocks();
-                    std::this_thread::sleep_for(std::chrono::seconds(1));
-                }
 
-                // run any last blocks added
-                runBlocks();
+                    // producers only start a new thread when isRunning is cleared, so recheck the queue after clearing it
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->isRunning = false;
+                    if(endThread || !state->hasTasks())
+                    {
+                        break;
+                    }
+                    state->isRunning = true;
+                }
 
                 if(!endThread)
                 {
                     logging::GALogger::d("thread_routine stopped");
                 }
+                clearGAThreadId();
             }
             catch(const std::exception& e)
             {
@@ -169,6 +460,13 @@ namespace gameanalytics
                     logging::GALogger::e("Error on GA thread");
                     logging::GALogger::e(e.what());
                 }
+
+                clearGAThreadId();
+                if(state)
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->isRunning = false;
+                }
             }
         }
     }
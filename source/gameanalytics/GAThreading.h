@@ -8,28 +8,242 @@
 
 #include <functional>
 #include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "GameAnalytics.h"
 #if USE_TIZEN
 #include <Ecore.h>
 #else
-#include <vector>
 #include <chrono>
 #include <memory>
 #include <future>
 #include <mutex>
-#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <thread>
 #endif
 
 namespace gameanalytics
 {
     namespace threading
     {
+        /*!
+        bounded multi-producer/multi-consumer ring buffer.
+        nobody takes a lock, every cell carries a sequence number telling
+        whether it is free for a producer or filled for a consumer at a given position.
+        */
+        template <typename T, size_t Capacity>
+        class GABoundedQueue
+        {
+            static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+         public:
+            GABoundedQueue() :enqueuePos(0), dequeuePos(0)
+            {
+                for(size_t i = 0; i < Capacity; ++i)
+                {
+                    cells[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            // item is moved into the queue on success and left untouched when the queue is full
+            bool tryPush(T& item)
+            {
+                Cell* cell;
+                size_t pos = enqueuePos.load(std::memory_order_relaxed);
+                for(;;)
+                {
+                    cell = &cells[pos & Mask];
+                    size_t seq = cell->sequence.load(std::memory_order_acquire);
+                    std::ptrdiff_t dif = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+                    if(dif == 0)
+                    {
+                        if(enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        {
+                            break;
+                        }
+                    }
+                    else if(dif < 0)
+                    {
+                        // full
+                        return false;
+                    }
+                    else
+                    {
+                        pos = enqueuePos.load(std::memory_order_relaxed);
+                    }
+                }
+
+                cell->item = std::move(item);
+                cell->sequence.store(pos + 1);
+                return true;
+            }
+
+            bool tryPop(T& item)
+            {
+                Cell* cell;
+                size_t pos = dequeuePos.load(std::memory_order_relaxed);
+                for(;;)
+                {
+                    cell = &cells[pos & Mask];
+                    size_t seq = cell->sequence.load(std::memory_order_acquire);
+                    std::ptrdiff_t dif = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+                    if(dif == 0)
+                    {
+                        if(dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        {
+                            break;
+                        }
+                    }
+                    else if(dif < 0)
+                    {
+                        // empty
+                        return false;
+                    }
+                    else
+                    {
+                        pos = dequeuePos.load(std::memory_order_relaxed);
+                    }
+                }
+
+                item = std::move(cell->item);
+                cell->item = T();
+                cell->sequence.store(pos + Mask + 1, std::memory_order_release);
+                return true;
+            }
+
+            bool isEmpty() const
+            {
+                size_t pos = dequeuePos.load();
+                size_t seq = cells[pos & Mask].sequence.load();
+                return static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1) < 0;
+            }
+
+         private:
+            static const size_t Mask = Capacity - 1;
+
+            struct Cell
+            {
+                Cell() :item() {}
+
+                std::atomic<size_t> sequence;
+                T item;
+            };
+
+            Cell cells[Capacity];
+            std::atomic<size_t> enqueuePos;
+            std::atomic<size_t> dequeuePos;
+        };
+
         class GAThreading
         {
          public:
 
             typedef std::function<void()> Block;
 
+            /*!
+            arguments of a task, written by the calling thread and read back in the same order on the GA thread.
+            strings are stored with their actual length, and payloads are recycled through a shared pool,
+            so queueing a task does not allocate once the pool is warm.
+            */
+            class TaskPayload
+            {
+             public:
+                static TaskPayload* acquire()
+                {
+                    TaskPayload* payload = nullptr;
+                    if(!pool.tryPop(payload))
+                    {
+                        payload = new TaskPayload();
+                    }
+                    return payload;
+                }
+
+                static void release(TaskPayload* payload)
+                {
+                    if(!payload)
+                    {
+                        return;
+                    }
+
+                    payload->data.clear();
+                    payload->readPosition = 0;
+                    // don't hold on to buffers grown by unusually large payloads
+                    if(payload->data.capacity() > MaxPooledCapacity || !pool.tryPush(payload))
+                    {
+                        delete payload;
+                    }
+                }
+
+                // stores at most maxLength characters of s (null is stored as an empty string)
+                void writeString(const char* s, size_t maxLength)
+                {
+                    size_t length = 0;
+                    if(s)
+                    {
+                        while(length < maxLength && s[length] != '\0')
+                        {
+                            ++length;
+                        }
+                        data.insert(data.end(), s, s + length);
+                    }
+                    data.push_back('\0');
+                }
+
+                template <typename T>
+                void write(const T& value)
+                {
+                    const char* bytes = reinterpret_cast<const char*>(&value);
+                    data.insert(data.end(), bytes, bytes + sizeof(T));
+                }
+
+                void writeBytes(const char* bytes, size_t size)
+                {
+                    data.insert(data.end(), bytes, bytes + size);
+                }
+
+                const char* readString()
+                {
+                    const char* s = data.data() + readPosition;
+                    readPosition += strlen(s) + 1;
+                    return s;
+                }
+
+                const char* readBytes(size_t size)
+                {
+                    const char* bytes = data.data() + readPosition;
+                    readPosition += size;
+                    return bytes;
+                }
+
+                template <typename T>
+                T read()
+                {
+                    T value;
+                    memcpy(&value, data.data() + readPosition, sizeof(T));
+                    readPosition += sizeof(T);
+                    return value;
+                }
+
+             private:
+                TaskPayload() :readPosition(0) {}
+
+                static const size_t MaxPooledCapacity = 16384;
+                static GABoundedQueue<TaskPayload*, 256> pool;
+
+                std::vector<char> data;
+                size_t readPosition;
+            };
+
+            typedef void (*TaskFunction)(TaskPayload& payload);
+
+            // never dropped, waits for room when the task queue is full
             static void performTaskOnGAThread(const Block& taskBlock);
+            // add*Event tasks, the only ones the task queue full policy drops.
+            // runs function with the payload on the GA thread, ownership of the payload is taken over in any case
+            static void performEventTaskOnGAThread(TaskFunction function, TaskPayload* payload);
+            static void performEventTaskOnGAThread(const Block& taskBlock);
 
             // timers
             static void scheduleTimer(double interval, const Block& callback);
@@ -40,6 +254,29 @@ namespace gameanalytics
 
             static bool isThreadEnding();
 
+            // true when called from a task or timer running on the GA thread
+            static bool isGAThread();
+
+            // dispatch latency (time from a block being due until it starts running on the GA thread)
+            static const int DispatchLatencyBucketCount = 7;
+
+            struct DispatchLatencyHistogram
+            {
+                // exclusive upper bound of each bucket in microseconds, the last bucket holds everything above
+                static const long long BucketUpperBoundsInUs[DispatchLatencyBucketCount - 1];
+
+                unsigned long long counts[DispatchLatencyBucketCount];
+                unsigned long long total;
+                long long maxInUs;
+            };
+
+            static void getDispatchLatencyHistogram(DispatchLatencyHistogram& out);
+            static void resetDispatchLatencyHistogram();
+
+            // what performTaskOnGAThread does when the task queue is full
+            static void setTaskQueueFullPolicy(EGATaskQueueFullPolicy policy);
+            static unsigned long long getDroppedTaskCount();
+
          private:
 
 #if USE_TIZEN
@@ -64,30 +301,60 @@ namespace gameanalytics
             {
                 typedef std::chrono::steady_clock::time_point time_point;
 
-                TimedBlock() {}
+                TimedBlock() :function(nullptr), payload(nullptr), droppable(false) {}
 
-                TimedBlock(const Block& block, const time_point& deadline) :block(block), deadline(deadline) {}
+                TimedBlock(const Block& block, const time_point& deadline, bool droppable = false) :block(block), function(nullptr), payload(nullptr), deadline(deadline), droppable(droppable) {}
 
-                Block block;
-                time_point deadline;
+                TimedBlock(TaskFunction function, TaskPayload* payload, const time_point& deadline) :function(function), payload(payload), deadline(deadline), droppable(true) {}
+
+                void run()
+                {
+                    if(function)
+                    {
+                        function(*payload);
+                    }
+                    else
+                    {
+                        block();
+                    }
+                }
 
-                bool operator < (const TimedBlock& o) const
+                // release the payload of a task that has run or is dropped
+                void clear()
                 {
-                    // the priority_queue orders the items descending. but we want to retrieve the items in ascending order.
-                    return deadline > o.deadline;
+                    block = {};
+                    function = nullptr;
+                    TaskPayload::release(payload);
+                    payload = nullptr;
                 }
+
+                Block block;
+                TaskFunction function;
+                TaskPayload* payload;
+                time_point deadline;
+                // event tasks can be dropped when the queue is full
+                bool droppable;
             };
 
-            typedef std::vector<TimedBlock> TimedBlocks;
+            typedef GABoundedQueue<TimedBlock, 2048> TaskQueue;
+
             typedef void (*start_routine) (std::atomic<bool>&, std::atomic_llong&);
 
             struct State
             {
                 State()
                 {
-                    std::make_heap(blocks.begin(), blocks.end());
                     scheduledBlock = { {}, std::chrono::steady_clock::now() };
                     hasScheduledBlockRun = true;
+                    isRunning = false;
+                    isWaiting = false;
+                    overflowCount = 0;
+                    spaceWaiters = 0;
+                }
+
+                bool hasTasks() const
+                {
+                    return overflowCount > 0 || !tasks.isEmpty();
                 }
 
                 void setThread(start_routine routine, std::atomic<bool>& endThread, std::atomic_llong& threadDeadline)
@@ -100,9 +367,20 @@ namespace gameanalytics
                     return !handle.valid() || handle.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
                 }
 
+                void wakeUp()
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        condition.notify_all();
+                    }
+                    std::lock_guard<std::mutex> lock(spaceMutex);
+                    spaceCondition.notify_all();
+                }
+
                 ~State()
                 {
-                    endThread();
+                    _endThread = true;
+                    wakeUp();
 
                     while (!isThreadFinished())
                     {
@@ -110,30 +388,63 @@ namespace gameanalytics
                     }
                 }
 
-                TimedBlocks blocks;
+                TaskQueue tasks;
                 TimedBlock scheduledBlock;
                 bool hasScheduledBlockRun;
+                // set while the GA thread is alive, cleared (under mutex) right before it exits
+                std::atomic<bool> isRunning;
+                // set (under mutex) while the GA thread is about to wait on the condition
+                std::atomic<bool> isWaiting;
                 std::mutex mutex;
+                std::condition_variable condition;
                 std::future<void> handle;
+                // tasks that can't be dropped but were taken out of the full queue to make room, and tasks
+                // the GA thread queued while the queue was full. older than the queue, so they run first
+                std::deque<TimedBlock> overflowTasks;
+                std::atomic<size_t> overflowCount;
+                // held by whoever takes tasks out of the queue (the GA thread and DropOldest), keeps them in order
+                std::mutex popMutex;
+                // producers blocked on a full queue, woken by the GA thread after it took a task
+                std::atomic<int> spaceWaiters;
+                std::mutex spaceMutex;
+                std::condition_variable spaceCondition;
             };
 
             static std::atomic<bool> _endThread;
             static std::atomic_llong _threadDeadline;
+            static std::atomic<std::thread::id> _gaThreadId;
             static std::unique_ptr<State> state;
+            static std::atomic_ullong _dispatchLatencyCounts[DispatchLatencyBucketCount];
+            static std::atomic_llong _dispatchLatencyMaxInUs;
+            static std::atomic<int> _taskQueueFullPolicy;
+            static std::atomic_ullong _droppedTaskCount;
 
             static long long getTimeInNs();
             static long long getTimeInNs(double delay);
 
+            static void clearGAThreadId();
             //< The function that's running in the gaThread
             static void thread_routine(std::atomic<bool>& endThread, std::atomic_llong& threadDeadline);
-            /*!
-            retrieves the next block to execute.
-            This will either be a regular Block or a Timed Block.
-            return true, if a Block is retrieved, false if a TimedBlock is retrieved.
-            */
+            //< queues the task according to the full-queue policy and wakes the GA thread
+            static void pushTask(TimedBlock& timedBlock);
+            //< makes room by dropping the oldest event tasks, other tasks are moved to the overflow
+            static void pushTaskDroppingOldest(TimedBlock& timedBlock);
+            //< blocks until the task fits into the queue, false if the thread is ending
+            static bool pushTaskWaitingForSpace(TimedBlock& timedBlock);
+            static void dropTask(TimedBlock& timedBlock, const char* reason);
+            //< wakes producers waiting for space
+            static void notifySpace();
+            //< starts the GA thread if it is not running, must be called with state->mutex held
+            static void ensureThreadIsRunning();
+            //< wakes the GA thread if it is waiting for work
+            static void notifyThread();
+            //< retrieves the next immediate task, return false if the queue is empty
             static bool getNextBlock(TimedBlock& timedBlock);
             static bool getScheduledBlock(TimedBlock& timedBlock);
             static void runBlocks();
+            //< blocks until a block is pushed, a timer is due, the thread deadline passes or the thread is ended
+            static void waitForNextBlock(std::atomic<bool>& endThread, std::atomic_llong& threadDeadline);
+            static void recordDispatchLatency(const TimedBlock::time_point& deadline);
 #endif
         };
     }
@@ -6,12 +6,15 @@
 
 #include "GAThreading.h"
 #include "GALogger.h"
+#include <cstring>
 
 namespace gameanalytics
 {
     namespace threading
     {
         std::atomic<bool> GAThreading::initialized(false);
+        GABoundedQueue<GAThreading::TaskPayload*, 256> GAThreading::TaskPayload::pool;
+        const long long GAThreading::DispatchLatencyHistogram::BucketUpperBoundsInUs[GAThreading::DispatchLatencyBucketCount - 1] = { 10, 100, 1000, 10000, 100000, 1000000 };
 
         void GAThreading::initIfNeeded()
         {
@@ -34,6 +37,20 @@ namespace gameanalytics
             ecore_thread_run(_perform_task_function, _end_function, NULL, new BlockHolder(taskBlock));
         }
 
+        void GAThreading::performEventTaskOnGAThread(TaskFunction function, TaskPayload* payload)
+        {
+            performTaskOnGAThread([function, payload]()
+            {
+                function(*payload);
+                TaskPayload::release(payload);
+            });
+        }
+
+        void GAThreading::performEventTaskOnGAThread(const Block& taskBlock)
+        {
+            performTaskOnGAThread(taskBlock);
+        }
+
         void GAThreading::endThread()
         {
         }
@@ -48,6 +65,27 @@ namespace gameanalytics
             return false;
         }
 
+        void GAThreading::getDispatchLatencyHistogram(DispatchLatencyHistogram& out)
+        {
+            // dispatching is handled by ecore, no latency is recorded
+            memset(&out, 0, sizeof(out));
+        }
+
+        void GAThreading::resetDispatchLatencyHistogram()
+        {
+        }
+
+        void GAThreading::setTaskQueueFullPolicy(EGATaskQueueFullPolicy policy)
+        {
+            // tasks are queued by ecore
+            (void)policy;
+        }
+
+        unsigned long long GAThreading::getDroppedTaskCount()
+        {
+            return 0;
+        }
+
         Eina_Bool GAThreading::_scheduled_function(void* data)
         {
             BlockHolder* blockHolder = static_cast<BlockHolder*>(data);
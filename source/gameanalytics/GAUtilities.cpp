@@ -24,6 +24,7 @@
 #include <guid.h>
 #endif
 #include <cctype>
+#include <algorithm>
 
 // From crypto
 #define MINIZ_HEADER_FILE_ONLY
@@ -39,102 +40,6 @@ namespace gameanalytics
         char GAUtilities::pathSeparator[2] = "/";
 #endif
 
-        // Compress a STL string using zlib with given compression level and return the binary data.
-        // Note: the zlib header is supressed
-        static std::vector<char> deflate_string(const char* str, int compressionlevel = Z_BEST_COMPRESSION)
-        {
-            // z_stream is zlib's control structure
-            z_stream zs;
-            memset(&zs, 0, sizeof(zs));
-
-            /* windowsize is negative to suppress Zlib header */
-            if (Z_OK != deflateInit2(&zs, compressionlevel, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 9, MZ_DEFAULT_STRATEGY))
-            {
-                throw(std::runtime_error("deflateInit failed while compressing."));
-            }
-
-            zs.next_in = (Bytef*)str;
-            //zs.next_in = reinterpret_cast<Bytef*>(str.data());
-
-            // set the z_stream's input
-            zs.avail_in = static_cast<unsigned int>(strlen(str));
-            int ret;
-            static char outbuffer[32768];
-            std::vector<char> outstring;
-
-            // retrieve the compressed bytes blockwise
-            do
-            {
-                zs.next_out = reinterpret_cast<Bytef*>(outbuffer);
-                zs.avail_out = sizeof(outbuffer);
-
-                ret = deflate(&zs, Z_FINISH);
-
-                if (outstring.size() < zs.total_out)
-                {
-                    size_t s = zs.total_out - outstring.size();
-                    // append the block to the output string
-                    for(size_t i = 0; i < s; ++i)
-                    {
-                        outstring.push_back(outbuffer[i]);
-                    }
-                }
-            } while (ret == Z_OK);
-
-            deflateEnd(&zs);
-
-            if (ret != Z_STREAM_END)
-            {
-                // an error occurred that was not EOF
-                logging::GALogger::e("Exception during zlib compression: (%d) %s", ret, zs.msg);
-                outstring.clear();
-            }
-
-            return outstring;
-        }
-
-        // TODO(nikolaj): explain template?
-        template <typename T>
-        T swap_endian(T u)
-        {
-            static_assert (CHAR_BIT == 8, "CHAR_BIT != 8");
-
-            union
-            {
-                T u;
-                unsigned char u8[sizeof(T)];
-            } source, dest;
-
-            source.u = u;
-
-            for (size_t k = 0; k < sizeof(T); k++)
-                dest.u8[k] = source.u8[sizeof(T) - k - 1];
-
-            return dest.u;
-        }
-
-        uint32 htonl2(uint32 v)
-        {
-            uint32 result = 0;
-            result |= (v & 0xFF000000) >> 24;
-            result |= (v & 0x00FF0000) >> 8;
-            result |= (v & 0x0000FF00) << 8;
-            result |= (v & 0x000000FF) << 24;
-
-            return result;
-        }
-
-        uint32 to_little_endian(uint32 v)
-        {
-            // convert to big endian
-            v = htonl2(v);
-
-            // and to little endian, because gzip wants it so.
-            v = swap_endian(v);
-
-            return v;
-        }
-
 #if !USE_UWP
         static char nb_base64_chars[] =
         "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
@@ -210,50 +115,137 @@ namespace gameanalytics
             *buf++ = '\0';
         }
 #endif
-        // gzip compresses a string
-        static std::vector<char> compress_string_gzip(const char* str, int compressionlevel = Z_BEST_COMPRESSION)
+        GAGzipCompressor::GAGzipCompressor() :stream(new z_stream()), initialized(false), level(0), out(nullptr), outSize(0), crc(0), inputSize(0), failed(false)
         {
-            // https://tools.ietf.org/html/rfc1952
-            std::vector<char> deflated = deflate_string(str, compressionlevel);
+        }
+
+        GAGzipCompressor::~GAGzipCompressor()
+        {
+            if (initialized)
+            {
+                deflateEnd(stream);
+            }
+            delete stream;
+        }
 
+        bool GAGzipCompressor::begin(std::vector<char>& output, int compressionLevel)
+        {
+            // https://tools.ietf.org/html/rfc1952
             static const char gzip_header[10] =
             { '\037', '\213', Z_DEFLATED, 0,
                 0, 0, 0, 0, /* mtime */
                 0, 0x03 /* Unix OS_CODE */
             };
 
-            // Note: apparently, the crc is never validated on ther server side. So I'm not sure, if I have to convert it to little endian.
-            uint32_t crc = to_little_endian(crc32(0, (unsigned char*)str, strlen(str)));
-            uint32 size  = to_little_endian(static_cast<unsigned int>(strlen(str)));
+            out = &output;
+            out->clear();
+            out->insert(out->end(), gzip_header, gzip_header + sizeof(gzip_header));
+            outSize = out->size();
+            crc = static_cast<uint32_t>(crc32(0, nullptr, 0));
+            inputSize = 0;
+            failed = false;
+
+            // the deflate state is large, so keep it around as long as the level doesn't change
+            if (initialized && level == compressionLevel && deflateReset(stream) == Z_OK)
+            {
+                return true;
+            }
+
+            if (initialized)
+            {
+                deflateEnd(stream);
+                initialized = false;
+            }
 
-            size_t totalSize = sizeof(gzip_header);
-            totalSize += deflated.size();
-            totalSize += 8;
-            char* resultArray = new char[totalSize];
-            size_t current = 0;
-            for(size_t i = 0; i < sizeof(gzip_header); ++i)
+            memset(stream, 0, sizeof(z_stream));
+            /* windowsize is negative to suppress Zlib header */
+            if (deflateInit2(stream, compressionLevel, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 9, MZ_DEFAULT_STRATEGY) != Z_OK)
             {
-                resultArray[i] = gzip_header[i];
+                logging::GALogger::e("deflateInit failed while compressing.");
+                failed = true;
+                return false;
             }
-            current += sizeof(gzip_header);
-            for(size_t i = 0; i < deflated.size(); ++i)
+            initialized = true;
+            level = compressionLevel;
+            return true;
+        }
+
+        bool GAGzipCompressor::write(const char* data, size_t size)
+        {
+            if (failed || !out)
             {
-                resultArray[i + current] = deflated[i];
+                return false;
             }
-            current += deflated.size();
-            strncpy(resultArray + current, (const char*)&crc, 4);
-            current += 4;
-            strncpy(resultArray + current, (const char*)&size, 4);
 
-            std::vector<char> result;
+            crc = static_cast<uint32_t>(crc32(crc, reinterpret_cast<const unsigned char*>(data), size));
+            inputSize += static_cast<uint32_t>(size);
 
-            for(size_t i = 0; i < totalSize; ++i)
+            stream->next_in = reinterpret_cast<const unsigned char*>(data);
+            stream->avail_in = static_cast<unsigned int>(size);
+            return deflateInto(Z_NO_FLUSH);
+        }
+
+        bool GAGzipCompressor::finish()
+        {
+            if (failed || !out)
             {
-                result.push_back(resultArray[i]);
+                return false;
             }
-            delete[] resultArray;
 
-            return result;
+            stream->next_in = nullptr;
+            stream->avail_in = 0;
+            bool success = deflateInto(Z_FINISH);
+            out->resize(outSize);
+
+            if (!success)
+            {
+                out->clear();
+                return false;
+            }
+
+            // crc and uncompressed size, both little endian
+            for (int shift = 0; shift < 32; shift += 8)
+            {
+                out->push_back(static_cast<char>((crc >> shift) & 0xFF));
+            }
+            for (int shift = 0; shift < 32; shift += 8)
+            {
+                out->push_back(static_cast<char>((inputSize >> shift) & 0xFF));
+            }
+            return true;
+        }
+
+        bool GAGzipCompressor::deflateInto(int flush)
+        {
+            for (;;)
+            {
+                // deflate straight into the free space at the end of the output
+                if (out->size() - outSize < MinFreeOutputSize)
+                {
+                    out->resize(std::max(out->size() * 2, outSize + MinFreeOutputSize));
+                }
+                stream->next_out = reinterpret_cast<unsigned char*>(out->data() + outSize);
+                stream->avail_out = static_cast<unsigned int>(out->size() - outSize);
+
+                int ret = deflate(stream, flush);
+                outSize = out->size() - stream->avail_out;
+
+                if (ret == Z_STREAM_END)
+                {
+                    return true;
+                }
+                if (ret != Z_OK && ret != Z_BUF_ERROR)
+                {
+                    // an error occurred that was not EOF
+                    logging::GALogger::e("Exception during zlib compression: (%d) %s", ret, stream->msg ? stream->msg : "");
+                    failed = true;
+                    return false;
+                }
+                if (flush != Z_FINISH && stream->avail_in == 0 && stream->avail_out != 0)
+                {
+                    return true;
+                }
+            }
         }
 
         const char* GAUtilities::getPathSeparator()
@@ -362,7 +354,18 @@ namespace gameanalytics
 
         std::vector<char> GAUtilities::gzipCompress(const char* data)
         {
-            return compress_string_gzip(data);
+            return gzipCompress(data, GAGzipCompressor::BestCompression);
+        }
+
+        std::vector<char> GAUtilities::gzipCompress(const char* data, int level)
+        {
+            std::vector<char> result;
+            GAGzipCompressor compressor;
+            if (!compressor.begin(result, level) || !compressor.write(data, strlen(data)) || !compressor.finish())
+            {
+                result.clear();
+            }
+            return result;
         }
 
         // TODO(nikolaj): explain function
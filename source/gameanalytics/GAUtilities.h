@@ -16,10 +16,50 @@
 #include "GALogger.h"
 #endif
 
+struct mz_stream_s;
+
 namespace gameanalytics
 {
     namespace utilities
     {
+        /*!
+        gzip compressor that can be fed in pieces. the compressed bytes are written straight into the output
+        and the deflate state is kept between payloads, so a reused compressor doesn't allocate once it is warm.
+        */
+        class GAGzipCompressor
+        {
+         public:
+            static const int BestSpeed = 1;
+            static const int BestCompression = 9;
+
+            GAGzipCompressor();
+            ~GAGzipCompressor();
+
+            // starts a payload in output (cleared, its capacity is kept), level goes from BestSpeed to BestCompression
+            bool begin(std::vector<char>& output, int compressionLevel);
+            bool write(const char* data, size_t size);
+            // completes the payload, output holds the whole gzip member afterwards (or nothing on errors)
+            bool finish();
+
+         private:
+            GAGzipCompressor(const GAGzipCompressor&) = delete;
+            GAGzipCompressor& operator=(const GAGzipCompressor&) = delete;
+
+            bool deflateInto(int flush);
+
+            static const size_t MinFreeOutputSize = 4096;
+
+            mz_stream_s* stream;
+            bool initialized;
+            int level;
+            std::vector<char>* out;
+            // bytes of out in use, the rest is room for deflate
+            size_t outSize;
+            uint32_t crc;
+            uint32_t inputSize;
+            bool failed;
+        };
+
         class GAUtilities
         {
         public:
@@ -28,6 +68,7 @@ namespace gameanalytics
             static void hmacWithKey(const char* key, const std::vector<char>& data, char* out);
             static bool stringMatch(const char* string, const char* pattern);
             static std::vector<char> gzipCompress(const char* data);
+            static std::vector<char> gzipCompress(const char* data, int level);
 
             // added for C++ port
             static bool isStringNullOrEmpty(const char* s);
@@ -443,14 +443,25 @@ namespace gameanalytics
         // event params
         bool GAValidator::validateKeys(const char* gameKey, const char* gameSecret)
         {
-            if (utilities::GAUtilities::stringMatch(gameKey, "^[A-z0-9]{32}$"))
+            // ^[A-z0-9]{32}$ and ^[A-z0-9]{40}$, A-z also covers [\]^_` like the regex did
+            const char* keys[2] = { gameKey, gameSecret };
+            const size_t lengths[2] = { 32, 40 };
+            for (int k = 0; k < 2; ++k)
             {
-                if (utilities::GAUtilities::stringMatch(gameSecret, "^[A-z0-9]{40}$"))
+                size_t size = 0;
+                for (const char* c = keys[k]; *c != '\0'; ++c, ++size)
                 {
-                    return true;
+                    if (size >= lengths[k] || !((*c >= 'A' && *c <= 'z') || (*c >= '0' && *c <= '9')))
+                    {
+                        return false;
+                    }
+                }
+                if (size != lengths[k])
+                {
+                    return false;
                 }
             }
-            return false;
+            return true;
         }
 
         bool GAValidator::validateCurrency(const char* currency)
@@ -459,11 +470,15 @@ namespace gameanalytics
             {
                 return false;
             }
-            if (!utilities::GAUtilities::stringMatch(currency, "^[A-Z]{3}$"))
+            // ^[A-Z]{3}$
+            for (int index = 0; index < 3; ++index)
             {
-                return false;
+                if (currency[index] < 'A' || currency[index] > 'Z')
+                {
+                    return false;
+                }
             }
-            return true;
+            return currency[3] == '\0';
         }
 
         bool GAValidator::validateEventPartLength(const char* eventPart, bool allowNull)
@@ -488,11 +503,16 @@ namespace gameanalytics
 
         bool GAValidator::validateEventPartCharacters(const char* eventPart)
         {
-            if (!utilities::GAUtilities::stringMatch(eventPart, "^[A-Za-z0-9\\s\\-_\\.\\(\\)\\!\\?]{1,64}$"))
+            // ^[A-Za-z0-9\s\-_\.\(\)\!\?]{1,64}$
+            size_t size = 0;
+            for (const char* c = eventPart; *c != '\0'; ++c, ++size)
             {
-                return false;
+                if (size >= 64 || !isEventPartCharacter(*c))
+                {
+                    return false;
+                }
             }
-            return true;
+            return size > 0;
         }
 
         bool GAValidator::validateEventIdLength(const char* eventId)
@@ -502,11 +522,8 @@ namespace gameanalytics
                 return false;
             }
 
-            if (!utilities::GAUtilities::stringMatch(eventId, "^[^:]{1,64}(?::[^:]{1,64}){0,4}$"))
-            {
-                return false;
-            }
-            return true;
+            // ^[^:]{1,64}(?::[^:]{1,64}){0,4}$
+            return matchEventId(eventId, false);
         }
 
         bool GAValidator::validateEventIdCharacters(const char* eventId)
@@ -516,11 +533,8 @@ namespace gameanalytics
                 return false;
             }
 
-            if (!utilities::GAUtilities::stringMatch(eventId, "^[A-Za-z0-9\\s\\-_\\.\\(\\)\\!\\?]{1,64}(:[A-Za-z0-9\\s\\-_\\.\\(\\)\\!\\?]{1,64}){0,4}$"))
-            {
-                return false;
-            }
-            return true;
+            // ^[A-Za-z0-9\s\-_\.\(\)\!\?]{1,64}(:[A-Za-z0-9\s\-_\.\(\)\!\?]{1,64}){0,4}$
+            return matchEventId(eventId, true);
         }
 
         bool GAValidator::validateShortString(const char* shortString, bool canBeEmpty = false)
@@ -574,11 +588,9 @@ namespace gameanalytics
         // validate wrapper version, build, engine version, store
         bool GAValidator::validateSdkWrapperVersion(const char* wrapperVersion)
         {
-            if (!utilities::GAUtilities::stringMatch(wrapperVersion, "^(unity|unreal|corona|cocos2d|lumberyard|air|gamemaker|defold|godot) [0-9]{0,5}(\\.[0-9]{0,5}){0,2}$"))
-            {
-                return false;
-            }
-            return true;
+            // ^(unity|unreal|corona|cocos2d|lumberyard|air|gamemaker|defold|godot) [0-9]{0,5}(\.[0-9]{0,5}){0,2}$
+            static const char* const names[] = { "unity", "unreal", "corona", "cocos2d", "lumberyard", "air", "gamemaker", "defold", "godot" };
+            return matchVersion(wrapperVersion, names, sizeof(names) / sizeof(names[0]));
         }
 
         bool GAValidator::validateBuild(const char* build)
@@ -592,21 +604,21 @@ namespace gameanalytics
 
         bool GAValidator::validateEngineVersion(const char* engineVersion)
         {
-            if (!utilities::GAUtilities::stringMatch(engineVersion, "^(unity|unreal|corona|cocos2d|lumberyard|gamemaker|defold|godot) [0-9]{0,5}(\\.[0-9]{0,5}){0,2}$"))
-            {
-                return false;
-            }
-            return true;
+            // ^(unity|unreal|corona|cocos2d|lumberyard|gamemaker|defold|godot) [0-9]{0,5}(\.[0-9]{0,5}){0,2}$
+            static const char* const names[] = { "unity", "unreal", "corona", "cocos2d", "lumberyard", "gamemaker", "defold", "godot" };
+            return matchVersion(engineVersion, names, sizeof(names) / sizeof(names[0]));
         }
 
         bool GAValidator::validateStore(const char* store)
         {
-            return utilities::GAUtilities::stringMatch(store, "^(apple|google_play)$");
+            static const char* const stores[] = { "apple", "google_play" };
+            return matchOneOf(store, stores, sizeof(stores) / sizeof(stores[0]));
         }
 
         bool GAValidator::validateConnectionType(const char* connectionType)
         {
-            return utilities::GAUtilities::stringMatch(connectionType, "^(wwan|wifi|lan|offline)$");
+            static const char* const connectionTypes[] = { "wwan", "wifi", "lan", "offline" };
+            return matchOneOf(connectionType, connectionTypes, sizeof(connectionTypes) / sizeof(connectionTypes[0]));
         }
 
         // dimensions
@@ -626,7 +638,13 @@ namespace gameanalytics
             // validate each string for regex
             for (CharArray resourceCurrency : resourceCurrencies.getVector())
             {
-                if (!utilities::GAUtilities::stringMatch(resourceCurrency.array, "^[A-Za-z]+$"))
+                // ^[A-Za-z]+$
+                bool valid = resourceCurrency.array[0] != '\0';
+                for (const char* c = resourceCurrency.array; *c != '\0' && valid; ++c)
+                {
+                    valid = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z');
+                }
+                if (!valid)
                 {
                     logging::GALogger::w("resource currencies validation failed: a resource currency can only be A-Z, a-z. String was: %s", resourceCurrency.array);
                     return false;
@@ -816,5 +834,120 @@ namespace gameanalytics
                 }
             }
         }
+
+        bool GAValidator::validateCustomFieldKey(const char* key)
+        {
+            // ^[a-zA-Z0-9_]{1,64}$
+            if (!key)
+            {
+                return false;
+            }
+
+            size_t size = 0;
+            for (const char* c = key; *c != '\0'; ++c, ++size)
+            {
+                if (size >= static_cast<size_t>(CustomFields::MaxKeyLength))
+                {
+                    return false;
+                }
+                if (!((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') || *c == '_'))
+                {
+                    return false;
+                }
+            }
+            return size > 0;
+        }
+
+        bool GAValidator::validateCustomFieldStringValue(const char* value)
+        {
+            if (!value)
+            {
+                return false;
+            }
+
+            size_t size = strlen(value);
+            return size > 0 && size <= static_cast<size_t>(CustomFields::MaxStringValueLength);
+        }
+
+        bool GAValidator::isEventPartCharacter(char c)
+        {
+            // [A-Za-z0-9\s\-_\.\(\)\!\?], \s being space, \t, \n, \v, \f and \r
+            unsigned char u = static_cast<unsigned char>(c);
+            return static_cast<unsigned char>((u | 0x20) - 'a') < 26 || static_cast<unsigned char>(u - '0') < 10
+                || u == ' ' || static_cast<unsigned char>(u - '\t') < 5
+                || u == '-' || u == '_' || u == '.' || u == '(' || u == ')' || u == '!' || u == '?';
+        }
+
+        bool GAValidator::matchEventId(const char* eventId, bool checkCharacters)
+        {
+            // 1 to 5 parts separated by ':', each 1 to 64 characters
+            int parts = 1;
+            size_t partSize = 0;
+            for (const char* c = eventId; *c != '\0'; ++c)
+            {
+                if (*c == ':')
+                {
+                    if (partSize == 0 || ++parts > 5)
+                    {
+                        return false;
+                    }
+                    partSize = 0;
+                }
+                else if (++partSize > 64 || (checkCharacters && !isEventPartCharacter(*c)))
+                {
+                    return false;
+                }
+            }
+            return partSize > 0;
+        }
+
+        bool GAValidator::matchVersion(const char* version, const char* const names[], size_t nameCount)
+        {
+            // "<name> " followed by 1 to 3 groups of 0 to 5 digits separated by '.'
+            const char* c = NULL;
+            for (size_t index = 0; index < nameCount && !c; ++index)
+            {
+                size_t length = strlen(names[index]);
+                if (strncmp(version, names[index], length) == 0 && version[length] == ' ')
+                {
+                    c = version + length + 1;
+                }
+            }
+            if (!c)
+            {
+                return false;
+            }
+
+            int groups = 1;
+            int digits = 0;
+            for (; *c != '\0'; ++c)
+            {
+                if (*c == '.')
+                {
+                    if (++groups > 3)
+                    {
+                        return false;
+                    }
+                    digits = 0;
+                }
+                else if (*c < '0' || *c > '9' || ++digits > 5)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool GAValidator::matchOneOf(const char* string, const char* const values[], size_t valueCount)
+        {
+            for (size_t index = 0; index < valueCount; ++index)
+            {
+                if (strcmp(string, values[index]) == 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
     }
 }
@@ -115,6 +115,17 @@ namespace gameanalytics
             static bool validateClientTs(int64_t clientTs);
 
             static bool validateUserId(const char* uId);
+
+            // custom fields
+            static bool validateCustomFieldKey(const char* key);
+            static bool validateCustomFieldStringValue(const char* value);
+
+         private:
+            // hand-written matchers for the patterns in the comments of the validators using them
+            static bool isEventPartCharacter(char c);
+            static bool matchEventId(const char* eventId, bool checkCharacters);
+            static bool matchVersion(const char* version, const char* const names[], size_t nameCount);
+            static bool matchOneOf(const char* string, const char* const values[], size_t valueCount);
         };
     }
 }
@@ -23,9 +23,216 @@
 #include <thread>
 #endif
 #include <array>
+#include <cstring>
+#include <cmath>
 
 namespace gameanalytics
 {
+    namespace
+    {
+        // custom fields are queued either as the JSON string (parsed on the GA thread) or in their packed typed form
+        void writeCustomFields(threading::GAThreading::TaskPayload& payload, const char* fieldsJson, const CustomFields* customFields)
+        {
+            payload.write(customFields != nullptr);
+            if(customFields)
+            {
+                payload.write(customFields->getCount());
+                payload.write(customFields->getSize());
+                payload.writeBytes(customFields->getData(), customFields->getSize());
+            }
+            else
+            {
+                payload.writeString(fieldsJson, 4096);
+            }
+        }
+
+        void readCustomFields(threading::GAThreading::TaskPayload& payload, CustomFields& out)
+        {
+            if(payload.read<bool>())
+            {
+                int count = payload.read<int>();
+                size_t size = payload.read<size_t>();
+                out.assign(payload.readBytes(size), size, count);
+            }
+            else
+            {
+                const char* fieldsJson = payload.readString();
+                if(fieldsJson[0] != '\0')
+                {
+                    rapidjson::Document fieldsDocument;
+                    fieldsDocument.Parse(fieldsJson);
+                    state::GAState::validateAndCleanCustomFields(fieldsDocument, out);
+                }
+            }
+        }
+    }
+
+    // ----------------------- CUSTOM FIELDS ---------------------- //
+
+    CustomFields& CustomFields::add(const char* key, int value)
+    {
+        return add(key, static_cast<double>(value));
+    }
+
+    CustomFields& CustomFields::add(const char* key, double value)
+    {
+        if(!canAdd(key))
+        {
+            return *this;
+        }
+        // rapidjson can't write NaN or infinity, the event json would be cut off there
+        if(!std::isfinite(value))
+        {
+            logging::GALogger::w("CustomFields: entry with key=%s has been omitted because its value is not a finite number", key);
+            return *this;
+        }
+        append(key, value);
+        return *this;
+    }
+
+    CustomFields& CustomFields::add(const char* key, const char* value)
+    {
+        if(!canAdd(key))
+        {
+            return *this;
+        }
+        if(!validators::GAValidator::validateCustomFieldStringValue(value))
+        {
+            logging::GALogger::w("CustomFields: entry with key=%s, value=%s has been omitted because its value is an empty string or exceeds the max number of characters (%d)", key, value ? value : "null", MaxStringValueLength);
+            return *this;
+        }
+        append(key, value);
+        return *this;
+    }
+
+    bool CustomFields::canAdd(const char* key) const
+    {
+        if(!validators::GAValidator::validateCustomFieldKey(key))
+        {
+            logging::GALogger::w("CustomFields: entry with key=%s has been omitted because its key contains illegal character, is empty or exceeds the max number of characters (%d)", key ? key : "null", MaxKeyLength);
+            return false;
+        }
+        if(count >= MaxCount)
+        {
+            logging::GALogger::w("CustomFields: entry with key=%s has been omitted because it exceeds the max number of custom fields (%d)", key, MaxCount);
+            return false;
+        }
+        if(has(key))
+        {
+            logging::GALogger::w("CustomFields: entry with key=%s has been omitted because the key has already been added", key);
+            return false;
+        }
+        return true;
+    }
+
+    bool CustomFields::has(const char* key) const
+    {
+        size_t position = 0;
+        Field field;
+        while(next(position, field))
+        {
+            if(strcmp(field.key, key) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // entries are packed as: type ('n' or 's'), key\0, then the double or the string\0
+    void CustomFields::append(const char* key, double value)
+    {
+        data.push_back('n');
+        data.insert(data.end(), key, key + strlen(key) + 1);
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        data.insert(data.end(), bytes, bytes + sizeof(value));
+        ++count;
+    }
+
+    void CustomFields::append(const char* key, const char* value)
+    {
+        data.push_back('s');
+        data.insert(data.end(), key, key + strlen(key) + 1);
+        data.insert(data.end(), value, value + strlen(value) + 1);
+        ++count;
+    }
+
+    bool CustomFields::next(size_t& position, Field& field) const
+    {
+        if(position >= data.size())
+        {
+            return false;
+        }
+
+        field.isNumber = data[position] == 'n';
+        ++position;
+        field.key = data.data() + position;
+        position += strlen(field.key) + 1;
+        if(field.isNumber)
+        {
+            memcpy(&field.number, data.data() + position, sizeof(field.number));
+            position += sizeof(field.number);
+            field.string = nullptr;
+        }
+        else
+        {
+            field.number = 0;
+            field.string = data.data() + position;
+            position += strlen(field.string) + 1;
+        }
+        return true;
+    }
+
+    bool CustomFields::assign(const char* packedData, size_t size, int fieldCount)
+    {
+        clear();
+
+        // next() trusts the layout, so every entry has to be complete and end inside the buffer
+        int entries = 0;
+        size_t position = 0;
+        while(position < size)
+        {
+            char type = packedData[position++];
+            const char* key = packedData + position;
+            const char* keyEnd = static_cast<const char*>(memchr(key, '\0', size - position));
+            if((type != 'n' && type != 's') || !keyEnd || keyEnd == key || keyEnd - key > MaxKeyLength)
+            {
+                break;
+            }
+            position += keyEnd - key + 1;
+
+            if(type == 'n')
+            {
+                if(size - position < sizeof(double))
+                {
+                    break;
+                }
+                position += sizeof(double);
+            }
+            else
+            {
+                const char* value = packedData + position;
+                const char* valueEnd = static_cast<const char*>(memchr(value, '\0', size - position));
+                if(!valueEnd || valueEnd - value > MaxStringValueLength)
+                {
+                    break;
+                }
+                position += valueEnd - value + 1;
+            }
+            ++entries;
+        }
+
+        if(position != size || entries != fieldCount || entries > MaxCount)
+        {
+            logging::GALogger::w("CustomFields: packed data has been omitted because it is not valid");
+            return false;
+        }
+
+        data.assign(packedData, packedData + size);
+        count = fieldCount;
+        return true;
+    }
+
     bool GameAnalytics::_endThread = false;
 
     // ----------------------- CONFIGURE ---------------------- //
@@ -257,6 +464,7 @@ namespace gameanalytics
                 return;
             }
             device::GADevice::setBuildPlatform(platform.data());
+            state::GAState::invalidateEventAnnotations();
         });
     }
 
@@ -316,6 +524,7 @@ namespace gameanalytics
                 return;
             }
             device::GADevice::setDeviceModel(deviceModel.data());
+            state::GAState::invalidateEventAnnotations();
         });
     }
 
@@ -341,6 +550,222 @@ namespace gameanalytics
                 return;
             }
             device::GADevice::setDeviceManufacturer(deviceManufacturer.data());
+            state::GAState::invalidateEventAnnotations();
+        });
+    }
+
+    void GameAnalytics::configureTaskQueueFullPolicy(EGATaskQueueFullPolicy policy)
+    {
+        // applied right away, as it decides how this and later calls are queued
+        threading::GAThreading::setTaskQueueFullPolicy(policy);
+    }
+
+    void GameAnalytics::configureEventBufferDurabilityWindow(double seconds)
+    {
+        if(_endThread)
+        {
+            return;
+        }
+
+        threading::GAThreading::performTaskOnGAThread([seconds]()
+        {
+            if (seconds < 0)
+            {
+                logging::GALogger::i("Validation fail - configure event buffer durability window: Cannot be negative. Value: %f", seconds);
+                return;
+            }
+            events::GAEvents::setEventBufferDurabilityWindow(seconds);
+        });
+    }
+
+    void GameAnalytics::configureEventBufferSize(int eventCount)
+    {
+        if(_endThread)
+        {
+            return;
+        }
+
+        threading::GAThreading::performTaskOnGAThread([eventCount]()
+        {
+            if (eventCount < 1)
+            {
+                logging::GALogger::i("Validation fail - configure event buffer size: Must be at least 1. Value: %d", eventCount);
+                return;
+            }
+            events::GAEvents::setEventBufferSize(eventCount);
+        });
+    }
+
+    void GameAnalytics::configureEventCompressionLevel(int level)
+    {
+        if(_endThread)
+        {
+            return;
+        }
+
+        threading::GAThreading::performTaskOnGAThread([level]()
+        {
+            if (level < utilities::GAGzipCompressor::BestSpeed || level > utilities::GAGzipCompressor::BestCompression)
+            {
+                logging::GALogger::i("Validation fail - configure event compression level: Must be between %d and %d. Value: %d", utilities::GAGzipCompressor::BestSpeed, utilities::GAGzipCompressor::BestCompression, level);
+                return;
+            }
+            http::GAHTTPApi* http = http::GAHTTPApi::getInstance();
+            if(http)
+            {
+                http->setCompressionLevel(level);
+            }
+        });
+    }
+
+    void GameAnalytics::configureDatabaseJournalMode(EGADatabaseJournalMode mode)
+    {
+        if(_endThread)
+        {
+            return;
+        }
+
+        threading::GAThreading::performTaskOnGAThread([mode]()
+        {
+            if (mode < JournalModeDelete || mode > JournalModeWAL)
+            {
+                logging::GALogger::i("Validation fail - configure database journal mode: Unknown mode. Value: %d", static_cast<int>(mode));
+                return;
+            }
+            store::GAStore::setJournalMode(mode);
+        });
+    }
+
+    void GameAnalytics::configureDatabaseSynchronous(EGADatabaseSynchronous level)
+    {
+        if(_endThread)
+        {
+            return;
+        }
+
+        threading::GAThreading::performTaskOnGAThread([level]()
+        {
+            if (level < SynchronousOff || level > SynchronousExtra)
+            {
+                logging::GALogger::i("Validation fail - configure database synchronous: Unknown level. Value: %d", static_cast<int>(level));
+                return;
+            }
+            store::GAStore::setSynchronous(level);
+        });
+    }
+
+    void GameAnalytics::configureDatabasePageSize(int bytes)
+    {
+        if(_endThread)
+        {
+            return;
+        }
+
+        threading::GAThreading::performTaskOnGAThread([bytes]()
+        {
+            if (bytes < 512 || bytes > 65536 || (bytes & (bytes - 1)) != 0)
+            {
+                logging::GALogger::i("Validation fail - configure database page size: Must be a power of two between 512 and 65536. Value: %d", bytes);
+                return;
+            }
+            store::GAStore::setPageSize(bytes);
+        });
+    }
+
+    void GameAnalytics::configureDatabaseCacheSize(int kibibytes)
+    {
+        if(_endThread)
+        {
+            return;
+        }
+
+        threading::GAThreading::performTaskOnGAThread([kibibytes]()
+        {
+            if (kibibytes < 1)
+            {
+                logging::GALogger::i("Validation fail - configure database cache size: Must be at least 1. Value: %d", kibibytes);
+                return;
+            }
+            store::GAStore::setCacheSize(kibibytes);
+        });
+    }
+
+    void GameAnalytics::configureDatabaseMmapSize(long long bytes)
+    {
+        if(_endThread)
+        {
+            return;
+        }
+
+        threading::GAThreading::performTaskOnGAThread([bytes]()
+        {
+            if (bytes < 0)
+            {
+                logging::GALogger::i("Validation fail - configure database mmap size: Cannot be negative. Value: %lld", bytes);
+                return;
+            }
+            store::GAStore::setMmapSize(bytes);
+        });
+    }
+
+    void GameAnalytics::configureEventStoreQuota(long long maxBytes, int maxEventCount)
+    {
+        if(_endThread)
+        {
+            return;
+        }
+
+        threading::GAThreading::performTaskOnGAThread([maxBytes, maxEventCount]()
+        {
+            if (maxBytes < 0 || maxEventCount < 0)
+            {
+                logging::GALogger::i("Validation fail - configure event store quota: Cannot be negative. Bytes: %lld, events: %d", maxBytes, maxEventCount);
+                return;
+            }
+            store::GAStore::setEventQuota(maxBytes, maxEventCount);
+        });
+    }
+
+    void GameAnalytics::configureEventEvictionPriority(const char* category_, int priority)
+    {
+        if(_endThread)
+        {
+            return;
+        }
+
+        std::array<char, 33> category = {'\0'};
+        snprintf(category.data(), category.size(), "%s", category_ ? category_ : "");
+        threading::GAThreading::performTaskOnGAThread([category, priority]()
+        {
+            if (priority < 0 || priority > store::GAStore::KeepEventPriority)
+            {
+                logging::GALogger::i("Validation fail - configure event eviction priority: Must be between 0 and %d. Value: %d", store::GAStore::KeepEventPriority, priority);
+                return;
+            }
+            if (!store::GAStore::setEventEvictionPriority(category.data(), priority))
+            {
+                logging::GALogger::i("Validation fail - configure event eviction priority: Unknown category. Value: %s", category.data());
+            }
+        });
+    }
+
+    void GameAnalytics::configureLogRotation(long long maxFileSizeBytes, int generations)
+    {
+        if(_endThread)
+        {
+            return;
+        }
+
+        threading::GAThreading::performTaskOnGAThread([maxFileSizeBytes, generations]()
+        {
+            if (maxFileSizeBytes < 0 || generations < 1 || generations > 9)
+            {
+                logging::GALogger::i("Validation fail - configure log rotation: Size cannot be negative and generations must be 1 to 9. Bytes: %lld, generations: %d", maxFileSizeBytes, generations);
+                return;
+            }
+#if !USE_UWP && !USE_TIZEN
+            logging::GALogger::setLogRotation(maxFileSizeBytes, generations);
+#endif
         });
     }
 
@@ -365,6 +790,7 @@ namespace gameanalytics
                 return;
             }
             device::GADevice::setSdkGameEngineVersion(sdkGameEngineVersion.data());
+            state::GAState::invalidateEventAnnotations();
         });
     }
 
@@ -389,6 +815,7 @@ namespace gameanalytics
                 return;
             }
             device::GADevice::setGameEngineVersion(gameEngineVersion.data());
+            state::GAState::invalidateEventAnnotations();
         });
     }
 
@@ -495,33 +922,53 @@ namespace gameanalytics
         const char* cartType_,
         const char* fields_,
         bool mergeFields)
+    {
+        queueBusinessEvent(currency_, amount, itemType_, itemId_, cartType_, fields_, nullptr, mergeFields);
+    }
+
+    void GameAnalytics::addBusinessEvent(const char* currency_, int amount, const char* itemType_, const char* itemId_, const char* cartType_, const CustomFields& customFields)
+    {
+        addBusinessEvent(currency_, amount, itemType_, itemId_, cartType_, customFields, false);
+    }
+
+    void GameAnalytics::addBusinessEvent(const char* currency_, int amount, const char* itemType_, const char* itemId_, const char* cartType_, const CustomFields& customFields, bool mergeFields)
+    {
+        queueBusinessEvent(currency_, amount, itemType_, itemId_, cartType_, nullptr, &customFields, mergeFields);
+    }
+
+    void GameAnalytics::queueBusinessEvent(const char* currency_, int amount, const char* itemType_, const char* itemId_, const char* cartType_, const char* fieldsJson_, const CustomFields* customFields_, bool mergeFields)
     {
         if(_endThread)
         {
             return;
         }
 
-        std::array<char, 65> currency = {'\0'};
-        snprintf(currency.data(), currency.size(), "%s", currency_ ? currency_ : "");
-        std::array<char, 65> itemType = {'\0'};
-        snprintf(itemType.data(), itemType.size(), "%s", itemType_ ? itemType_ : "");
-        std::array<char, 65> itemId = {'\0'};
-        snprintf(itemId.data(), itemId.size(), "%s", itemId_ ? itemId_ : "");
-        std::array<char, 65> cartType = {'\0'};
-        snprintf(cartType.data(), cartType.size(), "%s", cartType_ ? cartType_ : "");
-        std::array<char, 4097> fields = {'\0'};
-        snprintf(fields.data(), fields.size(), "%s", fields_ ? fields_ : "");
-        threading::GAThreading::performTaskOnGAThread([currency, amount, itemType, itemId, cartType, fields, mergeFields]()
+        threading::GAThreading::TaskPayload* payload = threading::GAThreading::TaskPayload::acquire();
+        writeCustomFields(*payload, fieldsJson_, customFields_);
+        payload->writeString(currency_, 64);
+        payload->write(amount);
+        payload->writeString(itemType_, 64);
+        payload->writeString(itemId_, 64);
+        payload->writeString(cartType_, 64);
+        payload->write(mergeFields);
+        threading::GAThreading::performEventTaskOnGAThread([](threading::GAThreading::TaskPayload& payload)
         {
             if (!isSdkReady(true, true, "Could not add business event"))
             {
                 return;
             }
+            CustomFields fields;
+            readCustomFields(payload, fields);
+            const char* currency = payload.readString();
+            int amount = payload.read<int>();
+            const char* itemType = payload.readString();
+            const char* itemId = payload.readString();
+            const char* cartType = payload.readString();
+            bool mergeFields = payload.read<bool>();
+
             // Send to events
-            rapidjson::Document fieldsJson;
-            fieldsJson.Parse(fields.data());
-            events::GAEvents::addBusinessEvent(currency.data(), amount, itemType.data(), itemId.data(), cartType.data(), fieldsJson, mergeFields);
-        });
+            events::GAEvents::addBusinessEvent(currency, amount, itemType, itemId, cartType, fields, mergeFields);
+        }, payload);
     }
 
 
@@ -536,31 +983,52 @@ namespace gameanalytics
     }
 
     void GameAnalytics::addResourceEvent(EGAResourceFlowType flowType, const char* currency_, float amount, const char* itemType_, const char* itemId_, const char* fields_, bool mergeFields)
+    {
+        queueResourceEvent(flowType, currency_, amount, itemType_, itemId_, fields_, nullptr, mergeFields);
+    }
+
+    void GameAnalytics::addResourceEvent(EGAResourceFlowType flowType, const char* currency_, float amount, const char* itemType_, const char* itemId_, const CustomFields& customFields)
+    {
+        addResourceEvent(flowType, currency_, amount, itemType_, itemId_, customFields, false);
+    }
+
+    void GameAnalytics::addResourceEvent(EGAResourceFlowType flowType, const char* currency_, float amount, const char* itemType_, const char* itemId_, const CustomFields& customFields, bool mergeFields)
+    {
+        queueResourceEvent(flowType, currency_, amount, itemType_, itemId_, nullptr, &customFields, mergeFields);
+    }
+
+    void GameAnalytics::queueResourceEvent(EGAResourceFlowType flowType, const char* currency_, float amount, const char* itemType_, const char* itemId_, const char* fieldsJson_, const CustomFields* customFields_, bool mergeFields)
     {
         if(_endThread)
         {
             return;
         }
 
-        std::array<char, 65> currency = {'\0'};
-        snprintf(currency.data(), currency.size(), "%s", currency_ ? currency_ : "");
-        std::array<char, 65> itemType = {'\0'};
-        snprintf(itemType.data(), itemType.size(), "%s", itemType_ ? itemType_ : "");
-        std::array<char, 65> itemId = {'\0'};
-        snprintf(itemId.data(), itemId.size(), "%s", itemId_ ? itemId_ : "");
-        std::array<char, 4097> fields = {'\0'};
-        snprintf(fields.data(), fields.size(), "%s", fields_ ? fields_ : "");
-        threading::GAThreading::performTaskOnGAThread([flowType, currency, amount, itemType, itemId, fields, mergeFields]()
+        threading::GAThreading::TaskPayload* payload = threading::GAThreading::TaskPayload::acquire();
+        writeCustomFields(*payload, fieldsJson_, customFields_);
+        payload->write(flowType);
+        payload->writeString(currency_, 64);
+        payload->write(amount);
+        payload->writeString(itemType_, 64);
+        payload->writeString(itemId_, 64);
+        payload->write(mergeFields);
+        threading::GAThreading::performEventTaskOnGAThread([](threading::GAThreading::TaskPayload& payload)
         {
             if (!isSdkReady(true, true, "Could not add resource event"))
             {
                 return;
             }
+            CustomFields fields;
+            readCustomFields(payload, fields);
+            EGAResourceFlowType flowType = payload.read<EGAResourceFlowType>();
+            const char* currency = payload.readString();
+            float amount = payload.read<float>();
+            const char* itemType = payload.readString();
+            const char* itemId = payload.readString();
+            bool mergeFields = payload.read<bool>();
 
-            rapidjson::Document fieldsJson;
-            fieldsJson.Parse(fields.data());
-            events::GAEvents::addResourceEvent(flowType, currency.data(), amount, itemType.data(), itemId.data(), fieldsJson, mergeFields);
-        });
+            events::GAEvents::addResourceEvent(flowType, currency, amount, itemType, itemId, fields, mergeFields);
+        }, payload);
     }
 
     void GameAnalytics::addProgressionEvent(EGAProgressionStatus progressionStatus, const char* progression01, const char* progression02, const char* progression03)
@@ -575,31 +1043,17 @@ namespace gameanalytics
 
     void GameAnalytics::addProgressionEvent(EGAProgressionStatus progressionStatus, const char* progression01_, const char* progression02_, const char* progression03_, const char* fields_, bool mergeFields)
     {
-        if(_endThread)
-        {
-            return;
-        }
+        queueProgressionEvent(progressionStatus, progression01_, progression02_, progression03_, 0, false, fields_, nullptr, mergeFields);
+    }
 
-        std::array<char, 65> progression01 = {'\0'};
-        snprintf(progression01.data(), progression01.size(), "%s", progression01_ ? progression01_ : "");
-        std::array<char, 65> progression02 = {'\0'};
-        snprintf(progression02.data(), progression02.size(), "%s", progression02_ ? progression02_ : "");
-        std::array<char, 65> progression03 = {'\0'};
-        snprintf(progression03.data(), progression03.size(), "%s", progression03_ ? progression03_ : "");
-        std::array<char, 4097> fields = {'\0'};
-        snprintf(fields.data(), fields.size(), "%s", fields_);
-        threading::GAThreading::performTaskOnGAThread([progressionStatus, progression01, progression02, progression03, fields, mergeFields]()
-        {
-            if (!isSdkReady(true, true, "Could not add progression event"))
-            {
-                return;
-            }
+    void GameAnalytics::addProgressionEvent(EGAProgressionStatus progressionStatus, const char* progression01_, const char* progression02_, const char* progression03_, const CustomFields& customFields)
+    {
+        addProgressionEvent(progressionStatus, progression01_, progression02_, progression03_, customFields, false);
+    }
 
-            // Send to events
-            rapidjson::Document fieldsJson;
-            fieldsJson.Parse(fields.data());
-            events::GAEvents::addProgressionEvent(progressionStatus, progression01.data(), progression02.data(), progression03.data(), 0, false, fieldsJson, mergeFields);
-        });
+    void GameAnalytics::addProgressionEvent(EGAProgressionStatus progressionStatus, const char* progression01_, const char* progression02_, const char* progression03_, const CustomFields& customFields, bool mergeFields)
+    {
+        queueProgressionEvent(progressionStatus, progression01_, progression02_, progression03_, 0, false, nullptr, &customFields, mergeFields);
     }
 
     void GameAnalytics::addProgressionEvent(EGAProgressionStatus progressionStatus, const char* progression01, const char* progression02, const char* progression03, int score)
@@ -613,32 +1067,55 @@ namespace gameanalytics
     }
 
     void GameAnalytics::addProgressionEvent(EGAProgressionStatus progressionStatus, const char* progression01_, const char* progression02_, const char* progression03_, int score, const char* fields_, bool mergeFields)
+    {
+        queueProgressionEvent(progressionStatus, progression01_, progression02_, progression03_, score, true, fields_, nullptr, mergeFields);
+    }
+
+    void GameAnalytics::addProgressionEvent(EGAProgressionStatus progressionStatus, const char* progression01_, const char* progression02_, const char* progression03_, int score, const CustomFields& customFields)
+    {
+        addProgressionEvent(progressionStatus, progression01_, progression02_, progression03_, score, customFields, false);
+    }
+
+    void GameAnalytics::addProgressionEvent(EGAProgressionStatus progressionStatus, const char* progression01_, const char* progression02_, const char* progression03_, int score, const CustomFields& customFields, bool mergeFields)
+    {
+        queueProgressionEvent(progressionStatus, progression01_, progression02_, progression03_, score, true, nullptr, &customFields, mergeFields);
+    }
+
+    void GameAnalytics::queueProgressionEvent(EGAProgressionStatus progressionStatus, const char* progression01_, const char* progression02_, const char* progression03_, int score, bool sendScore, const char* fieldsJson_, const CustomFields* customFields_, bool mergeFields)
     {
         if(_endThread)
         {
             return;
         }
 
-        std::array<char, 65> progression01 = {'\0'};
-        snprintf(progression01.data(), progression01.size(), "%s", progression01_ ? progression01_ : "");
-        std::array<char, 65> progression02 = {'\0'};
-        snprintf(progression02.data(), progression02.size(), "%s", progression02_ ? progression02_ : "");
-        std::array<char, 65> progression03 = {'\0'};
-        snprintf(progression03.data(), progression03.size(), "%s", progression03_ ? progression03_ : "");
-        std::array<char, 4097> fields = {'\0'};
-        snprintf(fields.data(), fields.size(), "%s", fields_ ? fields_ : "");
-        threading::GAThreading::performTaskOnGAThread([progressionStatus, progression01, progression02, progression03, score, fields, mergeFields]()
+        threading::GAThreading::TaskPayload* payload = threading::GAThreading::TaskPayload::acquire();
+        writeCustomFields(*payload, fieldsJson_, customFields_);
+        payload->write(progressionStatus);
+        payload->writeString(progression01_, 64);
+        payload->writeString(progression02_, 64);
+        payload->writeString(progression03_, 64);
+        payload->write(score);
+        payload->write(sendScore);
+        payload->write(mergeFields);
+        threading::GAThreading::performEventTaskOnGAThread([](threading::GAThreading::TaskPayload& payload)
         {
             if (!isSdkReady(true, true, "Could not add progression event"))
             {
                 return;
             }
+            CustomFields fields;
+            readCustomFields(payload, fields);
+            EGAProgressionStatus progressionStatus = payload.read<EGAProgressionStatus>();
+            const char* progression01 = payload.readString();
+            const char* progression02 = payload.readString();
+            const char* progression03 = payload.readString();
+            int score = payload.read<int>();
+            bool sendScore = payload.read<bool>();
+            bool mergeFields = payload.read<bool>();
 
             // Send to events
-            rapidjson::Document fieldsJson;
-            fieldsJson.Parse(fields.data());
-            events::GAEvents::addProgressionEvent(progressionStatus, progression01.data(), progression02.data(), progression03.data(), score, true, fieldsJson, mergeFields);
-        });
+            events::GAEvents::addProgressionEvent(progressionStatus, progression01, progression02, progression03, score, sendScore, fields, mergeFields);
+        }, payload);
     }
 
     void GameAnalytics::addDesignEvent(const char* eventId)
@@ -653,25 +1130,17 @@ namespace gameanalytics
 
     void GameAnalytics::addDesignEvent(const char* eventId_, const char* fields_, bool mergeFields)
     {
-        if(_endThread)
-        {
-            return;
-        }
+        queueDesignEvent(eventId_, 0, false, fields_, nullptr, mergeFields);
+    }
 
-        std::array<char, 400> eventId = {'\0'};
-        snprintf(eventId.data(), eventId.size(), "%s", eventId_ ? eventId_ : "");
-        std::array<char, 4097> fields = {'\0'};
-        snprintf(fields.data(), fields.size(), "%s", fields_ ? fields_ : "");
-        threading::GAThreading::performTaskOnGAThread([eventId, fields, mergeFields]()
-        {
-            if (!isSdkReady(true, true, "Could not add design event"))
-            {
-                return;
-            }
-            rapidjson::Document fieldsJson;
-            fieldsJson.Parse(fields.data());
-            events::GAEvents::addDesignEvent(eventId.data(), 0, false, fieldsJson, mergeFields);
-        });
+    void GameAnalytics::addDesignEvent(const char* eventId_, const CustomFields& customFields)
+    {
+        addDesignEvent(eventId_, customFields, false);
+    }
+
+    void GameAnalytics::addDesignEvent(const char* eventId_, const CustomFields& customFields, bool mergeFields)
+    {
+        queueDesignEvent(eventId_, 0, false, nullptr, &customFields, mergeFields);
     }
 
     void GameAnalytics::addDesignEvent(const char* eventId, double value)
@@ -685,26 +1154,48 @@ namespace gameanalytics
     }
 
     void GameAnalytics::addDesignEvent(const char* eventId_, double value, const char* fields_, bool mergeFields)
+    {
+        queueDesignEvent(eventId_, value, true, fields_, nullptr, mergeFields);
+    }
+
+    void GameAnalytics::addDesignEvent(const char* eventId_, double value, const CustomFields& customFields)
+    {
+        addDesignEvent(eventId_, value, customFields, false);
+    }
+
+    void GameAnalytics::addDesignEvent(const char* eventId_, double value, const CustomFields& customFields, bool mergeFields)
+    {
+        queueDesignEvent(eventId_, value, true, nullptr, &customFields, mergeFields);
+    }
+
+    void GameAnalytics::queueDesignEvent(const char* eventId_, double value, bool sendValue, const char* fieldsJson_, const CustomFields* customFields_, bool mergeFields)
     {
         if(_endThread)
         {
             return;
         }
 
-        std::array<char, 400> eventId = {'\0'};
-        snprintf(eventId.data(), eventId.size(), "%s", eventId_ ? eventId_ : "");
-        std::array<char, 4097> fields = {'\0'};
-        snprintf(fields.data(), fields.size(), "%s", fields_ ? fields_ : "");
-        threading::GAThreading::performTaskOnGAThread([eventId, value, fields, mergeFields]()
+        threading::GAThreading::TaskPayload* payload = threading::GAThreading::TaskPayload::acquire();
+        writeCustomFields(*payload, fieldsJson_, customFields_);
+        payload->writeString(eventId_, 399);
+        payload->write(value);
+        payload->write(sendValue);
+        payload->write(mergeFields);
+        threading::GAThreading::performEventTaskOnGAThread([](threading::GAThreading::TaskPayload& payload)
         {
             if (!isSdkReady(true, true, "Could not add design event"))
             {
                 return;
             }
-            rapidjson::Document fieldsJson;
-            fieldsJson.Parse(fields.data());
-            events::GAEvents::addDesignEvent(eventId.data(), value, true, fieldsJson, mergeFields);
-        });
+            CustomFields fields;
+            readCustomFields(payload, fields);
+            const char* eventId = payload.readString();
+            double value = payload.read<double>();
+            bool sendValue = payload.read<bool>();
+            bool mergeFields = payload.read<bool>();
+
+            events::GAEvents::addDesignEvent(eventId, value, sendValue, fields, mergeFields);
+        }, payload);
     }
 
     void GameAnalytics::addErrorEvent(EGAErrorSeverity severity, const char* message)
@@ -718,26 +1209,46 @@ namespace gameanalytics
     }
 
     void GameAnalytics::addErrorEvent(EGAErrorSeverity severity, const char* message_, const char* fields_, bool mergeFields)
+    {
+        queueErrorEvent(severity, message_, fields_, nullptr, mergeFields);
+    }
+
+    void GameAnalytics::addErrorEvent(EGAErrorSeverity severity, const char* message_, const CustomFields& customFields)
+    {
+        addErrorEvent(severity, message_, customFields, false);
+    }
+
+    void GameAnalytics::addErrorEvent(EGAErrorSeverity severity, const char* message_, const CustomFields& customFields, bool mergeFields)
+    {
+        queueErrorEvent(severity, message_, nullptr, &customFields, mergeFields);
+    }
+
+    void GameAnalytics::queueErrorEvent(EGAErrorSeverity severity, const char* message_, const char* fieldsJson_, const CustomFields* customFields_, bool mergeFields)
     {
         if(_endThread)
         {
             return;
         }
 
-        std::array<char, 8200> message = {'\0'};
-        snprintf(message.data(), message.size(), "%s", message_ ? message_ : "");
-        std::array<char, 4097> fields = {'\0'};
-        snprintf(fields.data(), fields.size(), "%s", fields_ ? fields_ : "");
-        threading::GAThreading::performTaskOnGAThread([severity, message, fields, mergeFields]()
+        threading::GAThreading::TaskPayload* payload = threading::GAThreading::TaskPayload::acquire();
+        writeCustomFields(*payload, fieldsJson_, customFields_);
+        payload->write(severity);
+        payload->writeString(message_, 8199);
+        payload->write(mergeFields);
+        threading::GAThreading::performEventTaskOnGAThread([](threading::GAThreading::TaskPayload& payload)
         {
             if (!isSdkReady(true, true, "Could not add error event"))
             {
                 return;
             }
-            rapidjson::Document fieldsJson;
-            fieldsJson.Parse(fields.data());
-            events::GAEvents::addErrorEvent(severity, message.data(), fieldsJson, mergeFields);
-        });
+            CustomFields fields;
+            readCustomFields(payload, fields);
+            EGAErrorSeverity severity = payload.read<EGAErrorSeverity>();
+            const char* message = payload.readString();
+            bool mergeFields = payload.read<bool>();
+
+            events::GAEvents::addErrorEvent(severity, message, fields, mergeFields);
+        }, payload);
     }
 
     // ------------- SET STATE CHANGES WHILE RUNNING ----------------- //
@@ -909,6 +1420,19 @@ namespace gameanalytics
         });
     }
 
+    void GameAnalytics::setGlobalCustomEventFields(const CustomFields& customFields)
+    {
+        if (_endThread)
+        {
+            return;
+        }
+
+        threading::GAThreading::performTaskOnGAThread([customFields]()
+        {
+            state::GAState::setGlobalCustomEventFields(customFields);
+        });
+    }
+
     std::vector<char> GameAnalytics::getRemoteConfigsValueAsString(const char* key)
     {
         return getRemoteConfigsValueAsString(key, "");
@@ -919,6 +1443,27 @@ namespace gameanalytics
         return state::GAState::getRemoteConfigsStringValue(key, defaultValue);
     }
 
+    int64_t GameAnalytics::getRemoteConfigsValueAsInt64(const char* key, int64_t defaultValue)
+    {
+        std::shared_ptr<const state::RemoteConfigsSnapshot> remoteConfigs = state::GAState::getRemoteConfigsSnapshot();
+        const state::RemoteConfigsEntry* entry = remoteConfigs && key ? remoteConfigs->find(key) : nullptr;
+        return entry && entry->isInt64 ? entry->int64Value : defaultValue;
+    }
+
+    double GameAnalytics::getRemoteConfigsValueAsDouble(const char* key, double defaultValue)
+    {
+        std::shared_ptr<const state::RemoteConfigsSnapshot> remoteConfigs = state::GAState::getRemoteConfigsSnapshot();
+        const state::RemoteConfigsEntry* entry = remoteConfigs && key ? remoteConfigs->find(key) : nullptr;
+        return entry && entry->isDouble ? entry->doubleValue : defaultValue;
+    }
+
+    bool GameAnalytics::getRemoteConfigsValueAsBool(const char* key, bool defaultValue)
+    {
+        std::shared_ptr<const state::RemoteConfigsSnapshot> remoteConfigs = state::GAState::getRemoteConfigsSnapshot();
+        const state::RemoteConfigsEntry* entry = remoteConfigs && key ? remoteConfigs->find(key) : nullptr;
+        return entry && entry->isBool ? entry->boolValue : defaultValue;
+    }
+
     bool GameAnalytics::isRemoteConfigsReady()
     {
         return state::GAState::isRemoteConfigsReady();
@@ -1387,4 +1932,54 @@ namespace gameanalytics
 
 #endif
 
+
+    RemoteConfigsValue::RemoteConfigsValue(const char* key_)
+        :entry(nullptr)
+        ,version(-1)
+    {
+        const char* k = key_ ? key_ : "";
+        key.assign(k, k + strlen(k) + 1);
+    }
+
+    const state::RemoteConfigsEntry* RemoteConfigsValue::resolve()
+    {
+        // the version is read before the snapshot, a refresh in between is picked up by the next call
+        int currentVersion = state::GAState::getRemoteConfigsVersion();
+        if(currentVersion != version)
+        {
+            snapshot = state::GAState::getRemoteConfigsSnapshot();
+            entry = snapshot ? snapshot->find(key.data()) : nullptr;
+            version = currentVersion;
+        }
+        return entry;
+    }
+
+    bool RemoteConfigsValue::exists()
+    {
+        return resolve() != nullptr;
+    }
+
+    const char* RemoteConfigsValue::asString(const char* defaultValue)
+    {
+        const state::RemoteConfigsEntry* e = resolve();
+        return e ? e->string : defaultValue;
+    }
+
+    int64_t RemoteConfigsValue::asInt64(int64_t defaultValue)
+    {
+        const state::RemoteConfigsEntry* e = resolve();
+        return e && e->isInt64 ? e->int64Value : defaultValue;
+    }
+
+    double RemoteConfigsValue::asDouble(double defaultValue)
+    {
+        const state::RemoteConfigsEntry* e = resolve();
+        return e && e->isDouble ? e->doubleValue : defaultValue;
+    }
+
+    bool RemoteConfigsValue::asBool(bool defaultValue)
+    {
+        const state::RemoteConfigsEntry* e = resolve();
+        return e && e->isBool ? e->boolValue : defaultValue;
+    }
 } // namespace gameanalytics
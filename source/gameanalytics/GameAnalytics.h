@@ -14,6 +14,7 @@
 #include <vector>
 #include <memory>
 #include <future>
+#include <cstdint>
 #if USE_TIZEN || GA_SHARED_LIB
 #include "GameAnalyticsExtern.h"
 #endif
@@ -87,6 +88,72 @@ namespace gameanalytics
         LogDebug = 3
     };
 
+    /*!
+     @enum
+     @discussion
+     This enum is used to specify what happens to add*Event calls when the internal task queue is full.
+     Other calls (initialize, configure*, startSession, onQuit...) are never dropped, they wait for room
+     or are kept aside until the queue has room again
+     @constant DropOldest
+     Discard the oldest queued events to make room for the new one
+     @constant DropNewest
+     Discard the new event
+     @constant WaitForSpace
+     Block the calling thread until there is room in the queue. Events queued from the GA thread itself
+     (e.g. SDK error events) are discarded like DropNewest, as nothing else would make room
+     */
+    enum EGATaskQueueFullPolicy
+    {
+        DropOldest = 1,
+        DropNewest = 2,
+        WaitForSpace = 3
+    };
+
+    /*!
+     @enum
+     @discussion
+     This enum is used to specify the journal mode of the local event database
+     @constant JournalModeDelete
+     Rollback journal deleted after each transaction (sqlite default)
+     @constant JournalModeTruncate
+     Rollback journal truncated after each transaction
+     @constant JournalModePersist
+     Rollback journal kept and its header zeroed after each transaction
+     @constant JournalModeMemory
+     Rollback journal kept in memory, a crash during a write can corrupt the database
+     @constant JournalModeWAL
+     Write-ahead log, commits append to the log and readers don't block the writer
+     */
+    enum EGADatabaseJournalMode
+    {
+        JournalModeDelete = 1,
+        JournalModeTruncate = 2,
+        JournalModePersist = 3,
+        JournalModeMemory = 4,
+        JournalModeWAL = 5
+    };
+
+    /*!
+     @enum
+     @discussion
+     This enum is used to specify how often the local event database syncs to storage
+     @constant SynchronousOff
+     Never sync, events written shortly before a power loss can be lost or the database corrupted
+     @constant SynchronousNormal
+     Sync at critical moments only, with JournalModeWAL recent commits can be lost on power loss but the database stays intact
+     @constant SynchronousFull
+     Sync on every commit (sqlite default)
+     @constant SynchronousExtra
+     Like SynchronousFull and also syncs the journal directory
+     */
+    enum EGADatabaseSynchronous
+    {
+        SynchronousOff = 1,
+        SynchronousNormal = 2,
+        SynchronousFull = 3,
+        SynchronousExtra = 4
+    };
+
     class IRemoteConfigsListener
     {
         public:
@@ -118,6 +185,108 @@ namespace gameanalytics
         std::vector<CharArray> v;
     };
 
+    namespace state
+    {
+        class GAState;
+        class RemoteConfigsSnapshot;
+        struct RemoteConfigsEntry;
+    }
+
+    /*!
+     A remote config that is looked up once and kept until the configs are refreshed, for keys read often (every frame).
+     Reading never allocates and only checks an atomic version until a refresh, unlike the getRemoteConfigsValueAs*
+     functions which take the current configs under a short lock. A handle is not meant to be shared between threads.
+     */
+    class RemoteConfigsValue
+    {
+     public:
+        explicit RemoteConfigsValue(const char* key);
+
+        bool exists();
+        // the text is owned by the configs, it stays valid until a call on this handle picks up refreshed configs
+        const char* asString(const char* defaultValue);
+        // the default is returned when the value has another type, strings holding a number or true/false convert
+        int64_t asInt64(int64_t defaultValue);
+        double asDouble(double defaultValue);
+        bool asBool(bool defaultValue);
+
+     private:
+        const state::RemoteConfigsEntry* resolve();
+
+        std::vector<char> key;
+        std::shared_ptr<const state::RemoteConfigsSnapshot> snapshot;
+        const state::RemoteConfigsEntry* entry;
+        int version;
+    };
+
+    /*!
+     Typed custom fields for an event, an alternative to passing the fields as a JSON string.
+     Every entry is validated once when it is added (invalid entries are skipped with a warning),
+     and the fields are kept packed in a single buffer, so they are queued without any JSON parsing.
+     */
+    class CustomFields
+    {
+    public:
+        static const int MaxCount = 50;
+        static const int MaxKeyLength = 64;
+        static const int MaxStringValueLength = 256;
+
+        struct Field
+        {
+            const char* key;
+            bool isNumber;
+            double number;
+            const char* string;
+        };
+
+        CustomFields() :count(0) {}
+
+        CustomFields& add(const char* key, int value);
+        CustomFields& add(const char* key, double value);
+        CustomFields& add(const char* key, const char* value);
+
+        bool has(const char* key) const;
+        bool isEmpty() const
+        {
+            return count == 0;
+        }
+        int getCount() const
+        {
+            return count;
+        }
+
+        // iterates the fields, start with position 0, returns false when there are no more fields
+        bool next(size_t& position, Field& field) const;
+
+        // packed representation, used to move the fields between threads.
+        // assign checks the layout, a buffer that isn't one from getData leaves the fields empty and returns false
+        const char* getData() const
+        {
+            return data.data();
+        }
+        size_t getSize() const
+        {
+            return data.size();
+        }
+        bool assign(const char* packedData, size_t size, int fieldCount);
+        void clear()
+        {
+            data.clear();
+            count = 0;
+        }
+
+    private:
+        friend class state::GAState;
+
+        bool canAdd(const char* key) const;
+        // appends an entry which has already been validated
+        void append(const char* key, double value);
+        void append(const char* key, const char* value);
+
+        std::vector<char> data;
+        int count;
+    };
+
     class GameAnalytics
     {
      public:
@@ -141,6 +310,31 @@ namespace gameanalytics
          static void disableDeviceInfo();
          static void configureDeviceModel(const char *deviceModel);
          static void configureDeviceManufacturer(const char *deviceManufacturer);
+         // what happens to add*Event calls when the internal task queue is full (default DropOldest), other calls are never dropped
+         static void configureTaskQueueFullPolicy(EGATaskQueueFullPolicy policy);
+         // events are written to the local store in batches, at the latest after this many seconds (default 2, 0 writes every event right away)
+         static void configureEventBufferDurabilityWindow(double seconds);
+         // number of buffered events that triggers a write to the local store (default 50)
+         static void configureEventBufferSize(int eventCount);
+         // gzip level used for event submission, 1 (fastest) to 9 (smallest, default)
+         static void configureEventCompressionLevel(int level);
+         // local event database tuning, sqlite defaults are kept for anything not configured
+         static void configureDatabaseJournalMode(EGADatabaseJournalMode mode);
+         static void configureDatabaseSynchronous(EGADatabaseSynchronous level);
+         // power of two between 512 and 65536, only applies when the database is created
+         static void configureDatabasePageSize(int bytes);
+         // page cache of the database connection in KiB
+         static void configureDatabaseCacheSize(int kibibytes);
+         // bytes of the database file read through memory mapping, 0 disables it
+         static void configureDatabaseMmapSize(long long bytes);
+         // limits for locally stored events (default 5 MB and no event count limit), 0 disables a limit
+         static void configureEventStoreQuota(long long maxBytes, int maxEventCount);
+         // 0 to 10, over quota the oldest events of the lowest priority category are evicted first and 10 is never evicted.
+         // defaults: user, session_end and business 10, progression 4, resource 3, design 2, error 1
+         static void configureEventEvictionPriority(const char *category, int priority);
+         // ga_log.txt is rotated by renaming it once it reaches maxFileSizeBytes (default 1 MB, 0 never rotates),
+         // keeping up to 9 older files (default 1, ga_log-prev.txt)
+         static void configureLogRotation(long long maxFileSizeBytes, int generations);
 
          // the version of SDK code used in an engine. Used for sdk_version field.
          // !! if set then it will override the SdkWrapperVersion.
@@ -183,6 +377,22 @@ namespace gameanalytics
          static void addErrorEvent(EGAErrorSeverity severity, const char *message, const char *customFields);
          static void addErrorEvent(EGAErrorSeverity severity, const char *message, const char *customFields, bool mergeFields);
 
+         // add events with typed custom fields
+         static void addBusinessEvent(const char *currency, int amount, const char *itemType, const char *itemId, const char *cartType, const CustomFields &customFields);
+         static void addBusinessEvent(const char *currency, int amount, const char *itemType, const char *itemId, const char *cartType, const CustomFields &customFields, bool mergeFields);
+         static void addResourceEvent(EGAResourceFlowType flowType, const char *currency, float amount, const char *itemType, const char *itemId, const CustomFields &customFields);
+         static void addResourceEvent(EGAResourceFlowType flowType, const char *currency, float amount, const char *itemType, const char *itemId, const CustomFields &customFields, bool mergeFields);
+         static void addProgressionEvent(EGAProgressionStatus progressionStatus, const char *progression01, const char *progression02, const char *progression03, const CustomFields &customFields);
+         static void addProgressionEvent(EGAProgressionStatus progressionStatus, const char *progression01, const char *progression02, const char *progression03, const CustomFields &customFields, bool mergeFields);
+         static void addProgressionEvent(EGAProgressionStatus progressionStatus, const char *progression01, const char *progression02, const char *progression03, int score, const CustomFields &customFields);
+         static void addProgressionEvent(EGAProgressionStatus progressionStatus, const char *progression01, const char *progression02, const char *progression03, int score, const CustomFields &customFields, bool mergeFields);
+         static void addDesignEvent(const char *eventId, const CustomFields &customFields);
+         static void addDesignEvent(const char *eventId, const CustomFields &customFields, bool mergeFields);
+         static void addDesignEvent(const char *eventId, double value, const CustomFields &customFields);
+         static void addDesignEvent(const char *eventId, double value, const CustomFields &customFields, bool mergeFields);
+         static void addErrorEvent(EGAErrorSeverity severity, const char *message, const CustomFields &customFields);
+         static void addErrorEvent(EGAErrorSeverity severity, const char *message, const CustomFields &customFields, bool mergeFields);
+
          // set calls can be changed at any time (pre- and post-initialize)
          // some calls only work after a configure is called (setCustomDimension)
          static void setEnabledInfoLog(bool flag);
@@ -195,12 +405,17 @@ namespace gameanalytics
          static void setCustomDimension03(const char *dimension03);
 
          static void setGlobalCustomEventFields(const char *customFields);
+         static void setGlobalCustomEventFields(const CustomFields &customFields);
 
          static void startSession();
          static void endSession();
 
          static std::vector<char> getRemoteConfigsValueAsString(const char *key);
          static std::vector<char> getRemoteConfigsValueAsString(const char *key, const char *defaultValue);
+         // typed remote configs, see RemoteConfigsValue for the conversions
+         static int64_t getRemoteConfigsValueAsInt64(const char *key, int64_t defaultValue);
+         static double getRemoteConfigsValueAsDouble(const char *key, double defaultValue);
+         static bool getRemoteConfigsValueAsBool(const char *key, bool defaultValue);
          static bool isRemoteConfigsReady();
          static void addRemoteConfigsListener(const std::shared_ptr<IRemoteConfigsListener> &listener);
          static void removeRemoteConfigsListener(const std::shared_ptr<IRemoteConfigsListener> &listener);
@@ -265,6 +480,13 @@ namespace gameanalytics
         static bool isSdkReady(bool needsInitialized);
         static bool isSdkReady(bool needsInitialized, bool warn);
         static bool isSdkReady(bool needsInitialized, bool warn, const char* message);
+
+        // custom fields are given either as JSON or typed, exactly one of fieldsJson and customFields is set
+        static void queueBusinessEvent(const char* currency, int amount, const char* itemType, const char* itemId, const char* cartType, const char* fieldsJson, const CustomFields* customFields, bool mergeFields);
+        static void queueResourceEvent(EGAResourceFlowType flowType, const char* currency, float amount, const char* itemType, const char* itemId, const char* fieldsJson, const CustomFields* customFields, bool mergeFields);
+        static void queueProgressionEvent(EGAProgressionStatus progressionStatus, const char* progression01, const char* progression02, const char* progression03, int score, bool sendScore, const char* fieldsJson, const CustomFields* customFields, bool mergeFields);
+        static void queueDesignEvent(const char* eventId, double value, bool sendValue, const char* fieldsJson, const CustomFields* customFields, bool mergeFields);
+        static void queueErrorEvent(EGAErrorSeverity severity, const char* message, const char* fieldsJson, const CustomFields* customFields, bool mergeFields);
 #if USE_UWP
         static void OnAppSuspending(Platform::Object ^sender, Windows::ApplicationModel::SuspendingEventArgs ^e);
         static void OnAppResuming(Platform::Object ^sender, Platform::Object ^args);
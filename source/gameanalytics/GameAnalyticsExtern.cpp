@@ -253,6 +253,21 @@ const char* getRemoteConfigsValueAsStringWithDefaultValue(const char *key, const
     return result;
 }
 
+long long getRemoteConfigsValueAsInt64WithDefaultValue(const char *key, long long defaultValue)
+{
+    return gameanalytics::GameAnalytics::getRemoteConfigsValueAsInt64(key, defaultValue);
+}
+
+double getRemoteConfigsValueAsDoubleWithDefaultValue(const char *key, double defaultValue)
+{
+    return gameanalytics::GameAnalytics::getRemoteConfigsValueAsDouble(key, defaultValue);
+}
+
+double getRemoteConfigsValueAsBoolWithDefaultValue(const char *key, double defaultValue)
+{
+    return gameanalytics::GameAnalytics::getRemoteConfigsValueAsBool(key, defaultValue != 0) ? 1 : 0;
+}
+
 double isRemoteConfigsReady()
 {
     return gameanalytics::GameAnalytics::isRemoteConfigsReady() ? 1 : 0;
@@ -75,6 +75,9 @@ EXPORT void onQuit();
 
 EXPORT const char* getRemoteConfigsValueAsString(const char *key);
 EXPORT const char* getRemoteConfigsValueAsStringWithDefaultValue(const char *key, const char *defaultValue);
+EXPORT long long getRemoteConfigsValueAsInt64WithDefaultValue(const char *key, long long defaultValue);
+EXPORT double getRemoteConfigsValueAsDoubleWithDefaultValue(const char *key, double defaultValue);
+EXPORT double getRemoteConfigsValueAsBoolWithDefaultValue(const char *key, double defaultValue);
 EXPORT double isRemoteConfigsReady();
 EXPORT const char* getRemoteConfigsContentAsString();
 
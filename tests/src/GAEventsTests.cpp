@@ -0,0 +1,374 @@
+//
+// GA-SDK-CPP
+// Copyright 2018 GameAnalytics C++ SDK. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GAEvents.h"
+#include "GALogger.h"
+#include "GAState.h"
+#include "GAStore.h"
+#include "GAThreading.h"
+
+namespace
+{
+    const char* GameKey = "bd624ee6f8e6efb32a054f8d7ba11618";
+    const char* GameSecret = "7f5c3f682cbd217841efba92e92ffb1b3b6612bc";
+    const int MaxBufferedEventCount = 2000;
+    const int MaxEventCount = 500;
+
+    // the event queue timer also runs on the GA thread, so nothing flushes the buffer while a task runs
+    bool runOnGAThread(const gameanalytics::threading::GAThreading::Block& task)
+    {
+        std::shared_ptr<std::promise<void>> done = std::make_shared<std::promise<void>>();
+        std::future<void> future = done->get_future();
+        gameanalytics::threading::GAThreading::performTaskOnGAThread([task, done]()
+        {
+            task();
+            done->set_value();
+        });
+        return future.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+    }
+
+    // an initialized sdk with an empty store and an empty event buffer, must run on the GA thread.
+    // the default 2 second durability window keeps the queue timer ticking every 2 seconds
+    void resetSdk(int bufferSize)
+    {
+        gameanalytics::logging::GALogger::setInfoLog(false);
+        gameanalytics::logging::GALogger::setVerboseInfoLog(false);
+        gameanalytics::events::GAEvents::setEventBufferDurabilityWindow(2);
+        gameanalytics::events::GAEvents::setEventBufferSize(bufferSize);
+        gameanalytics::state::GAState::setKeys(GameKey, GameSecret);
+        gameanalytics::state::GAState::setEnabledEventSubmission(true);
+        gameanalytics::events::GAEvents::flushEventBuffer();
+        gameanalytics::store::GAStore::ensureDatabase(true, GameKey);
+        if (!gameanalytics::state::GAState::isInitialized())
+        {
+            gameanalytics::state::GAState::internalInitialize();
+            gameanalytics::events::GAEvents::flushEventBuffer();
+            gameanalytics::store::GAStore::executeQuerySync("DELETE FROM ga_events;");
+        }
+        gameanalytics::events::GAEvents::ensureEventQueueIsRunning();
+    }
+
+    // stops the event queue and returns once its last tick has run
+    bool stopEventQueue()
+    {
+        if (!runOnGAThread([]() { gameanalytics::events::GAEvents::stopEventQueue(); }))
+        {
+            return false;
+        }
+
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            // only one timer can be pending, this one is ignored until the queue's last tick has run
+            std::shared_ptr<std::promise<void>> ran = std::make_shared<std::promise<void>>();
+            std::future<void> future = ran->get_future();
+            gameanalytics::threading::GAThreading::scheduleTimer(0, [ran]()
+            {
+                ran->set_value();
+            });
+            if (future.wait_for(std::chrono::milliseconds(100)) == std::future_status::ready)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void addDesignEvent(int number)
+    {
+        std::string eventId = "buffer:event" + std::to_string(number);
+        gameanalytics::events::GAEvents::addDesignEvent(eventId.c_str(), 0, false, gameanalytics::CustomFields(), false);
+    }
+
+    int storedEventCount()
+    {
+        int count = -1;
+        gameanalytics::store::GAStore::queryRowsSync("SELECT COUNT(*) FROM ga_events;", [&count](const gameanalytics::store::GAStoreRow& row)
+        {
+            count = static_cast<int>(row.getInt64(0));
+            return false;
+        });
+        return count;
+    }
+
+    int storedEventCount(const char* status)
+    {
+        int count = -1;
+        const char* parameters[1] = { status };
+        gameanalytics::store::GAStore::queryRowsSync("SELECT COUNT(*) FROM ga_events WHERE status = ?;", parameters, 1, [&count](const gameanalytics::store::GAStoreRow& row)
+        {
+            count = static_cast<int>(row.getInt64(0));
+            return false;
+        });
+        return count;
+    }
+
+    // inserts count new events with the same client_ts, the event json is {"number":<i>}
+    void insertEventsSharingClientTs(int count)
+    {
+        std::vector<std::string> events;
+        for (int i = 0; i < count; ++i)
+        {
+            events.push_back("{\"number\":" + std::to_string(i) + "}");
+        }
+        std::vector<const char*> parameters;
+        for (const std::string& event : events)
+        {
+            parameters.push_back("design");
+            parameters.push_back("2d9a2b2a-8c24-4a6c-9b1d-1c2e6f9d8e71");
+            parameters.push_back("1539000000");
+            parameters.push_back(event.c_str());
+        }
+        gameanalytics::store::GAStore::executeBatchQuerySync("INSERT INTO ga_events (status, category, session_id, client_ts, event) VALUES(0, ?, ?, ?, ?);", parameters.data(), 4, count);
+    }
+
+    // event_id of every stored event in insert order
+    std::vector<std::string> storedEventIds()
+    {
+        std::vector<std::string> ids;
+        gameanalytics::store::GAStore::queryRowsSync("SELECT json_extract(event, '$.event_id') FROM ga_events ORDER BY id;", [&ids](const gameanalytics::store::GAStoreRow& row)
+        {
+            ids.push_back(row.getString(0));
+            return true;
+        });
+        return ids;
+    }
+}
+
+class GAEventsTest : public ::testing::Test
+{
+protected:
+    static void TearDownTestCase()
+    {
+        // later tests use the store from the test thread, nothing may write to it from the GA thread alongside them
+        ASSERT_TRUE(stopEventQueue());
+        ASSERT_TRUE(runOnGAThread([]()
+        {
+            gameanalytics::state::GAState::setEnabledEventSubmission(false);
+        }));
+    }
+};
+
+TEST_F(GAEventsTest, testEventBufferFlushesWhenFull)
+{
+    int countBeforeFull = -1;
+    int countWhenFull = -1;
+    ASSERT_TRUE(runOnGAThread([&countBeforeFull, &countWhenFull]()
+    {
+        resetSdk(5);
+        for (int i = 0; i < 4; ++i)
+        {
+            addDesignEvent(i);
+        }
+        countBeforeFull = storedEventCount();
+        addDesignEvent(4);
+        countWhenFull = storedEventCount();
+    }));
+
+    ASSERT_EQ(0, countBeforeFull);
+    ASSERT_EQ(5, countWhenFull);
+}
+
+TEST_F(GAEventsTest, testEventBufferFlushesAfterDurabilityWindow)
+{
+    int countAfterAdd = -1;
+    ASSERT_TRUE(runOnGAThread([&countAfterAdd]()
+    {
+        resetSdk(50);
+        gameanalytics::events::GAEvents::setEventBufferDurabilityWindow(0.2);
+        addDesignEvent(0);
+        countAfterAdd = storedEventCount();
+    }));
+    ASSERT_EQ(0, countAfterAdd);
+
+    // flushed by the next tick of the queue timer
+    int count = 0;
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (count == 0 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ASSERT_TRUE(runOnGAThread([&count]()
+        {
+            count = storedEventCount();
+        }));
+    }
+    ASSERT_EQ(1, count);
+
+    ASSERT_TRUE(runOnGAThread([]()
+    {
+        resetSdk(50);
+    }));
+}
+
+TEST_F(GAEventsTest, testEventBufferKeepsEventsWhenInsertFails)
+{
+    bool failedFlush = true;
+    bool flush = false;
+    std::vector<std::string> ids;
+    ASSERT_TRUE(runOnGAThread([&failedFlush, &flush, &ids]()
+    {
+        resetSdk(50);
+        for (int i = 0; i < 3; ++i)
+        {
+            addDesignEvent(i);
+        }
+        // inserts fail until ensureDatabase creates the table again
+        gameanalytics::store::GAStore::executeQuerySync("DROP TABLE ga_events;");
+        failedFlush = gameanalytics::events::GAEvents::flushEventBuffer();
+        addDesignEvent(3);
+        gameanalytics::store::GAStore::ensureDatabase(false, GameKey);
+        flush = gameanalytics::events::GAEvents::flushEventBuffer();
+        ids = storedEventIds();
+    }));
+
+    ASSERT_FALSE(failedFlush);
+    ASSERT_TRUE(flush);
+    // the events put back stay in front of the one buffered after the failed flush
+    ASSERT_EQ(std::vector<std::string>({ "buffer:event0", "buffer:event1", "buffer:event2", "buffer:event3" }), ids);
+}
+
+TEST_F(GAEventsTest, testEventBufferDropsOldestEventsOverLimit)
+{
+    bool failedFlush = true;
+    bool flush = false;
+    std::vector<std::string> ids;
+    ASSERT_TRUE(runOnGAThread([&failedFlush, &flush, &ids]()
+    {
+        // large enough for a single flush to see every event
+        resetSdk(MaxBufferedEventCount + 100);
+        gameanalytics::store::GAStore::executeQuerySync("DROP TABLE ga_events;");
+        for (int i = 0; i < MaxBufferedEventCount + 10; ++i)
+        {
+            addDesignEvent(i);
+        }
+        failedFlush = gameanalytics::events::GAEvents::flushEventBuffer();
+        gameanalytics::store::GAStore::ensureDatabase(false, GameKey);
+        flush = gameanalytics::events::GAEvents::flushEventBuffer();
+        ids = storedEventIds();
+        resetSdk(50);
+    }));
+
+    ASSERT_FALSE(failedFlush);
+    ASSERT_TRUE(flush);
+    ASSERT_EQ(static_cast<size_t>(MaxBufferedEventCount), ids.size());
+    ASSERT_EQ("buffer:event10", ids.front());
+    ASSERT_EQ("buffer:event" + std::to_string(MaxBufferedEventCount + 9), ids.back());
+}
+
+TEST_F(GAEventsTest, testClaimEventsClaimsMaxEventCountSharingClientTs)
+{
+    bool claimed = false;
+    std::vector<std::string> events;
+    int claimedCount = -1;
+    int newCount = -1;
+    bool claimedRest = false;
+    int restCount = 0;
+    ASSERT_TRUE(runOnGAThread([&]()
+    {
+        resetSdk(50);
+        insertEventsSharingClientTs(MaxEventCount + 100);
+        claimed = gameanalytics::events::GAEvents::claimEvents("", "101", [&events](const gameanalytics::store::GAStoreRow& row)
+        {
+            events.push_back(row.getString(0));
+            return true;
+        });
+        claimedCount = storedEventCount("101");
+        newCount = storedEventCount("0");
+        claimedRest = gameanalytics::events::GAEvents::claimEvents("", "102", [&restCount](const gameanalytics::store::GAStoreRow&)
+        {
+            ++restCount;
+            return true;
+        });
+        resetSdk(50);
+    }));
+
+    // the shared client_ts doesn't let the claim take more than its share, the oldest rows go first
+    ASSERT_TRUE(claimed);
+    ASSERT_EQ(static_cast<size_t>(MaxEventCount), events.size());
+    ASSERT_EQ("{\"number\":0}", events.front());
+    ASSERT_EQ("{\"number\":" + std::to_string(MaxEventCount - 1) + "}", events.back());
+    ASSERT_EQ(MaxEventCount, claimedCount);
+    ASSERT_EQ(100, newCount);
+    ASSERT_TRUE(claimedRest);
+    ASSERT_EQ(100, restCount);
+}
+
+TEST_F(GAEventsTest, testClaimEventsRollsBackWhenReadingFails)
+{
+    bool claimed = true;
+    int newCount = -1;
+    int claimedCount = -1;
+    bool claimedAgain = false;
+    int readCount = 0;
+    ASSERT_TRUE(runOnGAThread([&]()
+    {
+        resetSdk(50);
+        insertEventsSharingClientTs(10);
+        int rowsRead = 0;
+        claimed = gameanalytics::events::GAEvents::claimEvents("", "101", [&rowsRead](const gameanalytics::store::GAStoreRow&)
+        {
+            return ++rowsRead < 3;
+        });
+        newCount = storedEventCount("0");
+        claimedCount = storedEventCount("101");
+        claimedAgain = gameanalytics::events::GAEvents::claimEvents("", "102", [&readCount](const gameanalytics::store::GAStoreRow&)
+        {
+            ++readCount;
+            return true;
+        });
+        resetSdk(50);
+    }));
+
+    // the rows stay new for the next submission
+    ASSERT_FALSE(claimed);
+    ASSERT_EQ(10, newCount);
+    ASSERT_EQ(0, claimedCount);
+    ASSERT_TRUE(claimedAgain);
+    ASSERT_EQ(10, readCount);
+}
+
+TEST_F(GAEventsTest, testSessionTimeIsWrittenAtMostOncePerInterval)
+{
+    int writesWhileAdding = -1;
+    int writesAfterStop = -1;
+    ASSERT_TRUE(runOnGAThread([&writesWhileAdding, &writesAfterStop]()
+    {
+        // every event is written right away, and every write marks the session time as behind
+        resetSdk(1);
+        gameanalytics::store::GAStore::executeQuerySync("CREATE TEMP TABLE session_writes(session_id TEXT);");
+        gameanalytics::store::GAStore::executeQuerySync("CREATE TEMP TRIGGER count_session_writes AFTER INSERT ON ga_session BEGIN INSERT INTO session_writes VALUES(NEW.session_id); END;");
+        for (int i = 0; i < 20; ++i)
+        {
+            addDesignEvent(i);
+        }
+        gameanalytics::store::GAStore::queryRowsSync("SELECT COUNT(*) FROM session_writes;", [&writesWhileAdding](const gameanalytics::store::GAStoreRow& row)
+        {
+            writesWhileAdding = static_cast<int>(row.getInt64(0));
+            return false;
+        });
+
+        // stopping the queue writes the one still pending
+        gameanalytics::events::GAEvents::stopEventQueue();
+        gameanalytics::store::GAStore::queryRowsSync("SELECT COUNT(*) FROM session_writes;", [&writesAfterStop](const gameanalytics::store::GAStoreRow& row)
+        {
+            writesAfterStop = static_cast<int>(row.getInt64(0));
+            return false;
+        });
+        resetSdk(50);
+    }));
+
+    // the 20 writes are well within one SessionTimeIntervalInSeconds
+    ASSERT_LE(writesWhileAdding, 1);
+    ASSERT_GE(writesWhileAdding, 0);
+    ASSERT_EQ(writesWhileAdding + 1, writesAfterStop);
+}
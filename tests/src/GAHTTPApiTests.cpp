@@ -0,0 +1,98 @@
+//
+// GA-SDK-CPP
+// Copyright 2018 GameAnalytics C++ SDK. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "GAHTTPApi.h"
+
+namespace
+{
+    const int MaxCount = 10;
+    const size_t MaxQueuedSdkErrors = 20;
+
+    gameanalytics::http::SdkErrorEvent makeSdkError(gameanalytics::http::EGASdkErrorArea area, gameanalytics::http::EGASdkErrorAction action, const std::string& gameKey)
+    {
+        gameanalytics::http::SdkErrorEvent errorEvent;
+        errorEvent.type = std::make_tuple(gameanalytics::http::EventValidation, area);
+        errorEvent.action = action;
+        errorEvent.gameKey = gameKey;
+        errorEvent.json = "{}";
+        return errorEvent;
+    }
+}
+
+TEST(GAHTTPApi, testSdkErrorQueueSkipsQueuedDuplicates)
+{
+    gameanalytics::http::GASdkErrorQueue queue(MaxCount, MaxQueuedSdkErrors);
+    const int64_t now = 1000;
+
+    ASSERT_EQ(gameanalytics::http::GASdkErrorQueue::Queued, queue.push(makeSdkError(gameanalytics::http::DesignEvent, gameanalytics::http::InvalidEventIdLength, "game"), now));
+    ASSERT_EQ(gameanalytics::http::GASdkErrorQueue::AlreadyQueued, queue.push(makeSdkError(gameanalytics::http::DesignEvent, gameanalytics::http::InvalidEventIdLength, "game"), now));
+    // a different action or game is not a duplicate
+    ASSERT_EQ(gameanalytics::http::GASdkErrorQueue::Queued, queue.push(makeSdkError(gameanalytics::http::DesignEvent, gameanalytics::http::InvalidEventIdCharacters, "game"), now));
+    ASSERT_EQ(gameanalytics::http::GASdkErrorQueue::Queued, queue.push(makeSdkError(gameanalytics::http::DesignEvent, gameanalytics::http::InvalidEventIdLength, "other game"), now));
+    ASSERT_EQ(3u, queue.size());
+
+    // once sent it can be queued again
+    std::vector<gameanalytics::http::SdkErrorEvent> events;
+    queue.takeAll(events);
+    ASSERT_EQ(3u, events.size());
+    ASSERT_TRUE(queue.isEmpty());
+    ASSERT_EQ(gameanalytics::http::GASdkErrorQueue::Queued, queue.push(makeSdkError(gameanalytics::http::DesignEvent, gameanalytics::http::InvalidEventIdLength, "game"), now));
+}
+
+TEST(GAHTTPApi, testSdkErrorQueueRateLimitCountsQueuedErrors)
+{
+    gameanalytics::http::GASdkErrorQueue queue(MaxCount, MaxQueuedSdkErrors);
+    const int64_t now = 1000;
+    std::vector<gameanalytics::http::SdkErrorEvent> events;
+
+    // errors count against the limit as soon as they are queued, before any of them is sent
+    for (int i = 0; i < MaxCount; ++i)
+    {
+        ASSERT_EQ(gameanalytics::http::GASdkErrorQueue::Queued, queue.push(makeSdkError(gameanalytics::http::DesignEvent, gameanalytics::http::InvalidEventIdLength, "game " + std::to_string(i)), now));
+    }
+    ASSERT_EQ(gameanalytics::http::GASdkErrorQueue::RateLimited, queue.push(makeSdkError(gameanalytics::http::DesignEvent, gameanalytics::http::InvalidEventIdLength, "game 10"), now));
+    // the limit is per (category, area)
+    ASSERT_EQ(gameanalytics::http::GASdkErrorQueue::Queued, queue.push(makeSdkError(gameanalytics::http::ErrorEvent, gameanalytics::http::InvalidSeverity, "game"), now));
+
+    // sent errors keep counting
+    queue.takeAll(events);
+    ASSERT_EQ(static_cast<size_t>(MaxCount + 1), events.size());
+    ASSERT_EQ(gameanalytics::http::GASdkErrorQueue::RateLimited, queue.push(makeSdkError(gameanalytics::http::DesignEvent, gameanalytics::http::InvalidEventIdLength, "game 10"), now + 3599));
+
+    // failed ones are given back
+    std::vector<gameanalytics::http::SdkErrorEvent> failed(events.begin(), events.begin() + 2);
+    queue.sendFailed(failed);
+    ASSERT_EQ(gameanalytics::http::GASdkErrorQueue::Queued, queue.push(makeSdkError(gameanalytics::http::DesignEvent, gameanalytics::http::InvalidEventIdLength, "game 10"), now + 3599));
+    ASSERT_EQ(gameanalytics::http::GASdkErrorQueue::Queued, queue.push(makeSdkError(gameanalytics::http::DesignEvent, gameanalytics::http::InvalidEventIdLength, "game 11"), now + 3599));
+    ASSERT_EQ(gameanalytics::http::GASdkErrorQueue::RateLimited, queue.push(makeSdkError(gameanalytics::http::DesignEvent, gameanalytics::http::InvalidEventIdLength, "game 12"), now + 3599));
+
+    // and the count starts over after an hour
+    ASSERT_EQ(gameanalytics::http::GASdkErrorQueue::Queued, queue.push(makeSdkError(gameanalytics::http::DesignEvent, gameanalytics::http::InvalidEventIdLength, "game 12"), now + 3600));
+}
+
+TEST(GAHTTPApi, testSdkErrorQueueIsBounded)
+{
+    // room under the rate limit for one more than fits in the queue
+    gameanalytics::http::GASdkErrorQueue queue(static_cast<int>(MaxQueuedSdkErrors) + 1, MaxQueuedSdkErrors);
+    const int64_t now = 1000;
+
+    for (size_t i = 0; i < MaxQueuedSdkErrors; ++i)
+    {
+        ASSERT_EQ(gameanalytics::http::GASdkErrorQueue::Queued, queue.push(makeSdkError(gameanalytics::http::DesignEvent, gameanalytics::http::InvalidEventIdLength, "game " + std::to_string(i)), now));
+    }
+    ASSERT_EQ(gameanalytics::http::GASdkErrorQueue::QueueFull, queue.push(makeSdkError(gameanalytics::http::DesignEvent, gameanalytics::http::InvalidEventIdLength, "one too many"), now));
+    ASSERT_EQ(MaxQueuedSdkErrors, queue.size());
+
+    // dropped errors don't count against the limit
+    std::vector<gameanalytics::http::SdkErrorEvent> events;
+    queue.takeAll(events);
+    ASSERT_EQ(MaxQueuedSdkErrors, events.size());
+    ASSERT_EQ(gameanalytics::http::GASdkErrorQueue::Queued, queue.push(makeSdkError(gameanalytics::http::DesignEvent, gameanalytics::http::InvalidEventIdLength, "one too many"), now));
+    ASSERT_EQ(gameanalytics::http::GASdkErrorQueue::RateLimited, queue.push(makeSdkError(gameanalytics::http::DesignEvent, gameanalytics::http::InvalidEventIdLength, "another one"), now));
+}
@@ -0,0 +1,101 @@
+//
+// GA-SDK-CPP
+// Copyright 2018 GameAnalytics C++ SDK. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "GALogger.h"
+#include "GADevice.h"
+#include "GAUtilities.h"
+
+namespace
+{
+    std::string readLogFile(const char* name = "ga_log.txt")
+    {
+        std::string path = std::string(gameanalytics::device::GADevice::getWritablePath()) + gameanalytics::utilities::GAUtilities::getPathSeparator() + name;
+        std::ifstream file(path, std::ifstream::binary);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+}
+
+TEST(GALogger, testQueuedLinesAreWrittenOnFlush)
+{
+    gameanalytics::logging::GALogger::setInfoLog(true);
+    gameanalytics::logging::GALogger::customInitializeLog();
+
+    for (int i = 0; i < 100; ++i)
+    {
+        gameanalytics::logging::GALogger::i("queued line %d", i);
+    }
+    // longer than the pooled line buffer
+    std::string longMessage(2000, 'x');
+    gameanalytics::logging::GALogger::w("%s", longMessage.c_str());
+    gameanalytics::logging::GALogger::flushLog();
+
+    std::string log = readLogFile();
+    ASSERT_NE(std::string::npos, log.find("Info/GameAnalytics: queued line 0\nInfo/GameAnalytics: queued line 1\n"));
+    ASSERT_NE(std::string::npos, log.find("Info/GameAnalytics: queued line 99\n"));
+    ASSERT_NE(std::string::npos, log.find("Warning/GameAnalytics: " + longMessage + "\n"));
+    ASSERT_EQ(0u, gameanalytics::logging::GALogger::getDroppedMessageCount());
+}
+
+TEST(GALogger, testLevelChecks)
+{
+    gameanalytics::logging::GALogger::setInfoLog(false);
+    gameanalytics::logging::GALogger::setVerboseInfoLog(false);
+    ASSERT_FALSE(gameanalytics::logging::GALogger::isInfoEnabled());
+    ASSERT_FALSE(gameanalytics::logging::GALogger::isVerboseInfoEnabled());
+
+    gameanalytics::logging::GALogger::setInfoLog(true);
+    ASSERT_TRUE(gameanalytics::logging::GALogger::isInfoEnabled());
+    ASSERT_FALSE(gameanalytics::logging::GALogger::isVerboseInfoEnabled());
+}
+
+TEST(GALogger, testLogRotationByRename)
+{
+    gameanalytics::logging::GALogger::setInfoLog(true);
+    gameanalytics::logging::GALogger::setLogRotation(4096, 2);
+    gameanalytics::logging::GALogger::customInitializeLog();
+
+    // each flush is one batch, so each of these fills and rotates a file
+    std::string filler(5000, 'x');
+    const char* generations[] = { "oldest", "older", "old" };
+    for (const char* generation : generations)
+    {
+        gameanalytics::logging::GALogger::i("%s %s", generation, filler.c_str());
+        gameanalytics::logging::GALogger::flushLog();
+    }
+    gameanalytics::logging::GALogger::i("current");
+    gameanalytics::logging::GALogger::flushLog();
+
+    // the oldest generation is gone
+    ASSERT_EQ("Info/GameAnalytics: current\n", readLogFile());
+    ASSERT_EQ(0u, readLogFile("ga_log-prev.txt").find("Info/GameAnalytics: old x"));
+    ASSERT_EQ(0u, readLogFile("ga_log-prev2.txt").find("Info/GameAnalytics: older x"));
+
+    gameanalytics::logging::GALogger::setLogRotation(1048576, 1);
+}
+
+// time spent in the calling thread per info line, run with --gtest_also_run_disabled_tests
+TEST(GALogger, DISABLED_benchmarkInfoLog)
+{
+    gameanalytics::logging::GALogger::setInfoLog(true);
+    gameanalytics::logging::GALogger::customInitializeLog();
+    const int lineCount = 20000;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < lineCount; ++i)
+    {
+        gameanalytics::logging::GALogger::i("Event added to queue: {\"category\":\"design\",\"event_id\":\"level:boss:defeated\",\"value\":%d}", i);
+    }
+    double logged = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    gameanalytics::logging::GALogger::flushLog();
+    double flushed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    fprintf(stderr, "%.1f ns per line in the caller, %.1f ns per line including the write, %llu dropped\n", logged / lineCount, flushed / lineCount, gameanalytics::logging::GALogger::getDroppedMessageCount());
+}
@@ -7,7 +7,12 @@
 #include <gmock/gmock.h>
 
 #include <GAState.h>
+#include <GameAnalytics.h>
 #include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#include <cmath>
+#include <limits>
 
 #include "helpers/GATestHelpers.h"
 
@@ -114,3 +119,202 @@ TEST(GAStateTest, testValidateAndCleanCustomFields)
     gameanalytics::state::GAState::validateAndCleanCustomFields(map, v);
     ASSERT_TRUE(v.MemberCount() == 0);
 }
+
+TEST(GAStateTest, testCustomFieldsBuilder)
+{
+    gameanalytics::CustomFields fields;
+    fields.add("level", 5).add("score", 12.5).add("mode", "hard");
+    ASSERT_EQ(3, fields.getCount());
+
+    // invalid entries are skipped
+    fields.add("", 1);
+    fields.add("_&_", 1);
+    fields.add(GATestHelpers::getRandomString(65).c_str(), 1);
+    fields.add("empty", "");
+    fields.add("long", GATestHelpers::getRandomString(257).c_str());
+    fields.add("level", 6);
+    fields.add("nan", std::nan(""));
+    fields.add("infinity", std::numeric_limits<double>::infinity());
+    fields.add("negativeInfinity", -std::numeric_limits<double>::infinity());
+    ASSERT_EQ(3, fields.getCount());
+
+    size_t position = 0;
+    gameanalytics::CustomFields::Field field;
+    ASSERT_TRUE(fields.next(position, field));
+    ASSERT_STREQ("level", field.key);
+    ASSERT_TRUE(field.isNumber);
+    ASSERT_EQ(5, field.number);
+    ASSERT_TRUE(fields.next(position, field));
+    ASSERT_STREQ("score", field.key);
+    ASSERT_EQ(12.5, field.number);
+    ASSERT_TRUE(fields.next(position, field));
+    ASSERT_STREQ("mode", field.key);
+    ASSERT_FALSE(field.isNumber);
+    ASSERT_STREQ("hard", field.string);
+    ASSERT_FALSE(fields.next(position, field));
+
+    gameanalytics::CustomFields copy;
+    ASSERT_TRUE(copy.assign(fields.getData(), fields.getSize(), fields.getCount()));
+    ASSERT_TRUE(copy.has("mode"));
+    ASSERT_EQ(3, copy.getCount());
+
+    // a buffer that next() could read past is not taken
+    ASSERT_FALSE(copy.assign(fields.getData(), fields.getSize() - 1, fields.getCount()));
+    ASSERT_TRUE(copy.isEmpty());
+    ASSERT_FALSE(copy.assign(fields.getData(), fields.getSize(), fields.getCount() + 1));
+    ASSERT_TRUE(copy.isEmpty());
+    const char unterminatedKey[] = { 's', 'k', 'e', 'y' };
+    ASSERT_FALSE(copy.assign(unterminatedKey, sizeof(unterminatedKey), 1));
+    const char shortNumber[] = { 'n', 'k', '\0', 1, 2, 3 };
+    ASSERT_FALSE(copy.assign(shortNumber, sizeof(shortNumber), 1));
+    const char unknownType[] = { 'x', 'k', '\0', 'v', '\0' };
+    ASSERT_FALSE(copy.assign(unknownType, sizeof(unknownType), 1));
+    ASSERT_TRUE(copy.isEmpty());
+    position = 0;
+    ASSERT_FALSE(copy.next(position, field));
+
+    gameanalytics::CustomFields full;
+    for(int i = 0; i < 60; ++i)
+    {
+        full.add(("key" + std::to_string(i)).c_str(), i);
+    }
+    ASSERT_EQ(50, full.getCount());
+}
+
+TEST(GAStateTest, testRemoteConfigsSnapshotConversions)
+{
+    gameanalytics::state::RemoteConfigsSnapshot snapshot;
+    snapshot.configurations.Parse("{\"name\":\"boss\",\"lives\":\"3\",\"speed\":\"1.5\",\"hard\":\"true\",\"count\":42,\"scale\":2.5,\"name\":\"duplicate\"}");
+    snapshot.buildIndex();
+
+    ASSERT_EQ(nullptr, snapshot.find("missing"));
+
+    const gameanalytics::state::RemoteConfigsEntry* name = snapshot.find("name");
+    ASSERT_STREQ("boss", name->string);
+    ASSERT_FALSE(name->isInt64 || name->isDouble || name->isBool);
+
+    const gameanalytics::state::RemoteConfigsEntry* lives = snapshot.find("lives");
+    ASSERT_TRUE(lives->isInt64);
+    ASSERT_EQ(3, lives->int64Value);
+    ASSERT_DOUBLE_EQ(3.0, lives->doubleValue);
+
+    const gameanalytics::state::RemoteConfigsEntry* speed = snapshot.find("speed");
+    ASSERT_FALSE(speed->isInt64);
+    ASSERT_DOUBLE_EQ(1.5, speed->doubleValue);
+
+    const gameanalytics::state::RemoteConfigsEntry* hard = snapshot.find("hard");
+    ASSERT_TRUE(hard->isBool && hard->boolValue);
+
+    // numbers can be read as text too
+    ASSERT_STREQ("42", snapshot.find("count")->string);
+    ASSERT_EQ(42, snapshot.find("count")->int64Value);
+    ASSERT_STREQ("2.5", snapshot.find("scale")->string);
+}
+
+TEST(GAStateTest, testRemoteConfigsValueResolvesAgainAfterRefresh)
+{
+    rapidjson::Document sdkConfig;
+    sdkConfig.Parse("{\"configs\":[{\"key\":\"lives\",\"value\":\"3\"}]}");
+    gameanalytics::state::GAState::populateConfigurations(sdkConfig);
+    int version = gameanalytics::state::GAState::getRemoteConfigsVersion();
+
+    gameanalytics::RemoteConfigsValue lives("lives");
+    gameanalytics::RemoteConfigsValue hard("hard");
+    ASSERT_EQ(3, lives.asInt64(0));
+    ASSERT_FALSE(hard.exists());
+
+    sdkConfig.Parse("{\"configs\":[{\"key\":\"lives\",\"value\":\"5\"},{\"key\":\"hard\",\"value\":\"true\"}]}");
+    gameanalytics::state::GAState::populateConfigurations(sdkConfig);
+
+    ASSERT_NE(version, gameanalytics::state::GAState::getRemoteConfigsVersion());
+    ASSERT_EQ(5, lives.asInt64(0));
+    ASSERT_STREQ("5", lives.asString(""));
+    ASSERT_TRUE(hard.asBool(false));
+
+    sdkConfig.Parse("{\"configs\":[]}");
+    gameanalytics::state::GAState::populateConfigurations(sdkConfig);
+    ASSERT_FALSE(lives.exists());
+}
+
+namespace
+{
+    // the static annotations as spliced into stored events, parsed back into an object
+    void splicedStaticAnnotations(rapidjson::Document& out)
+    {
+        rapidjson::StringBuffer buffer;
+        buffer.Put('{');
+        gameanalytics::state::GAState::appendStaticEventAnnotations(buffer);
+        buffer.Put('}');
+        out.Parse(buffer.GetString(), buffer.GetSize());
+    }
+
+    // the spliced annotations hold exactly the static members of the full annotations document
+    ::testing::AssertionResult splicedAnnotationsMatchFullDocument()
+    {
+        rapidjson::Document spliced;
+        splicedStaticAnnotations(spliced);
+        if (spliced.HasParseError() || !spliced.IsObject())
+        {
+            return ::testing::AssertionFailure() << "spliced annotations are not a JSON object";
+        }
+
+        rapidjson::Document full;
+        gameanalytics::state::GAState::getEventAnnotations(full);
+        rapidjson::Document expected;
+        expected.SetObject();
+        for (rapidjson::Value::ConstMemberIterator itr = full.MemberBegin(); itr != full.MemberEnd(); ++itr)
+        {
+            if (gameanalytics::state::GAState::isStaticEventAnnotation(itr->name.GetString()))
+            {
+                rapidjson::Value name(itr->name, expected.GetAllocator());
+                rapidjson::Value value(itr->value, expected.GetAllocator());
+                expected.AddMember(name, value, expected.GetAllocator());
+            }
+        }
+
+        if (spliced != expected)
+        {
+            rapidjson::StringBuffer splicedBuffer;
+            rapidjson::Writer<rapidjson::StringBuffer> splicedWriter(splicedBuffer);
+            spliced.Accept(splicedWriter);
+            rapidjson::StringBuffer expectedBuffer;
+            rapidjson::Writer<rapidjson::StringBuffer> expectedWriter(expectedBuffer);
+            expected.Accept(expectedWriter);
+            return ::testing::AssertionFailure() << "spliced " << splicedBuffer.GetString() << " expected " << expectedBuffer.GetString();
+        }
+        return ::testing::AssertionSuccess();
+    }
+}
+
+TEST(GAStateTest, testSplicedEventAnnotationsFollowStateChanges)
+{
+    ASSERT_TRUE(splicedAnnotationsMatchFullDocument());
+
+    rapidjson::Document spliced;
+    gameanalytics::state::GAState::setUserId("annotations_user");
+    ASSERT_TRUE(splicedAnnotationsMatchFullDocument());
+    splicedStaticAnnotations(spliced);
+    ASSERT_STREQ("annotations_user", spliced["user_id"].GetString());
+
+    gameanalytics::state::GAState::setBuild("annotations_build");
+    ASSERT_TRUE(splicedAnnotationsMatchFullDocument());
+    splicedStaticAnnotations(spliced);
+    ASSERT_STREQ("annotations_build", spliced["build"].GetString());
+
+    rapidjson::Document sdkConfig;
+    sdkConfig.Parse("{\"configs\":[{\"key\":\"annotations_key\",\"value\":\"on\"}]}");
+    gameanalytics::state::GAState::populateConfigurations(sdkConfig);
+    ASSERT_TRUE(splicedAnnotationsMatchFullDocument());
+    splicedStaticAnnotations(spliced);
+    ASSERT_TRUE(spliced.HasMember("configurations"));
+    ASSERT_STREQ("on", spliced["configurations"]["annotations_key"].GetString());
+
+    sdkConfig.Parse("{\"configs\":[]}");
+    gameanalytics::state::GAState::populateConfigurations(sdkConfig);
+    gameanalytics::state::GAState::setBuild("");
+    gameanalytics::state::GAState::setUserId("");
+    ASSERT_TRUE(splicedAnnotationsMatchFullDocument());
+    splicedStaticAnnotations(spliced);
+    ASSERT_FALSE(spliced.HasMember("configurations"));
+    ASSERT_FALSE(spliced.HasMember("build"));
+}
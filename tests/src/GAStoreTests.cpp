@@ -0,0 +1,250 @@
+//
+// GA-SDK-CPP
+// Copyright 2018 GameAnalytics C++ SDK. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "GAStore.h"
+#include "GADevice.h"
+#include "GAUtilities.h"
+
+namespace
+{
+    const char* GameKey = "bd624ee6f8e6efb32a054f8d7ba11618";
+    const char* InsertEventSql = "INSERT INTO ga_events (status, category, session_id, client_ts, event) VALUES(0, ?, ?, ?, ?);";
+    const char* EventJson = "{\"category\":\"design\",\"event_id\":\"level:boss:defeated\",\"value\":12.5,\"session_num\":3,\"v\":2,\"user_id\":\"5f3e9c1e-44a2-4e7c-9a37-3b6d2fd1c6b1\"}";
+
+    std::string journalMode()
+    {
+        std::string mode;
+        gameanalytics::store::GAStore::queryRowsSync("PRAGMA journal_mode;", [&mode](const gameanalytics::store::GAStoreRow& row)
+        {
+            mode = row.getString(0);
+            return false;
+        });
+        return mode;
+    }
+
+    std::string dbFilePath()
+    {
+        const char* separator = gameanalytics::utilities::GAUtilities::getPathSeparator();
+        return std::string(gameanalytics::device::GADevice::getWritablePath()) + separator + GameKey + separator + "ga.sqlite3";
+    }
+
+    void restoreDefaultSettings()
+    {
+        gameanalytics::store::GAStore::setJournalMode(gameanalytics::JournalModeDelete);
+        gameanalytics::store::GAStore::setSynchronous(gameanalytics::SynchronousFull);
+        gameanalytics::store::GAStore::ensureDatabase(true, GameKey);
+    }
+
+    // inserts count events, batchSize per transaction, and returns events per second
+    double insertEvents(int count, int batchSize)
+    {
+        std::vector<const char*> parameters;
+        parameters.reserve(batchSize * 4);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; i += batchSize)
+        {
+            parameters.clear();
+            for (int j = 0; j < batchSize; ++j)
+            {
+                parameters.push_back("design");
+                parameters.push_back("2d9a2b2a-8c24-4a6c-9b1d-1c2e6f9d8e71");
+                parameters.push_back("1539000000");
+                parameters.push_back(EventJson);
+            }
+
+            if (batchSize == 1)
+            {
+                gameanalytics::store::GAStore::executeQuerySync(InsertEventSql, parameters.data(), 4);
+            }
+            else
+            {
+                gameanalytics::store::GAStore::executeBatchQuerySync(InsertEventSql, parameters.data(), 4, batchSize);
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return count / seconds;
+    }
+}
+
+TEST(GAStore, testJournalModeSetting)
+{
+    gameanalytics::store::GAStore::setJournalMode(gameanalytics::JournalModeWAL);
+    ASSERT_TRUE(gameanalytics::store::GAStore::ensureDatabase(true, GameKey));
+    ASSERT_EQ("wal", journalMode());
+
+    // changing it on an open database applies right away
+    gameanalytics::store::GAStore::setJournalMode(gameanalytics::JournalModeTruncate);
+    ASSERT_EQ("truncate", journalMode());
+
+    restoreDefaultSettings();
+    ASSERT_EQ("delete", journalMode());
+}
+
+TEST(GAStore, testDbSizeTracksWrites)
+{
+    ASSERT_TRUE(gameanalytics::store::GAStore::ensureDatabase(true, GameKey));
+    long long emptySize = gameanalytics::store::GAStore::getDbSizeBytes();
+    ASSERT_GT(emptySize, 0);
+
+    insertEvents(500, 50);
+    long long filledSize = gameanalytics::store::GAStore::getDbSizeBytes();
+    ASSERT_GT(filledSize, emptySize);
+
+    // with the rollback journal the database file holds every committed page
+    std::ifstream file(dbFilePath(), std::ifstream::ate | std::ifstream::binary);
+    ASSERT_EQ(static_cast<long long>(file.tellg()), filledSize);
+}
+
+TEST(GAStore, testMigrateEventTableFromTextSchema)
+{
+    ASSERT_TRUE(gameanalytics::store::GAStore::ensureDatabase(true, GameKey));
+
+    // ga_events as created by older versions, with a pending and an in-flight event
+    gameanalytics::store::GAStore::executeQuerySync("DROP TABLE ga_events;");
+    ASSERT_TRUE(gameanalytics::store::GAStore::executeQuerySync("CREATE TABLE ga_events(status CHAR(50) NOT NULL, category CHAR(50) NOT NULL, session_id CHAR(50) NOT NULL, client_ts CHAR(50) NOT NULL, event TEXT NOT NULL);"));
+    const char* oldEvents[][2] = { { "new", "1539000300" }, { "b3b1b6a4-6f1e-4d36-9a8e-0d3c3e2b7f10", "1539000100" }, { "new", "1539000200" } };
+    for (const auto& oldEvent : oldEvents)
+    {
+        const char* parameters[] = { oldEvent[0], oldEvent[1], EventJson };
+        gameanalytics::store::GAStore::executeQuerySync("INSERT INTO ga_events (status, category, session_id, client_ts, event) VALUES(?, 'design', '2d9a2b2a-8c24-4a6c-9b1d-1c2e6f9d8e71', ?, ?);", parameters, 3);
+    }
+
+    ASSERT_TRUE(gameanalytics::store::GAStore::ensureDatabase(false, GameKey));
+
+    std::vector<long long> ids;
+    std::vector<long long> statuses;
+    std::vector<long long> timestamps;
+    std::vector<std::string> types;
+    ASSERT_TRUE(gameanalytics::store::GAStore::queryRowsSync("SELECT id, status, client_ts, typeof(client_ts), event FROM ga_events ORDER BY id;", [&](const gameanalytics::store::GAStoreRow& row)
+    {
+        ids.push_back(row.getInt64(0));
+        statuses.push_back(row.getInt64(1));
+        timestamps.push_back(row.getInt64(2));
+        types.push_back(row.getString(3));
+        EXPECT_STREQ(EventJson, row.getString(4));
+        return true;
+    }));
+
+    ASSERT_EQ(3u, ids.size());
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        ASSERT_EQ(static_cast<long long>(i + 1), ids[i]);
+        ASSERT_EQ(0, statuses[i]);
+        ASSERT_EQ("integer", types[i]);
+    }
+    // ids follow client_ts
+    ASSERT_EQ(1539000100, timestamps[0]);
+    ASSERT_EQ(1539000200, timestamps[1]);
+    ASSERT_EQ(1539000300, timestamps[2]);
+}
+
+TEST(GAStore, testEventQuotaEvictsLowPriorityCategories)
+{
+    ASSERT_TRUE(gameanalytics::store::GAStore::ensureDatabase(true, GameKey));
+
+    std::string autoVacuum;
+    gameanalytics::store::GAStore::queryRowsSync("PRAGMA auto_vacuum;", [&autoVacuum](const gameanalytics::store::GAStoreRow& row)
+    {
+        autoVacuum = row.getString(0);
+        return false;
+    });
+    ASSERT_EQ("2", autoVacuum);
+
+    const char* categories[] = { "business", "design", "error", "design", "business" };
+    for (const char* category : categories)
+    {
+        for (int i = 0; i < 100; ++i)
+        {
+            const char* parameters[] = { category, "2d9a2b2a-8c24-4a6c-9b1d-1c2e6f9d8e71", "1539000000", EventJson };
+            gameanalytics::store::GAStore::executeQuerySync(InsertEventSql, parameters, 4);
+        }
+    }
+
+    // evicts down to 90% of the quota
+    gameanalytics::store::GAStore::setEventQuota(0, 350);
+    gameanalytics::store::GAStore::addEventsToQuota(500, 0);
+    gameanalytics::store::GAStore::setEventQuota(5242880, 0);
+
+    rapidjson::Document counts;
+    gameanalytics::store::GAStore::executeQuerySync("SELECT category, COUNT(*) AS count, MIN(id) AS first FROM ga_events GROUP BY category ORDER BY category;", counts);
+    ASSERT_EQ(2u, counts.Size());
+    ASSERT_STREQ("business", counts[0]["category"].GetString());
+    ASSERT_EQ(200, counts[0]["count"].GetInt());
+    // the older design events went first
+    ASSERT_STREQ("design", counts[1]["category"].GetString());
+    ASSERT_EQ(100, counts[1]["count"].GetInt());
+    ASSERT_EQ(301, counts[1]["first"].GetInt());
+    ASSERT_FALSE(gameanalytics::store::GAStore::isDbTooLargeForEvents());
+}
+
+TEST(GAStore, testEventQuotaSkipsMeasuringWhenNothingCanBeEvicted)
+{
+    ASSERT_TRUE(gameanalytics::store::GAStore::ensureDatabase(true, GameKey));
+    gameanalytics::store::GAStore::executeQuerySync("DELETE FROM ga_events;");
+    for (int i = 0; i < 300; ++i)
+    {
+        const char* parameters[] = { "business", "2d9a2b2a-8c24-4a6c-9b1d-1c2e6f9d8e71", "1539000000", EventJson };
+        gameanalytics::store::GAStore::executeQuerySync(InsertEventSql, parameters, 4);
+    }
+
+    // business events are never evicted
+    gameanalytics::store::GAStore::setEventQuota(0, 250);
+    gameanalytics::store::GAStore::addEventsToQuota(300, 0);
+    ASSERT_TRUE(gameanalytics::store::GAStore::isDbTooLargeForEvents());
+
+    // not measured again until the bounds grow by a tenth of the quota or events are removed
+    gameanalytics::store::GAStore::executeQuerySync("DELETE FROM ga_events WHERE id IN (SELECT id FROM ga_events LIMIT 100);");
+    gameanalytics::store::GAStore::addEventsToQuota(1, 0);
+    ASSERT_TRUE(gameanalytics::store::GAStore::isDbTooLargeForEvents());
+
+    gameanalytics::store::GAStore::eventsRemovedFromStore();
+    gameanalytics::store::GAStore::addEventsToQuota(0, 0);
+    ASSERT_FALSE(gameanalytics::store::GAStore::isDbTooLargeForEvents());
+
+    gameanalytics::store::GAStore::setEventQuota(5242880, 0);
+}
+
+// events/sec for the journal and synchronous settings, run with --gtest_also_run_disabled_tests
+TEST(GAStore, DISABLED_benchmarkDatabaseSettings)
+{
+    struct Setting
+    {
+        const char* name;
+        gameanalytics::EGADatabaseJournalMode journalMode;
+        gameanalytics::EGADatabaseSynchronous synchronous;
+    };
+    const Setting settings[] =
+    {
+        { "DELETE / FULL", gameanalytics::JournalModeDelete, gameanalytics::SynchronousFull },
+        { "DELETE / NORMAL", gameanalytics::JournalModeDelete, gameanalytics::SynchronousNormal },
+        { "TRUNCATE / NORMAL", gameanalytics::JournalModeTruncate, gameanalytics::SynchronousNormal },
+        { "WAL / FULL", gameanalytics::JournalModeWAL, gameanalytics::SynchronousFull },
+        { "WAL / NORMAL", gameanalytics::JournalModeWAL, gameanalytics::SynchronousNormal },
+        { "WAL / OFF", gameanalytics::JournalModeWAL, gameanalytics::SynchronousOff }
+    };
+    const int eventCount = 2000;
+
+    printf("%-20s %18s %18s\n", "journal / sync", "events/s (1 each)", "events/s (50 each)");
+    for (const Setting& setting : settings)
+    {
+        gameanalytics::store::GAStore::setJournalMode(setting.journalMode);
+        gameanalytics::store::GAStore::setSynchronous(setting.synchronous);
+        ASSERT_TRUE(gameanalytics::store::GAStore::ensureDatabase(true, GameKey));
+
+        double single = insertEvents(eventCount, 1);
+        double batched = insertEvents(eventCount, 50);
+        printf("%-20s %18.0f %18.0f\n", setting.name, single, batched);
+    }
+
+    restoreDefaultSettings();
+}
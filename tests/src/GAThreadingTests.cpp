@@ -0,0 +1,325 @@
+//
+// GA-SDK-CPP
+// Copyright 2018 GameAnalytics C++ SDK. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "GAThreading.h"
+
+namespace
+{
+    const int TaskQueueCapacity = 2048;
+
+    // keeps the GA thread busy until release() so queued tasks pile up
+    class GAThreadBlocker
+    {
+     public:
+        GAThreadBlocker()
+        {
+            std::shared_future<void> released = releasePromise.get_future().share();
+            std::promise<void>* started = &startedPromise;
+            gameanalytics::threading::GAThreading::performTaskOnGAThread([started, released]()
+            {
+                started->set_value();
+                released.wait();
+            });
+        }
+
+        bool waitUntilBlocked()
+        {
+            return startedPromise.get_future().wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+        }
+
+        void release()
+        {
+            releasePromise.set_value();
+        }
+
+     private:
+        std::promise<void> startedPromise;
+        std::promise<void> releasePromise;
+    };
+
+    // true once every task queued before this call has run
+    bool waitForGAThread()
+    {
+        std::shared_ptr<std::promise<void>> done = std::make_shared<std::promise<void>>();
+        std::future<void> future = done->get_future();
+        gameanalytics::threading::GAThreading::performTaskOnGAThread([done]()
+        {
+            done->set_value();
+        });
+        return future.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+    }
+}
+
+TEST(GAThreading, testBoundedQueueMultipleProducers)
+{
+    const int producerCount = 4;
+    const int consumerCount = 2;
+    const int itemsPerProducer = 20000;
+    const int itemCount = producerCount * itemsPerProducer;
+    gameanalytics::threading::GABoundedQueue<int, 1024> queue;
+    std::vector<std::atomic<int>> seen(itemCount);
+    for (std::atomic<int>& count : seen)
+    {
+        count = 0;
+    }
+    std::atomic<int> popped(0);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producerCount; ++p)
+    {
+        threads.push_back(std::thread([&queue, p, itemsPerProducer]()
+        {
+            for (int i = 0; i < itemsPerProducer; ++i)
+            {
+                int item = p * itemsPerProducer + i;
+                while (!queue.tryPush(item))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+    for (int c = 0; c < consumerCount; ++c)
+    {
+        threads.push_back(std::thread([&queue, &seen, &popped, itemCount]()
+        {
+            while (popped < itemCount)
+            {
+                int item;
+                if (queue.tryPop(item))
+                {
+                    ++seen[item];
+                    ++popped;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    ASSERT_TRUE(queue.isEmpty());
+    for (int i = 0; i < itemCount; ++i)
+    {
+        ASSERT_EQ(1, seen[i].load()) << "item " << i;
+    }
+}
+
+TEST(GAThreading, testDropNewestOnlyDropsEventTasks)
+{
+    gameanalytics::threading::GAThreading::setTaskQueueFullPolicy(gameanalytics::DropNewest);
+    unsigned long long droppedBefore = gameanalytics::threading::GAThreading::getDroppedTaskCount();
+    std::atomic<int> ran(0);
+
+    GAThreadBlocker blocker;
+    ASSERT_TRUE(blocker.waitUntilBlocked());
+    const int taskCount = TaskQueueCapacity + 5;
+    for (int i = 0; i < taskCount; ++i)
+    {
+        gameanalytics::threading::GAThreading::performEventTaskOnGAThread([&ran, i]()
+        {
+            // the first tasks are the ones kept
+            if (i < TaskQueueCapacity)
+            {
+                ++ran;
+            }
+        });
+    }
+    // other tasks wait for room instead
+    std::atomic<bool> pushed(false);
+    std::thread producer([&ran, &pushed]()
+    {
+        gameanalytics::threading::GAThreading::performTaskOnGAThread([&ran]()
+        {
+            ++ran;
+        });
+        pushed = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_FALSE(pushed.load());
+    blocker.release();
+    producer.join();
+    ASSERT_TRUE(waitForGAThread());
+
+    ASSERT_EQ(5u, gameanalytics::threading::GAThreading::getDroppedTaskCount() - droppedBefore);
+    ASSERT_EQ(TaskQueueCapacity + 1, ran.load());
+    gameanalytics::threading::GAThreading::setTaskQueueFullPolicy(gameanalytics::DropOldest);
+}
+
+TEST(GAThreading, testDropOldestOnlyDropsEventTasks)
+{
+    gameanalytics::threading::GAThreading::setTaskQueueFullPolicy(gameanalytics::DropOldest);
+    unsigned long long droppedBefore = gameanalytics::threading::GAThreading::getDroppedTaskCount();
+    std::atomic<int> eventsRan(0);
+    std::vector<int> otherTasksRan;
+
+    GAThreadBlocker blocker;
+    ASSERT_TRUE(blocker.waitUntilBlocked());
+    const int taskCount = TaskQueueCapacity + 5;
+    int otherTaskCount = 0;
+    for (int i = 0; i < taskCount; ++i)
+    {
+        // every 100th task stands in for initialize, startSession and the like
+        if (i % 100 == 0)
+        {
+            ++otherTaskCount;
+            gameanalytics::threading::GAThreading::performTaskOnGAThread([&otherTasksRan, i]()
+            {
+                otherTasksRan.push_back(i);
+            });
+        }
+        else
+        {
+            gameanalytics::threading::GAThreading::performEventTaskOnGAThread([&eventsRan]()
+            {
+                ++eventsRan;
+            });
+        }
+    }
+    blocker.release();
+    // waitForGAThread's task would drop another event while the queue is still full
+    gameanalytics::threading::GAThreading::setTaskQueueFullPolicy(gameanalytics::WaitForSpace);
+    ASSERT_TRUE(waitForGAThread());
+
+    // moving the first task, which can't be dropped, out of the queue made room for one of the 5
+    ASSERT_EQ(4u, gameanalytics::threading::GAThreading::getDroppedTaskCount() - droppedBefore);
+    ASSERT_EQ(taskCount - otherTaskCount - 4, eventsRan.load());
+    // none of the other tasks went missing and they kept their order
+    ASSERT_EQ(static_cast<size_t>(otherTaskCount), otherTasksRan.size());
+    for (int i = 0; i < otherTaskCount; ++i)
+    {
+        ASSERT_EQ(i * 100, otherTasksRan[i]);
+    }
+    gameanalytics::threading::GAThreading::setTaskQueueFullPolicy(gameanalytics::DropOldest);
+}
+
+TEST(GAThreading, testWaitForSpaceWhenTaskQueueIsFull)
+{
+    gameanalytics::threading::GAThreading::setTaskQueueFullPolicy(gameanalytics::WaitForSpace);
+    unsigned long long droppedBefore = gameanalytics::threading::GAThreading::getDroppedTaskCount();
+    std::atomic<int> ran(0);
+
+    GAThreadBlocker blocker;
+    ASSERT_TRUE(blocker.waitUntilBlocked());
+    for (int i = 0; i < TaskQueueCapacity; ++i)
+    {
+        gameanalytics::threading::GAThreading::performEventTaskOnGAThread([&ran]()
+        {
+            ++ran;
+        });
+    }
+    // the queue is full, so this producer waits until the GA thread is released
+    std::atomic<bool> pushed(false);
+    std::atomic<long long> waitCpuInUs(0);
+    std::thread producer([&ran, &pushed, &waitCpuInUs]()
+    {
+        timespec start;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+        gameanalytics::threading::GAThreading::performEventTaskOnGAThread([&ran]()
+        {
+            ++ran;
+        });
+        timespec end;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+        waitCpuInUs = (end.tv_sec - start.tv_sec) * 1000000LL + (end.tv_nsec - start.tv_nsec) / 1000;
+        pushed = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_FALSE(pushed.load());
+    blocker.release();
+    producer.join();
+    ASSERT_TRUE(waitForGAThread());
+
+    ASSERT_EQ(0u, gameanalytics::threading::GAThreading::getDroppedTaskCount() - droppedBefore);
+    ASSERT_EQ(TaskQueueCapacity + 1, ran.load());
+    // blocked rather than spinning for the 100 ms
+    ASSERT_LT(waitCpuInUs.load(), 20000);
+    gameanalytics::threading::GAThreading::setTaskQueueFullPolicy(gameanalytics::DropOldest);
+}
+
+TEST(GAThreading, testFullQueueFromGAThreadOnlyDropsEventTasks)
+{
+    gameanalytics::threading::GAThreading::setTaskQueueFullPolicy(gameanalytics::WaitForSpace);
+    unsigned long long droppedBefore = gameanalytics::threading::GAThreading::getDroppedTaskCount();
+    std::atomic<int> eventsRan(0);
+    std::vector<int> otherTasksRan;
+
+    // nothing else drains the queue while the GA thread is queueing, so waiting would never return
+    std::promise<void> queued;
+    std::promise<void>* queuedPtr = &queued;
+    gameanalytics::threading::GAThreading::performTaskOnGAThread([&eventsRan, &otherTasksRan, queuedPtr]()
+    {
+        for (int i = 0; i < TaskQueueCapacity + 5; ++i)
+        {
+            gameanalytics::threading::GAThreading::performEventTaskOnGAThread([&eventsRan]()
+            {
+                ++eventsRan;
+            });
+        }
+        for (int i = 0; i < 3; ++i)
+        {
+            gameanalytics::threading::GAThreading::performTaskOnGAThread([&otherTasksRan, i]()
+            {
+                otherTasksRan.push_back(i);
+            });
+        }
+        queuedPtr->set_value();
+    });
+    ASSERT_EQ(std::future_status::ready, queued.get_future().wait_for(std::chrono::seconds(10)));
+    ASSERT_TRUE(waitForGAThread());
+
+    ASSERT_EQ(5u, gameanalytics::threading::GAThreading::getDroppedTaskCount() - droppedBefore);
+    ASSERT_EQ(TaskQueueCapacity, eventsRan.load());
+    ASSERT_EQ(std::vector<int>({ 0, 1, 2 }), otherTasksRan);
+    gameanalytics::threading::GAThreading::setTaskQueueFullPolicy(gameanalytics::DropOldest);
+}
+
+TEST(GAThreading, testDispatchLatencyHistogramCountsEveryTask)
+{
+    GAThreadBlocker blocker;
+    ASSERT_TRUE(blocker.waitUntilBlocked());
+    gameanalytics::threading::GAThreading::resetDispatchLatencyHistogram();
+
+    // these wait behind the blocker for at least 20 ms
+    const int taskCount = 10;
+    for (int i = 0; i < taskCount; ++i)
+    {
+        gameanalytics::threading::GAThreading::performTaskOnGAThread([]() {});
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    blocker.release();
+    ASSERT_TRUE(waitForGAThread());
+
+    gameanalytics::threading::GAThreading::DispatchLatencyHistogram histogram;
+    gameanalytics::threading::GAThreading::getDispatchLatencyHistogram(histogram);
+    unsigned long long sum = 0;
+    unsigned long long atLeast10ms = 0;
+    for (int i = 0; i < gameanalytics::threading::GAThreading::DispatchLatencyBucketCount; ++i)
+    {
+        sum += histogram.counts[i];
+        if (i >= 4)
+        {
+            atLeast10ms += histogram.counts[i];
+        }
+    }
+    // the tasks plus the one waitForGAThread queued
+    ASSERT_EQ(static_cast<unsigned long long>(taskCount + 1), histogram.total);
+    ASSERT_EQ(histogram.total, sum);
+    ASSERT_GE(atLeast10ms, static_cast<unsigned long long>(taskCount));
+    ASSERT_GE(histogram.maxInUs, 20000);
+}
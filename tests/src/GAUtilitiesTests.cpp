@@ -8,6 +8,7 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <algorithm>
 
 #include <GAUtilities.h>
 #include <random>
@@ -106,6 +107,32 @@ TEST(GAUtilities, testGzip)
     }
 }
 
+TEST(GAUtilities, testGzipCompressorChunked)
+{
+    std::string JSONstring = "[";
+    for(int i = 0; i < 200; ++i)
+    {
+        JSONstring += i > 0 ? ",{\"v\":2,\"user_id\":\"test\"}" : "{\"v\":2,\"user_id\":\"test\"}";
+    }
+    JSONstring += "]";
+
+    std::vector<char> expected = gameanalytics::utilities::GAUtilities::gzipCompress(JSONstring.c_str());
+
+    gameanalytics::utilities::GAGzipCompressor compressor;
+    std::vector<char> compressed;
+    // run twice to check that the compressor can be reused
+    for(int run = 0; run < 2; ++run)
+    {
+        ASSERT_TRUE(compressor.begin(compressed, gameanalytics::utilities::GAGzipCompressor::BestCompression));
+        for(size_t i = 0; i < JSONstring.size(); i += 7)
+        {
+            ASSERT_TRUE(compressor.write(JSONstring.data() + i, std::min<size_t>(7, JSONstring.size() - i)));
+        }
+        ASSERT_TRUE(compressor.finish());
+        ASSERT_EQ(compressed, expected);
+    }
+}
+
 TEST(GAUtilities, testGenerateUUID)
 {
     char guid[65] = "";
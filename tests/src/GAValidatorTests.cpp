@@ -12,6 +12,9 @@
 #include <random>
 #include <GameAnalytics.h>
 #include <GAUtilities.h>
+#include <chrono>
+#include <cstdio>
+#include <functional>
 
 // test helpers
 #include "helpers/GATestHelpers.h"
@@ -696,3 +699,44 @@ TEST(GAValidator, testValidateUserId)
 
     ASSERT_FALSE(gameanalytics::validators::GAValidator::validateUserId(""));
 }
+
+TEST(GAValidator, testValidateConnectionTypeAndStore)
+{
+    ASSERT_TRUE(gameanalytics::validators::GAValidator::validateConnectionType("wifi"));
+    ASSERT_TRUE(gameanalytics::validators::GAValidator::validateConnectionType("offline"));
+    ASSERT_FALSE(gameanalytics::validators::GAValidator::validateConnectionType("wifi2"));
+    ASSERT_FALSE(gameanalytics::validators::GAValidator::validateConnectionType(""));
+
+    ASSERT_TRUE(gameanalytics::validators::GAValidator::validateStore("google_play"));
+    ASSERT_FALSE(gameanalytics::validators::GAValidator::validateStore("apple "));
+}
+
+// nanoseconds per call of the validators run for every event, run with --gtest_also_run_disabled_tests
+TEST(GAValidator, DISABLED_benchmarkValidators)
+{
+    const int iterations = 1000000;
+    int valid = 0;
+
+    auto measure = [iterations](const char* name, const std::function<bool()>& validate)
+    {
+        int count = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            count += validate() ? 1 : 0;
+        }
+        double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        printf("%-28s %8.1f ns\n", name, nanoseconds / iterations);
+        return count;
+    };
+
+    valid += measure("validateEventIdCharacters", []() { return gameanalytics::validators::GAValidator::validateEventIdCharacters("level_01:boss(fight):defeated!"); });
+    valid += measure("validateEventIdLength", []() { return gameanalytics::validators::GAValidator::validateEventIdLength("level_01:boss(fight):defeated!"); });
+    valid += measure("validateEventPartCharacters", []() { return gameanalytics::validators::GAValidator::validateEventPartCharacters("Sword of a thousand truths"); });
+    valid += measure("validateCurrency", []() { return gameanalytics::validators::GAValidator::validateCurrency("USD"); });
+    valid += measure("validateConnectionType", []() { return gameanalytics::validators::GAValidator::validateConnectionType("offline"); });
+    valid += measure("validateCustomFieldKey", []() { return gameanalytics::validators::GAValidator::validateCustomFieldKey("player_level_02"); });
+    valid += measure("stringMatch (regex)", []() { return gameanalytics::utilities::GAUtilities::stringMatch("USD", "^[A-Z]{3}$"); });
+
+    ASSERT_EQ(7 * iterations, valid);
+}
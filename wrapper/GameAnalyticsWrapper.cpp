@@ -193,6 +193,21 @@ const char* getRemoteConfigsValueAsStringWithDefaultValue(const char *key, const
     return result;
 }
 
+long long getRemoteConfigsValueAsInt64WithDefaultValue(const char *key, long long defaultValue)
+{
+    return gameanalytics::GameAnalytics::getRemoteConfigsValueAsInt64(key, defaultValue);
+}
+
+double getRemoteConfigsValueAsDoubleWithDefaultValue(const char *key, double defaultValue)
+{
+    return gameanalytics::GameAnalytics::getRemoteConfigsValueAsDouble(key, defaultValue);
+}
+
+bool getRemoteConfigsValueAsBoolWithDefaultValue(const char *key, bool defaultValue)
+{
+    return gameanalytics::GameAnalytics::getRemoteConfigsValueAsBool(key, defaultValue);
+}
+
 bool isRemoteConfigsReady()
 {
     return gameanalytics::GameAnalytics::isRemoteConfigsReady();
@@ -59,6 +59,9 @@ void onQuit();
 
 const char* getRemoteConfigsValueAsString(const char *key);
 const char* getRemoteConfigsValueAsStringWithDefaultValue(const char *key, const char *defaultValue);
+long long getRemoteConfigsValueAsInt64WithDefaultValue(const char *key, long long defaultValue);
+double getRemoteConfigsValueAsDoubleWithDefaultValue(const char *key, double defaultValue);
+bool getRemoteConfigsValueAsBoolWithDefaultValue(const char *key, bool defaultValue);
 bool isRemoteConfigsReady();
 const char* getRemoteConfigsContentAsString();
 